@@ -0,0 +1,111 @@
+/*
+	RLE Zoo Batch Processing Benchmark
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Compares rle_batch_run() against calling the codec in a loop, over a large
+	number of small buffers.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_batch.h"
+
+#include "rle-variant-selection.h"
+#include "test_common.h"
+
+#define MIN_JOB_SIZE 64
+#define MAX_JOB_SIZE 4096
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char *what, size_t njobs, size_t bytes, double seconds) {
+	printf("  %-16s %8.3f ms  %8.1f MiB/s  %10.0f jobs/s\n", what, seconds * 1e3, (double)bytes / (1024.0 * 1024.0) / seconds, (double)njobs / seconds);
+}
+
+static void bench(struct rle_batch_pool *pool, struct rle_batch_job *jobs, size_t njobs, rle_fp func, const char *name) {
+	size_t bytes = 0;
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		jobs[i].func = func;
+		bytes += jobs[i].slen;
+	}
+
+	printf("%s (%zu jobs, %zu bytes):\n", name, njobs, bytes);
+
+	double t0 = now();
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		jobs[i].result = func(jobs[i].src, jobs[i].slen, jobs[i].dest, jobs[i].dlen);
+	}
+	report("loop", njobs, bytes, now() - t0);
+
+	struct rle_batch_stats stats;
+	rle_batch_run(pool, jobs, njobs, &stats);
+	report("batch", njobs, stats.bytes_in, stats.seconds);
+	if (stats.failed) {
+		printf("  %zu jobs failed!\n", stats.failed);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	size_t njobs = argc > 1 ? strtoull(argv[1], NULL, 10) : 200000;
+	int nthreads = argc > 2 ? atoi(argv[2]) : 3;
+	const char *variant = argc > 3 ? argv[3] : "packbits";
+
+	struct rle_t *rle = get_rle_by_name(variant);
+	if (!rle) {
+		fprintf(stderr, "Unknown variant '%s'\n", variant);
+		print_variants();
+		return EXIT_FAILURE;
+	}
+
+	struct rle_batch_pool *pool = rle_batch_create(nthreads);
+	struct rle_batch_job *cjobs = calloc(njobs, sizeof(*cjobs));
+	struct rle_batch_job *djobs = calloc(njobs, sizeof(*djobs));
+	if (!pool || !cjobs || !djobs) {
+		fprintf(stderr, "Allocation failed.\n");
+		return EXIT_FAILURE;
+	}
+
+	srand(1234);
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		size_t len = MIN_JOB_SIZE + (size_t)rand() % (MAX_JOB_SIZE - MIN_JOB_SIZE + 1);
+		uint8_t *src = malloc(len);
+		fill_runs(src, len, 4, 200);
+		size_t dlen = (size_t)rle->compress(src, len, NULL, 0);
+		cjobs[i] = (struct rle_batch_job){ NULL, src, len, malloc(dlen), dlen, 0 };
+		djobs[i] = (struct rle_batch_job){ NULL, cjobs[i].dest, dlen, malloc(len), len, 0 };
+	}
+
+	printf("Benchmarking '%s' with %d worker threads + caller.\n", rle->name, nthreads);
+	bench(pool, cjobs, njobs, rle->compress, "compress");
+	bench(pool, djobs, njobs, rle->decompress, "decompress");
+
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		free((void*)(uintptr_t)cjobs[i].src);
+		free(cjobs[i].dest);
+		free(djobs[i].dest);
+	}
+	free(djobs);
+	free(cjobs);
+	rle_batch_destroy(pool);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/*
+	RLE Zoo Parallel Block-Framed Encoding & Decoding Benchmark
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Measures rle_block_compress() and rle_block_decompress() throughput over a large
+	buffer, for an increasing number of threads, and then rle_block_compress_adaptive()
+	choosing from all variants.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_crc.h"
+#include "rle_frame.h"
+#include "rle_block.h"
+
+#include "rle-variant-selection.h"
+#include "test_common.h"
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char *what, int nthreads, size_t bytes, double seconds) {
+	printf("  %-12s %2d threads %8.3f ms  %8.1f MiB/s\n", what, nthreads, seconds * 1e3, (double)bytes / (1024.0 * 1024.0) / seconds);
+}
+
+int main(int argc, char *argv[]) {
+	size_t len = argc > 1 ? strtoull(argv[1], NULL, 10) : 64*1024*1024;
+	int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+	const char *variant = argc > 3 ? argv[3] : "packbits";
+	size_t block_size = argc > 4 ? strtoull(argv[4], NULL, 10) : RLE_BLOCK_DEFAULT_SIZE;
+
+	struct rle_t *rle = get_rle_by_name(variant);
+	if (!rle) {
+		fprintf(stderr, "Unknown variant '%s'\n", variant);
+		print_variants();
+		return EXIT_FAILURE;
+	}
+	if (!rle->compress_stream || !rle->parse_op) {
+		fprintf(stderr, "Variant '%s' can't be block-framed\n", variant);
+		return EXIT_FAILURE;
+	}
+
+	uint8_t *input = malloc(len);
+	uint8_t *output = malloc(len);
+	fill_runs(input, len, 4, 200);
+
+	ssize_t flen = rle_block_compress(rle->compress_stream, rle->id, input, len, block_size, max_threads, NULL, 0);
+	uint8_t *frame = malloc(flen);
+
+	printf("%s (%zu bytes, %zu byte blocks, %zd bytes framed):\n", rle->name, len, block_size, flen);
+
+	int fails = 0;
+	for (int nthreads = 1 ; nthreads <= max_threads ; nthreads *= 2) {
+		double t0 = now();
+		ssize_t res = rle_block_compress(rle->compress_stream, rle->id, input, len, block_size, nthreads, frame, flen);
+		report("compress", nthreads, len, now() - t0);
+		fails += res != flen;
+
+		t0 = now();
+		res = rle_block_decompress(rle->parse_op, frame, flen, output, len, nthreads);
+		report("decompress", nthreads, len, now() - t0);
+		fails += res != (ssize_t)len || memcmp(input, output, len) != 0;
+	}
+
+	struct rle_block_variant variants[RLE_BLOCK_MAX_VARIANTS];
+	size_t nvariants = 0;
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		if (rle_variants[v].params && rle_variants[v].compress_stream && rle_variants[v].parse_op) {
+			struct rle_block_variant bv = { rle_variants[v].id, rle_variants[v].params, rle_variants[v].compress_stream, rle_variants[v].parse_op };
+			variants[nvariants++] = bv;
+		}
+	}
+	ssize_t alen = rle_block_compress_adaptive(variants, nvariants, input, len, block_size, max_threads, NULL, 0);
+	uint8_t *aframe = malloc(alen);
+	printf("adaptive (%zd bytes framed):\n", alen);
+	double t0 = now();
+	fails += rle_block_compress_adaptive(variants, nvariants, input, len, block_size, 1, aframe, alen) != alen;
+	report("compress", 1, len, now() - t0);
+	t0 = now();
+	ssize_t res = rle_block_decompress_adaptive(variants, nvariants, aframe, alen, output, len, 1);
+	report("decompress", 1, len, now() - t0);
+	fails += res != (ssize_t)len || memcmp(input, output, len) != 0;
+	free(aframe);
+
+	if (fails) {
+		printf("  %d runs failed!\n", fails);
+	}
+
+	free(frame);
+	free(output);
+	free(input);
+
+	return fails == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
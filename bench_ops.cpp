@@ -0,0 +1,112 @@
+/*
+	RLE Zoo OP Stream & Coroutine Decoder Benchmark
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Compares op_view and decode_chunks() from rle_zoo_ops.hpp against the C decoders.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+
+#include "rle_zoo_ops.hpp"
+
+#define CHUNK_SIZE 4096
+
+using c_fp = ssize_t (*)(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+using c_dstream_fp = ssize_t (*)(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen);
+
+// Stand-in for a consumer of decoded chunks.
+static uint64_t consume(const uint8_t *buf, size_t len) {
+	uint64_t sum = 0;
+	for (size_t i = 0 ; i < len ; ++i) {
+		sum += buf[i];
+	}
+	return sum;
+}
+
+template<typename F>
+static void run(const char *what, size_t bytes, F &&f) {
+	auto t0 = std::chrono::steady_clock::now();
+	uint64_t res = f();
+	std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+	printf("  %-24s %8.3f ms  %8.1f MiB/s  (%llu)\n", what, t.count() * 1e3, (double)bytes / (1024.0 * 1024.0) / t.count(), (unsigned long long)res);
+}
+
+template<typename V>
+static void bench(std::span<const uint8_t> input, c_fp c_compress, c_fp c_decompress, c_dstream_fp c_dstream) {
+	std::vector<uint8_t> comp(V::compress_bound(input.size()));
+	comp.resize((size_t)c_compress(input.data(), input.size(), comp.data(), comp.size()));
+	std::vector<uint8_t> out(input.size());
+	std::vector<uint8_t> chunk(CHUNK_SIZE);
+
+	printf("%s (%zu -> %zu bytes):\n", V::name, input.size(), comp.size());
+
+	run("C decompress size", input.size(), [&] {
+		return (uint64_t)c_decompress(comp.data(), comp.size(), NULL, 0);
+	});
+	run("op_view size", input.size(), [&] {
+		uint64_t len = 0;
+		for (const rle_zoo::op_record &rec : rle_zoo::op_view<typename V::traits>(comp)) {
+			len += rec.cnt;
+		}
+		return len;
+	});
+	run("C decompress", input.size(), [&] {
+		ssize_t len = c_decompress(comp.data(), comp.size(), out.data(), out.size());
+		return (uint64_t)consume(out.data(), (size_t)len);
+	});
+	run("C decompress_stream", input.size(), [&] {
+		struct rle_zoo_dstream ds;
+		rle_zoo_dstream_init(&ds);
+		uint64_t sum = 0;
+		size_t rp = 0;
+		for (;;) {
+			size_t consumed = 0;
+			ssize_t len = c_dstream(&ds, comp.data() + rp, comp.size() - rp, &consumed, chunk.data(), chunk.size());
+			rp += consumed;
+			if (len <= 0) {
+				break;
+			}
+			sum += consume(chunk.data(), (size_t)len);
+		}
+		return sum;
+	});
+	run("decode_chunks", input.size(), [&] {
+		uint64_t sum = 0;
+		for (std::span<const uint8_t> c : rle_zoo::decode_chunks<typename V::traits>(comp, chunk)) {
+			sum += consume(c.data(), c.size());
+		}
+		return sum;
+	});
+}
+
+int main(int argc, char *argv[]) {
+	size_t len = argc > 1 ? strtoull(argv[1], NULL, 10) : 64 * 1024 * 1024;
+
+	std::vector<uint8_t> input(len);
+	std::mt19937 rng(1234);
+	for (size_t i = 0 ; i < len ; ) {
+		size_t run = (rng() % 4 == 0) ? 1 + rng() % 200 : 1;
+		uint8_t val = (uint8_t)rng();
+		while (run-- && i < len) {
+			input[i++] = val;
+		}
+	}
+
+	bench<rle_zoo::goldbox>(input, goldbox_compress, goldbox_decompress, goldbox_decompress_stream);
+	bench<rle_zoo::packbits>(input, packbits_compress, packbits_decompress, packbits_decompress_stream);
+	bench<rle_zoo::pcx>(input, pcx_compress, pcx_decompress, pcx_decompress_stream);
+	bench<rle_zoo::icns>(input, icns_compress, icns_decompress, icns_decompress_stream);
+
+	return EXIT_SUCCESS;
+}
@@ -11,6 +11,11 @@
 #include "rle_packbits.h"
 #include "rle_pcx.h"
 #include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
 
 /* this lets the source compile without afl-clang-fast/lto */
 #ifndef __AFL_FUZZ_TESTCASE_LEN
@@ -59,6 +64,21 @@ int main(void) {
 
 		resc += icns_compress(input, len, dest, sizeof(dest));
 		resd += icns_decompress(input, len, dest, sizeof(dest));
+
+		resc += split_compress(input, len, dest, sizeof(dest));
+		resd += split_decompress(input, len, dest, sizeof(dest));
+
+		resc += longrun_compress(input, len, dest, sizeof(dest));
+		resd += longrun_decompress(input, len, dest, sizeof(dest));
+
+		resc += rlew_compress(input, len, dest, sizeof(dest));
+		resd += rlew_decompress(input, len, dest, sizeof(dest));
+
+		resc += nibble_compress(input, len, dest, sizeof(dest));
+		resd += nibble_decompress(input, len, dest, sizeof(dest));
+
+		resc += bitmask_compress(input, len, dest, sizeof(dest));
+		resd += bitmask_decompress(input, len, dest, sizeof(dest));
 	}
 	printf("resc=%zd, resd=%zd\n", resc, resd);
 	return 0;
@@ -8,7 +8,7 @@ OS=$1
 ARCH=${2:-`uname -m`}
 BP="packages/${OS}"
 RP="${BP}/${PROJECT}"
-FILES='rle-zoo rle-genops rle-parser rle_*.h LICENSE'
+FILES='rle-zoo rle-genops rle-parser rle-grep rle_*.h LICENSE'
 
 if [ -z "${VERSION}" ]; then
 	echo "Could not determine VERSION. Missing file or wrong directory?"
@@ -22,7 +22,7 @@ fi
 
 if [[ "${OS}" == "linux" || "${OS}" == "windows" ]]; then
 	echo "Packaging ${PROJECT} version ${VERSION} for ${OS}-${ARCH}"
-	OPTIMIZED=1 make -B rle-zoo rle-genops rle-parser
+	OPTIMIZED=1 make -B rle-zoo rle-genops rle-parser rle-grep
 	if [ $? -ne 0 ]; then
 		echo "Build failed, packaging aborted."
 		exit 1
@@ -0,0 +1,245 @@
+/*
+	Run-Length Encoded Data Pattern Search
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Searches for a byte pattern in the decoded data of compressed files, without
+	decoding them. Prints the decoded offset of each match.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_search.h"
+
+#include "rle-variant-selection.h"
+
+#include "build_const.h"
+
+static const char *variant;
+static const char *pattern;
+static int opt_hex = 0;
+static int opt_count = 0;
+static int opt_quiet = 0;
+static size_t opt_max = SIZE_MAX;
+static char **files;
+static int num_files;
+
+struct grep_ctx {
+	const char *filename;
+	size_t num;
+};
+
+static void print_banner(void) {
+	printf("rle-grep %s <%.*s>\n", build_version, 8, build_hash);
+}
+
+static void print_usage(const char *argv0) {
+	printf("Usage: %s -t variant [-x] [-c] [-q] [-m max] pattern file...\n", argv0);
+	printf("\noptions:\n");
+	printf("  -t\t\tcodec name\n");
+	printf("  -x\t\tpattern is hex, e.g 'deadbeef'\n");
+	printf("  -c\t\tonly print the number of matches per file\n");
+	printf("  -q\t\tquiet -- print nothing, exit status only\n");
+	printf("  -m\t\tstop after max matches per file\n");
+}
+
+static int parse_args(int argc, char **argv) {
+	files = calloc(argc, sizeof(char*));
+	for (int i = 1 ; i < argc ; ++i) {
+		const char *arg = argv[i];
+		// "argv[argc] shall be a null pointer", section 5.1.2.2.1
+		const char *value = argv[i+1];
+
+		if (*arg == '-' && arg[1] != '\0') {
+			++arg;
+			switch (*arg) {
+				case 't':
+					if (value) {
+						variant = value;
+						++i;
+					}
+					break;
+				case 'm':
+					if (value) {
+						opt_max = strtoull(value, NULL, 0);
+						++i;
+					}
+					break;
+				case 'x':
+					opt_hex = 1;
+					break;
+				case 'c':
+					opt_count = 1;
+					break;
+				case 'q':
+					opt_quiet = 1;
+					break;
+				case 'v':
+					/* fallthrough */
+				case 'V':
+					print_banner();
+					exit(0);
+				default:
+					fprintf(stderr, "Unknown option '-%s'\n", arg);
+					return 1;
+			}
+		} else if (!pattern) {
+			pattern = arg;
+		} else {
+			files[num_files++] = argv[i];
+		}
+	}
+
+	return 0;
+}
+
+// Parse a hex string into `dest`, ignoring whitespace. Returns the number of bytes, or -1 on error.
+static ssize_t parse_hex(const char *str, uint8_t *dest, size_t dlen) {
+	size_t n = 0;
+	int nibbles = 0;
+	unsigned int acc = 0;
+	for (const char *p = str ; *p ; ++p) {
+		if (isspace((unsigned char)*p)) {
+			continue;
+		}
+		if (!isxdigit((unsigned char)*p)) {
+			return -1;
+		}
+		acc = (acc << 4) | (unsigned int)(isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10);
+		if (++nibbles == 2) {
+			if (n == dlen) {
+				return -1;
+			}
+			dest[n++] = (uint8_t)acc;
+			nibbles = 0;
+			acc = 0;
+		}
+	}
+	return nibbles == 0 ? (ssize_t)n : -1;
+}
+
+static int print_match(void *ctx, size_t offset) {
+	struct grep_ctx *gc = ctx;
+	printf("%s:%zu\n", gc->filename, offset);
+	return ++gc->num >= opt_max;
+}
+
+static int count_match(void *ctx, size_t offset) {
+	(void)offset;
+	struct grep_ctx *gc = ctx;
+	return ++gc->num >= opt_max;
+}
+
+// Search `filename`. Returns the number of matches, or -1 on error.
+static ssize_t grep_file(struct rle_t *rle, const char *filename, const uint8_t *pat, size_t plen) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	size_t slen = (size_t)st.st_size;
+	uint8_t *src = mmap(NULL, slen, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (src == MAP_FAILED) {
+		fprintf(stderr, "%s: mmap: %s\n", filename, strerror(errno));
+		return -1;
+	}
+	madvise(src, slen, MADV_SEQUENTIAL);
+
+	struct grep_ctx gc = { filename, 0 };
+	rle_search_fp found = (opt_count || opt_quiet) ? count_match : print_match;
+	if (opt_quiet && opt_max == SIZE_MAX) {
+		opt_max = 1;
+	}
+	ssize_t res = rle_search(rle->parse_op, src, slen, pat, plen, found, &gc);
+	munmap(src, slen);
+
+	if (res < 0) {
+		fprintf(stderr, "%s: input error at offset %zd with variant '%s'\n", filename, ~res - 1, rle->name);
+		return -1;
+	}
+	if (opt_count && !opt_quiet) {
+		printf("%s:%zd\n", filename, res);
+	}
+	return res;
+}
+
+int main(int argc, char *argv []) {
+	if (parse_args(argc, argv) != 0 || !variant || !pattern || num_files == 0) {
+		print_banner();
+		print_usage(argv[0]);
+		print_variants();
+		return 2;
+	}
+
+	struct rle_t* rle = get_rle_by_name(variant);
+	if (!rle) {
+		print_variants();
+		fprintf(stderr, "ERROR: Unknown variant '%s'.\n", variant);
+		return 2;
+	}
+	if (!rle->parse_op) {
+		fprintf(stderr, "ERROR: Variant '%s' has no OP parser, and can't be searched.\n", variant);
+		return 2;
+	}
+
+	uint8_t pat[RLE_SEARCH_MAX_PATTERN];
+	ssize_t plen;
+	if (opt_hex) {
+		plen = parse_hex(pattern, pat, sizeof(pat));
+	} else {
+		plen = strlen(pattern) <= sizeof(pat) ? (ssize_t)strlen(pattern) : -1;
+		if (plen > 0) {
+			memcpy(pat, pattern, plen);
+		}
+	}
+	if (plen <= 0) {
+		fprintf(stderr, "ERROR: Pattern must be 1 to %d bytes%s.\n", RLE_SEARCH_MAX_PATTERN, opt_hex ? " of hex" : "");
+		return 2;
+	}
+
+	int matched = 0;
+	int failed = 0;
+	for (int i = 0 ; i < num_files ; ++i) {
+		ssize_t res = grep_file(rle, files[i], pat, (size_t)plen);
+		if (res < 0) {
+			failed = 1;
+		} else if (res > 0) {
+			matched = 1;
+		}
+	}
+	free(files);
+
+	// Same exit status as grep: 0 on any match, 1 if none, 2 on error.
+	return failed ? 2 : (matched ? 0 : 1);
+}
@@ -7,37 +7,120 @@
 #include <string.h>
 
 typedef ssize_t (*rle_fp)(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+typedef ssize_t (*rle_dstream_fp)(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen);
+typedef ssize_t (*rle_cstream_fp)(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final);
+typedef ssize_t (*rle_sink_fp)(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
 
 struct rle_t {
 	const char *name;
+	uint8_t id;		// Stable identifier for container formats. Zero is reserved for stored data.
 	rle_fp compress;
 	rle_fp decompress;
+	// The fields below are NULL where the variant doesn't support them.
+	rle_cstream_fp compress_stream;
+	rle_dstream_fp decompress_stream;
+	rle_sink_fp compress_to_sink;
+	rle_sink_fp decompress_to_sink;
+	rle_zoo_parse_op_fp parse_op;
+	const struct rle_zoo_params *params;
 } rle_variants[] = {
 	{
 		.name = "goldbox",
+		.id = 1,
 		.compress = goldbox_compress,
-		.decompress = goldbox_decompress
+		.decompress = goldbox_decompress,
+		.compress_stream = goldbox_compress_stream,
+		.decompress_stream = goldbox_decompress_stream,
+		.compress_to_sink = goldbox_compress_to_sink,
+		.decompress_to_sink = goldbox_decompress_to_sink,
+		.parse_op = goldbox_parse_op,
+		.params = &goldbox_params
 	},
 	{
 		.name = "packbits",
+		.id = 2,
 		.compress = packbits_compress,
-		.decompress = packbits_decompress
+		.decompress = packbits_decompress,
+		.compress_stream = packbits_compress_stream,
+		.decompress_stream = packbits_decompress_stream,
+		.compress_to_sink = packbits_compress_to_sink,
+		.decompress_to_sink = packbits_decompress_to_sink,
+		.parse_op = packbits_parse_op,
+		.params = &packbits_params
 	},
 	{
 		.name = "pcx",
+		.id = 3,
 		.compress = pcx_compress,
-		.decompress = pcx_decompress
+		.decompress = pcx_decompress,
+		.compress_stream = pcx_compress_stream,
+		.decompress_stream = pcx_decompress_stream,
+		.compress_to_sink = pcx_compress_to_sink,
+		.decompress_to_sink = pcx_decompress_to_sink,
+		.parse_op = pcx_parse_op,
+		.params = &pcx_params
 	},
 	{
 		.name = "icns",
+		.id = 4,
 		.compress = icns_compress,
-		.decompress = icns_decompress
+		.decompress = icns_decompress,
+		.compress_stream = icns_compress_stream,
+		.decompress_stream = icns_decompress_stream,
+		.compress_to_sink = icns_compress_to_sink,
+		.decompress_to_sink = icns_decompress_to_sink,
+		.parse_op = icns_parse_op,
+		.params = &icns_params
+	},
+	{
+		.name = "split",
+		.id = 5,
+		.compress = split_compress,
+		.decompress = split_decompress,
+		.compress_to_sink = split_compress_to_sink,
+		.decompress_to_sink = split_decompress_to_sink,
+	},
+	{
+		.name = "longrun",
+		.id = 6,
+		.compress = longrun_compress,
+		.decompress = longrun_decompress,
+		.compress_stream = longrun_compress_stream,
+		.decompress_stream = longrun_decompress_stream,
+		.compress_to_sink = longrun_compress_to_sink,
+		.decompress_to_sink = longrun_decompress_to_sink,
+		.parse_op = longrun_parse_op,
+		.params = &longrun_params
+	},
+	{
+		.name = "rlew",
+		.id = 7,
+		.compress = rlew_compress,
+		.decompress = rlew_decompress,
+		.compress_to_sink = rlew_compress_to_sink,
+		.decompress_to_sink = rlew_decompress_to_sink,
+	},
+	{
+		.name = "nibble",
+		.id = 8,
+		.compress = nibble_compress,
+		.decompress = nibble_decompress,
+		.compress_to_sink = nibble_compress_to_sink,
+		.decompress_to_sink = nibble_decompress_to_sink,
+	},
+	{
+		.name = "bitmask",
+		.id = 9,
+		.compress = bitmask_compress,
+		.decompress = bitmask_decompress,
+		.compress_to_sink = bitmask_compress_to_sink,
+		.decompress_to_sink = bitmask_decompress_to_sink,
 	},
 };
 
 static const size_t RLE_ZOO_NUM_VARIANTS = sizeof(rle_variants)/sizeof(rle_variants[0]);
 
-static struct rle_t* get_rle_by_name(const char *name) {
+static inline struct rle_t* get_rle_by_name(const char *name) {
 	for (size_t i = 0 ; i < RLE_ZOO_NUM_VARIANTS ; ++i) {
 		if (strcmp(name, rle_variants[i].name) == 0) {
 			return &rle_variants[i];
@@ -46,7 +129,16 @@ static struct rle_t* get_rle_by_name(const char *name) {
 	return NULL;
 }
 
-static void print_variants(void) {
+static inline struct rle_t* get_rle_by_id(uint8_t id) {
+	for (size_t i = 0 ; i < RLE_ZOO_NUM_VARIANTS ; ++i) {
+		if (id != 0 && id == rle_variants[i].id) {
+			return &rle_variants[i];
+		}
+	}
+	return NULL;
+}
+
+static inline void print_variants(void) {
 	printf("\nAvailable variants:\n");
 	struct rle_t *rle = rle_variants;
 	for (size_t i = 0 ; i < RLE_ZOO_NUM_VARIANTS ; ++i) {
@@ -11,12 +11,24 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #define RLE_ZOO_IMPLEMENTATION
 #include "rle_goldbox.h"
 #include "rle_packbits.h"
 #include "rle_pcx.h"
 #include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_crc.h"
+#include "rle_frame.h"
+#include "rle_block.h"
+#include "rle_cursor.h"
+#include "rle_index.h"
+#include "rle_archive.h"
 
 #include "rle-variant-selection.h"
 
@@ -26,6 +38,15 @@ static const char *infile;
 static const char *outfile;
 static const char *variant;
 static int compress = 0;
+static int raw = 0;
+static int nthreads = 1;
+static size_t block_size = RLE_BLOCK_DEFAULT_SIZE;
+static const char *command;
+static const char *indexfile;
+static const char *range;
+static size_t interval = RLE_INDEX_DEFAULT_INTERVAL;
+static const char **args;	// Positional arguments.
+static int nargs;
 
 static void print_banner(void) {
 	printf("rle-zoo %s <%.*s>\n", build_version, 8, build_hash);
@@ -33,14 +54,24 @@ static void print_banner(void) {
 
 static int parse_args(int argc, char **argv) {
 	// TODO: just use getopt.h?
+	args = calloc(argc, sizeof(*args));
 	for (int i=1 ; i < argc ; ++i) {
 		const char *arg = argv[i];
 		// "argv[argc] shall be a null pointer", section 5.1.2.2.1
 		const char *value = argv[i+1];
 
-		if (arg && *arg == '-') {
+		if (arg && *arg == '-' && arg[1] != '\0') {
 			++arg;
-			if (value) {
+			if (strcmp(arg, "-raw") == 0) {
+				raw = 1;
+			} else if (strcmp(arg, "-range") == 0 && value) {
+				range = value;
+				++i;
+			} else if (strcmp(arg, "-index") == 0 && value) {
+				indexfile = value;
+				++i;
+			} else if (value) {
+				++i;
 				switch (*arg) {
 					case 'c':
 						compress = 1;
@@ -58,6 +89,18 @@ static int parse_args(int argc, char **argv) {
 					case 't':
 						variant = value;
 						break;
+					case 'T':
+						nthreads = atoi(value);
+						break;
+					case 'B':
+						block_size = strtoull(value, NULL, 10);
+						break;
+					case 'I':
+						interval = strtoull(value, NULL, 10);
+						break;
+					default:
+						--i;
+						break;
 				}
 			} else {
 				if (*arg == 'v' || *arg == 'V' || strcmp(arg, "-version") == 0) {
@@ -65,97 +108,493 @@ static int parse_args(int argc, char **argv) {
 					exit(0);
 				}
 			}
+		} else if (arg) {
+			args[nargs++] = arg;
+		}
+	}
+
+	if (nargs > 0 && (strcmp(args[0], "index") == 0 || strcmp(args[0], "extract") == 0 || strcmp(args[0], "archive") == 0)) {
+		command = args[0];
+		if (nargs > 1 && strcmp(command, "archive") != 0) {
+			infile = args[1];
 		}
 	}
 
 	return 0;
 }
 
-static void rle_compress_file(const char *srcfile, const char *destfile, rle_fp compress_func) {
+static int file_sink(void *ctx, const uint8_t *buf, size_t len) {
+	return fwrite(buf, len, 1, (FILE*)ctx) == 1 ? 0 : 1;
+}
+
+// Read all of `srcfile`. Returns NULL on error, or if the file is empty.
+static uint8_t *read_file(const char *srcfile, size_t *len) {
 	FILE *ifile = fopen(srcfile, "rb");
 
 	if (!ifile) {
 		fprintf(stderr, "Error: %s\n", strerror(errno));
-		return;
+		return NULL;
 	}
 	fseek(ifile, 0, SEEK_END);
 	long slen = ftell(ifile);
 	fseek(ifile, 0, SEEK_SET);
 
-	printf("Compressing %ld bytes.\n", slen);
-	assert(slen > 0);
-
-	FILE *ofile = fopen(destfile, "wb");
-	if (ofile) {
-		uint8_t *src = malloc(slen);
+	uint8_t *src = NULL;
+	if (slen > 0) {
+		src = malloc(slen);
 		if ((fread(src, slen, 1, ifile) != 1) && (ferror(ifile) != 0)) {
 			fprintf(stderr, "%s: fread: %s: %s", __FILE__, srcfile, strerror(errno));
 			exit(EXIT_FAILURE);
 		}
+	}
+	fclose(ifile);
 
-		ssize_t clen = compress_func(src, slen, NULL, 0);
-		if (clen >= 0) {
-			uint8_t *dest = malloc(clen);
-			clen = compress_func(src, slen, dest, clen);
+	*len = (size_t)(slen > 0 ? slen : 0);
+	return src;
+}
+
+static FILE *open_output(const char *destfile) {
+	FILE *ofile = stdout;
+	if (strcmp(destfile, "-") != 0) {
+		ofile = fopen(destfile, "wb");
+	}
+	if (!ofile) {
+		fprintf(stderr, "Error: %s\n", strerror(errno));
+	}
+	return ofile;
+}
 
-			fwrite(dest, clen, 1, ofile);
+// Fill in the variants that support blocks, for adaptive frames to pick from. Returns their number.
+static size_t get_block_variants(struct rle_block_variant variants[RLE_BLOCK_MAX_VARIANTS]) {
+	size_t num = 0;
+	for (size_t i = 0 ; i < RLE_ZOO_NUM_VARIANTS ; ++i) {
+		if (rle_variants[i].params && rle_variants[i].compress_stream && rle_variants[i].parse_op) {
+			struct rle_block_variant v = { rle_variants[i].id, rle_variants[i].params, rle_variants[i].compress_stream, rle_variants[i].parse_op };
+			variants[num++] = v;
+		}
+	}
+	return num;
+}
+
+// Encode the payload of a plain frame, with the CRC of the input computed on the way where the variant can stream.
+static ssize_t frame_compress(struct rle_t *rle, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, uint32_t *crc) {
+	uint32_t out_crc;
+	if (rle->compress_stream) {
+		return rle_crc_compress(rle->compress_stream, src, slen, dest, dlen, &out_crc, crc);
+	}
+	ssize_t res = rle->compress(src, slen, dest, dlen);
+	if (res >= 0 && crc) {
+		*crc = rle_crc32c(0, src, slen);
+	}
+	return res;
+}
+
+// The libraries behind indexes and archives need an OP parser.
+static int check_parse_op(const struct rle_t *rle) {
+	if (rle && !rle->parse_op) {
+		fprintf(stderr, "ERROR: Variant '%s' has no OP parser, and can't be used with indexes or archives.\n", rle->name);
+		return -1;
+	}
+	return 0;
+}
 
+// Encode block-framed, or adaptively from all variants without `rle`.
+static ssize_t block_compress(struct rle_t *rle, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	if (rle) {
+		return rle_block_compress(rle->compress_stream, rle->id, src, slen, block_size, nthreads, dest, dlen);
+	}
+	struct rle_block_variant variants[RLE_BLOCK_MAX_VARIANTS];
+	size_t nvariants = get_block_variants(variants);
+	return rle_block_compress_adaptive(variants, nvariants, src, slen, block_size, nthreads, dest, dlen);
+}
+
+static void rle_compress_file(const char *srcfile, const char *destfile, struct rle_t *rle) {
+	size_t slen;
+	uint8_t *src = read_file(srcfile, &slen);
+	if (!src) {
+		return;
+	}
+
+	printf("Compressing %zu bytes.\n", slen);
+
+	FILE *ofile = open_output(destfile);
+	if (ofile) {
+		ssize_t clen;
+		if (raw) {
+			clen = rle->compress_to_sink(src, slen, file_sink, ofile);
+		} else if (!rle || (slen > block_size && rle->compress_stream && rle->parse_op)) {
+			// Split into blocks encoded in parallel. The output is the same for any number of threads.
+			size_t nblocks = (slen + block_size - 1) / block_size;
+			size_t cap = RLE_FRAME_HEADER_SIZE + 4 + nblocks * (RLE_FRAME_BLOCK_ENTRY_SIZE + 16) + 2 * slen;
+			uint8_t *dest = malloc(cap);
+			clen = block_compress(rle, src, slen, dest, cap);
+			if (clen < 0) {
+				cap = (size_t)block_compress(rle, src, slen, NULL, 0);
+				dest = realloc(dest, cap);
+				clen = block_compress(rle, src, slen, dest, cap);
+			}
+			if (clen >= 0) {
+				printf("Encoded %zu blocks of up to %zu bytes.\n", nblocks, block_size);
+				if (fwrite(dest, clen, 1, ofile) != 1) {
+					fprintf(stderr, "Error: %s\n", strerror(errno));
+				}
+			}
+			free(dest);
+		} else {
+			// Encode into memory with the CRC of the input computed on the way, so the header can go first.
+			// No variant expands by more than 2x, but size exactly if that proves wrong.
+			struct rle_frame_header hdr = { .variant = rle->id, .flags = RLE_FRAME_FLAG_CRC, .decoded_size = slen };
+			size_t cap = 2 * slen + 16;
+			uint8_t *dest = malloc(RLE_FRAME_HEADER_SIZE + cap);
+			clen = frame_compress(rle, src, slen, dest + RLE_FRAME_HEADER_SIZE, cap, &hdr.crc);
+			if (clen < 0) {
+				cap = (size_t)frame_compress(rle, src, slen, NULL, 0, NULL);
+				dest = realloc(dest, RLE_FRAME_HEADER_SIZE + cap);
+				clen = frame_compress(rle, src, slen, dest + RLE_FRAME_HEADER_SIZE, cap, &hdr.crc);
+			}
+			if (clen >= 0) {
+				hdr.compressed_size = (size_t)clen;
+				rle_frame_write_header(&hdr, dest);
+				clen += RLE_FRAME_HEADER_SIZE;
+				if (fwrite(dest, clen, 1, ofile) != 1) {
+					fprintf(stderr, "Error: %s\n", strerror(errno));
+				}
+			}
+			free(dest);
+		}
+		if (clen >= 0) {
 			printf("%zd bytes written to output.\n", clen);
 		} else {
 			printf("Compression error: %zd\n", clen);
 		}
 
-		fclose(ofile);
+		if (ofile != stdout) {
+			fclose(ofile);
+		}
+	}
+	free(src);
+}
+
+static void rle_decompress_file(const char *srcfile, const char *destfile, struct rle_t *rle) {
+	size_t slen;
+	uint8_t *src = read_file(srcfile, &slen);
+	if (!src) {
+		return;
+	}
+
+	printf("Decompressing %zu bytes.\n", slen);
+
+	struct rle_frame_header hdr;
+	if (!raw) {
+		ssize_t res = rle_frame_read_header(src, slen, &hdr);
+		if (res < 0) {
+			fprintf(stderr, "ERROR: %s.\n", res == -1 ? "Not a framed stream, use --raw for raw streams" : "Unsupported or truncated frame");
+			free(src);
+			return;
+		}
+		// Adaptive frames record a variant per block, and any of them can be decoded.
+		struct rle_t *frame_rle = get_rle_by_id(hdr.variant);
+		if ((!frame_rle && !(hdr.flags & RLE_FRAME_FLAG_ADAPTIVE)) || (rle && rle != frame_rle)) {
+			fprintf(stderr, "ERROR: Frame variant id %d does not match '%s'.\n", hdr.variant, rle ? rle->name : "any known variant");
+			free(src);
+			return;
+		}
+		rle = frame_rle;
+		printf("Frame of variant '%s', %" PRIu64 " bytes decoded%s.\n", rle ? rle->name : "auto", hdr.decoded_size, (hdr.flags & RLE_FRAME_FLAG_BLOCKS) ? " in blocks" : "");
+	}
+
+	FILE *ofile = open_output(destfile);
+	if (ofile) {
+		ssize_t dlen;
+		if (raw) {
+			dlen = rle->decompress_to_sink(src, slen, file_sink, ofile);
+		} else {
+			// The decoded size is known, so allocate once and decode in a single pass, with blocks in parallel.
+			uint8_t *dest = malloc(hdr.decoded_size + 1);
+			if (!dest) {
+				fprintf(stderr, "ERROR: Can't allocate %" PRIu64 " bytes for the decoded frame.\n", hdr.decoded_size);
+				dlen = -1;
+			} else if (rle && !rle->parse_op && !(hdr.flags & RLE_FRAME_FLAG_BLOCKS)) {
+				// Without an OP parser, decode in one shot and check the result after.
+				dlen = rle->decompress(src + RLE_FRAME_HEADER_SIZE, hdr.compressed_size, dest, hdr.decoded_size);
+				if (dlen >= 0 && ((uint64_t)dlen != hdr.decoded_size || ((hdr.flags & RLE_FRAME_FLAG_CRC) && rle_crc32c(0, dest, dlen) != hdr.crc))) {
+					dlen = -1;
+				}
+			} else {
+				struct rle_block_variant variants[RLE_BLOCK_MAX_VARIANTS];
+				size_t nvariants = get_block_variants(variants);
+				dlen = rle_block_decompress_adaptive(variants, nvariants, src, slen, dest, hdr.decoded_size, nthreads);
+			}
+			if (dlen == -1 && dest) {
+				fprintf(stderr, "ERROR: Corrupt frame, size or checksum mismatch.\n");
+			}
+			if (dlen >= 0 && fwrite(dest, dlen, 1, ofile) != 1 && dlen > 0) {
+				fprintf(stderr, "Error: %s\n", strerror(errno));
+			}
+			free(dest);
+		}
+		if (dlen >= 0) {
+			printf("%zd bytes written to output.\n", dlen);
+		} else {
+			printf("Decompression error: %zd\n", dlen);
+		}
+
+		if (ofile != stdout) {
+			fclose(ofile);
+		}
+	}
+	free(src);
+}
+
+// Build a checkpoint index of a raw stream, written to a sidecar file.
+static void rle_index_file(const char *srcfile, const char *destfile, struct rle_t *rle) {
+	size_t slen;
+	uint8_t *src = read_file(srcfile, &slen);
+	if (!src) {
+		return;
+	}
+
+	struct rle_index idx = { .variant = rle->id, .interval = interval, .compressed_size = slen };
+	ssize_t res = rle_cursor_index(rle->parse_op, src, slen, interval, NULL, 0, &idx.num);
+	if (res < 0) {
+		fprintf(stderr, "ERROR: Malformed stream, error %zd.\n", res);
 		free(src);
-	} else {
-		fprintf(stderr, "Error: %s\n", strerror(errno));
+		return;
 	}
-	fclose(ifile);
+	struct rle_cursor_checkpoint *cps = malloc((idx.num + 1) * sizeof(*cps));
+	idx.decoded_size = (size_t)rle_cursor_index(rle->parse_op, src, slen, interval, cps, idx.num, &idx.num);
+	idx.checkpoints = cps;
+
+	size_t ilen = rle_index_size(idx.num);
+	uint8_t *buf = malloc(ilen);
+	rle_index_write(&idx, buf);
+
+	FILE *ofile = open_output(destfile);
+	if (ofile) {
+		if (fwrite(buf, ilen, 1, ofile) != 1) {
+			fprintf(stderr, "Error: %s\n", strerror(errno));
+		} else {
+			printf("Indexed %zu decoded bytes with %zu checkpoints, %zu bytes written to output.\n", idx.decoded_size, idx.num, ilen);
+		}
+		if (ofile != stdout) {
+			fclose(ofile);
+		}
+	}
+
+	free(buf);
+	free(cps);
+	free(src);
 }
 
-static void rle_decompress_file(const char *srcfile, const char *destfile, rle_fp decompress_func) {
-	FILE *ifile = fopen(srcfile, "rb");
+// Decode the window `range` of a raw stream, using its sidecar index to start close to it.
+static void rle_extract_file(const char *srcfile, const char *idxfile, const char *destfile, struct rle_t *rle) {
+	char *end;
+	size_t offset = strtoull(range, &end, 10);
+	size_t len = *end == ':' ? strtoull(end + 1, &end, 10) : 0;
+	if (*end != '\0' || len == 0) {
+		fprintf(stderr, "ERROR: Expected a range of the form offset:length, got '%s'.\n", range);
+		return;
+	}
 
-	if (!ifile) {
-		fprintf(stderr, "Error: %s\n", strerror(errno));
+	size_t ilen;
+	uint8_t *ibuf = read_file(idxfile, &ilen);
+	if (!ibuf) {
 		return;
 	}
-	fseek(ifile, 0, SEEK_END);
-	long slen = ftell(ifile);
-	fseek(ifile, 0, SEEK_SET);
+	struct rle_index idx;
+	ssize_t res = rle_index_read(ibuf, ilen, &idx, NULL, 0);
+	struct rle_t *idx_rle = res >= 0 ? get_rle_by_id(idx.variant) : NULL;
+	if (!idx_rle || !idx_rle->parse_op || (rle && rle != idx_rle)) {
+		fprintf(stderr, "ERROR: Invalid index '%s', or its variant does not match.\n", idxfile);
+		free(ibuf);
+		return;
+	}
+	struct rle_cursor_checkpoint *cps = malloc((idx.num + 1) * sizeof(*cps));
+	if (!cps || rle_index_read(ibuf, ilen, &idx, cps, idx.num) < 0) {
+		fprintf(stderr, "ERROR: Can't read index '%s'.\n", idxfile);
+		free(cps);
+		free(ibuf);
+		return;
+	}
+	free(ibuf);
 
-	if (slen > 0) {
-		printf("Decompressing %ld bytes.\n", slen);
-		FILE *ofile = stdout;
-		if (strcmp(destfile, "-") != 0) {
-			ofile = fopen(destfile, "wb");
-		}
-		if (ofile) {
-			uint8_t *src = malloc(slen);
-			if ((fread(src, slen, 1, ifile) != 1) && (ferror(ifile) != 0)) {
-				fprintf(stderr, "%s: fread: %s: %s", __FILE__, srcfile, strerror(errno));
-				exit(EXIT_FAILURE);
+	size_t slen;
+	uint8_t *src = read_file(srcfile, &slen);
+	uint8_t *dest = malloc(len);
+	if (src && dest) {
+		res = rle_index_extract(idx_rle->parse_op, &idx, src, slen, offset, dest, len);
+		if (res == -1) {
+			fprintf(stderr, "ERROR: Index '%s' does not match '%s'.\n", idxfile, srcfile);
+		} else if (res < 0) {
+			printf("Decompression error: %zd\n", res);
+		} else {
+			FILE *ofile = open_output(destfile);
+			if (ofile) {
+				if (res > 0 && fwrite(dest, res, 1, ofile) != 1) {
+					fprintf(stderr, "Error: %s\n", strerror(errno));
+				}
+				printf("%zd bytes written to output.\n", res);
+				if (ofile != stdout) {
+					fclose(ofile);
+				}
 			}
+		}
+	}
+
+	free(dest);
+	free(src);
+	free(cps);
+}
 
-			ssize_t dlen = decompress_func(src, slen, NULL, 0);
-			if (dlen >= 0) {
-				uint8_t *dest = malloc(dlen);
-				dlen = decompress_func(src, slen, dest, dlen);
+// Compress all of `src` into a new buffer, setting `clen` to its size and `crc` to the CRC32C of `src`.
+// Returns NULL if out of memory.
+static uint8_t *compress_alloc(struct rle_t *rle, const uint8_t *src, size_t slen, size_t *clen, uint32_t *crc) {
+	size_t cap = 2 * slen + 16;
+	uint8_t *dest = malloc(cap);
+	if (!dest) {
+		return NULL;
+	}
+	uint32_t out_crc;
+	ssize_t res = rle_crc_compress(rle->compress_stream, src, slen, dest, cap, &out_crc, crc);
+	if (res < 0) {
+		cap = (size_t)rle_crc_compress(rle->compress_stream, src, slen, NULL, 0, &out_crc, NULL);
+		uint8_t *tmp = realloc(dest, cap);
+		if (!tmp) {
+			free(dest);
+			return NULL;
+		}
+		dest = tmp;
+		res = rle_crc_compress(rle->compress_stream, src, slen, dest, cap, &out_crc, crc);
+	}
+	if (res < 0) {
+		free(dest);
+		return NULL;
+	}
+	*clen = (size_t)res;
+	return dest;
+}
 
-				fwrite(dest, dlen, 1, ofile);
+// Compress each of `files` into an archive, named by their paths.
+static int rle_archive_create(const char *destfile, const char **files, int nfiles, struct rle_t *rle) {
+	struct rle_archive_input *inputs = calloc(nfiles > 0 ? nfiles : 1, sizeof(*inputs));
+	uint8_t **bufs = calloc(nfiles > 0 ? nfiles : 1, sizeof(*bufs));
+	int retval = EXIT_FAILURE;
+	int n = 0;
+	for ( ; n < nfiles ; ++n) {
+		size_t slen = SIZE_MAX;
+		uint8_t *src = read_file(files[n], &slen);
+		if (!src && slen != 0) {
+			break;
+		}
+		struct rle_archive_input *in = &inputs[n];
+		in->name = files[n];
+		in->name_len = strlen(files[n]);
+		in->variant = rle->id;
+		in->decoded_size = slen;
+		bufs[n] = compress_alloc(rle, src, slen, &in->compressed_size, &in->crc);
+		in->data = bufs[n];
+		free(src);
+		if (!bufs[n]) {
+			fprintf(stderr, "ERROR: Can't allocate memory to compress '%s'.\n", files[n]);
+			break;
+		}
+	}
 
-				printf("%zd bytes written to output.\n", dlen);
-			} else {
-				printf("Decompression error: %zd\n", dlen);
+	if (n == nfiles) {
+		ssize_t alen = rle_archive_write(inputs, nfiles, NULL, 0);
+		uint8_t *buf = alen >= 0 ? malloc(alen) : NULL;
+		if (alen == -2) {
+			fprintf(stderr, "ERROR: Duplicate or overlong entry names.\n");
+		} else if (buf && rle_archive_write(inputs, nfiles, buf, alen) == alen) {
+			FILE *ofile = open_output(destfile);
+			if (ofile) {
+				if (fwrite(buf, alen, 1, ofile) != 1) {
+					fprintf(stderr, "Error: %s\n", strerror(errno));
+				} else {
+					printf("Archived %d entries, %zd bytes written to output.\n", nfiles, alen);
+					retval = EXIT_SUCCESS;
+				}
+				if (ofile != stdout) {
+					fclose(ofile);
+				}
 			}
+		}
+		free(buf);
+	}
 
-			fclose(ofile);
-			free(src);
+	for (int i = 0 ; i < n ; ++i) {
+		free(bufs[i]);
+	}
+	free(bufs);
+	free(inputs);
+	return retval;
+}
+
+static int rle_archive_list(const char *srcfile) {
+	size_t slen;
+	uint8_t *src = read_file(srcfile, &slen);
+	struct rle_archive ar;
+	if (!src || rle_archive_open(&ar, src, slen) != 0) {
+		fprintf(stderr, "ERROR: Not an archive, or truncated.\n");
+		free(src);
+		return EXIT_FAILURE;
+	}
+	printf("%-10s %12s %12s %8s  %s\n", "variant", "decoded", "compressed", "crc", "name");
+	for (size_t i = 0 ; i < ar.num ; ++i) {
+		struct rle_archive_entry e;
+		if (rle_archive_get(&ar, i, &e) != 0) {
+			fprintf(stderr, "ERROR: Entry %zu is corrupt.\n", i);
+			break;
+		}
+		struct rle_t *rle = get_rle_by_id(e.variant);
+		printf("%-10s %12zu %12zu %08x  %.*s\n", rle ? rle->name : "?", e.decoded_size, e.compressed_size, e.crc, (int)e.name_len, e.name);
+	}
+	free(src);
+	return EXIT_SUCCESS;
+}
+
+static int rle_archive_extract(const char *srcfile, const char *name, const char *destfile) {
+	size_t slen;
+	uint8_t *src = read_file(srcfile, &slen);
+	struct rle_archive ar;
+	if (!src || rle_archive_open(&ar, src, slen) != 0) {
+		fprintf(stderr, "ERROR: Not an archive, or truncated.\n");
+		free(src);
+		return EXIT_FAILURE;
+	}
+	int retval = EXIT_FAILURE;
+	struct rle_archive_entry e;
+	struct rle_t *rle = NULL;
+	ssize_t pos = rle_archive_find(&ar, name, strlen(name), &e);
+	if (pos == -2) {
+		fprintf(stderr, "ERROR: Entry '%s' is corrupt.\n", name);
+	} else if (pos < 0 || !(rle = get_rle_by_id(e.variant)) || !rle->parse_op) {
+		fprintf(stderr, "ERROR: No entry '%s', or of unknown variant.\n", name);
+	} else {
+		uint8_t *dest = malloc(e.decoded_size + 1);
+		ssize_t res = dest ? rle_archive_decompress(rle->parse_op, &e, dest, e.decoded_size) : -1;
+		if (!dest) {
+			fprintf(stderr, "ERROR: Can't allocate %zu bytes for entry '%s'.\n", e.decoded_size, name);
+		} else if (res < 0) {
+			printf("Decompression error: %zd\n", res);
 		} else {
-			fprintf(stderr, "Error: %s\n", strerror(errno));
+			FILE *ofile = open_output(destfile);
+			if (ofile) {
+				if (res > 0 && fwrite(dest, res, 1, ofile) != 1) {
+					fprintf(stderr, "Error: %s\n", strerror(errno));
+				} else {
+					printf("%zd bytes written to output.\n", res);
+					retval = EXIT_SUCCESS;
+				}
+				if (ofile != stdout) {
+					fclose(ofile);
+				}
+			}
 		}
+		free(dest);
 	}
-	fclose(ifile);
+	free(src);
+	return retval;
 }
 
 int main(int argc, char *argv []) {
@@ -164,25 +603,100 @@ int main(int argc, char *argv []) {
 
 	print_banner();
 
-	if (!infile || !outfile || !variant) {
-		printf("Usage: %s -t variant -c file|-d file -o outfile\n", argv[0]);
+	if (command && strcmp(command, "archive") == 0) {
+		const char *sub = nargs > 1 ? args[1] : "";
+		struct rle_t *rle = variant ? get_rle_by_name(variant) : NULL;
+		if (check_parse_op(rle) != 0) {
+			return EXIT_FAILURE;
+		}
+		int res = -1;
+		if (strcmp(sub, "create") == 0 && rle && outfile) {
+			res = rle_archive_create(outfile, args + 2, nargs - 2, rle);
+		} else if (strcmp(sub, "list") == 0 && nargs == 3) {
+			res = rle_archive_list(args[2]);
+		} else if (strcmp(sub, "extract") == 0 && nargs == 4 && outfile) {
+			res = rle_archive_extract(args[2], args[3], outfile);
+		}
+		if (res < 0) {
+			printf("Usage: %s archive create -t variant -o archive file...\n", argv[0]);
+			printf("       %s archive list archive\n", argv[0]);
+			printf("       %s archive extract archive name -o outfile\n", argv[0]);
+			print_variants();
+			res = EXIT_SUCCESS;
+		}
+		return res;
+	}
+
+	// Sidecar indexes default to the name of the stream plus ".idx".
+	char *default_index = NULL;
+	if (command && infile && !(strcmp(command, "index") == 0 ? outfile : indexfile)) {
+		default_index = malloc(strlen(infile) + 5);
+		sprintf(default_index, "%s.idx", infile);
+		if (strcmp(command, "index") == 0) {
+			outfile = default_index;
+		} else {
+			indexfile = default_index;
+		}
+	}
+
+	// Framed streams and indexes record their variant, so it's only needed to compress, to decompress raw streams, and to index.
+	int is_index = command && strcmp(command, "index") == 0;
+	int is_extract = command && strcmp(command, "extract") == 0;
+	if (!infile || !outfile || (!variant && (compress || raw || is_index)) || (is_extract && !range)) {
+		printf("Usage: %s [--raw] [-t variant|auto] [-T threads] [-B block_size] -c file|-d file -o outfile\n", argv[0]);
+		printf("       %s index -t variant [-I interval] file [-o indexfile]\n", argv[0]);
+		printf("       %s extract --range offset:length [--index indexfile] file -o outfile\n", argv[0]);
+		printf("       %s archive create|list|extract ...\n", argv[0]);
 		print_variants();
+		free(default_index);
 		return EXIT_SUCCESS;
 	}
 
-	struct rle_t* rle = get_rle_by_name(variant);
-	if (!rle) {
-		print_variants();
-		fprintf(stderr, "ERROR: Unknown variant '%s'.\n", variant);
+	if (block_size == 0 || block_size > RLE_BLOCK_MAX_SIZE || interval == 0) {
+		fprintf(stderr, "ERROR: Block size must be between 1 and %d bytes, and the index interval at least 1.\n", RLE_BLOCK_MAX_SIZE);
+		free(default_index);
 		return EXIT_FAILURE;
 	}
 
-	printf("rle-zoo %s file '%s' with variant '%s'\n", compress ? "compressing" : "decompressing", infile, rle->name);
+	// The 'auto' variant picks one per block, and is only available to framed streams.
+	struct rle_t* rle = NULL;
+	if (variant && !(strcmp(variant, "auto") == 0 && !raw && !command)) {
+		rle = get_rle_by_name(variant);
+		if (!rle) {
+			print_variants();
+			fprintf(stderr, "ERROR: Unknown variant '%s'.\n", variant);
+			free(default_index);
+			return EXIT_FAILURE;
+		}
+	}
+	if ((is_index || is_extract) && check_parse_op(rle) != 0) {
+		free(default_index);
+		return EXIT_FAILURE;
+	}
+
+	if (is_index) {
+		printf("rle-zoo indexing raw file '%s' with variant '%s' every %zu bytes into '%s'\n", infile, rle->name, interval, outfile);
+		rle_index_file(infile, outfile, rle);
+		free(default_index);
+		return EXIT_SUCCESS;
+	} else if (is_extract) {
+		printf("rle-zoo extracting range %s of raw file '%s' using index '%s'\n", range, infile, indexfile);
+		rle_extract_file(infile, indexfile, outfile, rle);
+		free(default_index);
+		return EXIT_SUCCESS;
+	}
+
+	printf("rle-zoo %s %s file '%s'", compress ? "compressing" : "decompressing", raw ? "raw" : "framed", infile);
+	if (variant) {
+		printf(" with variant '%s'", rle ? rle->name : variant);
+	}
+	printf("\n");
 	if (compress) {
-		rle_compress_file(infile, outfile, rle->compress);
+		rle_compress_file(infile, outfile, rle);
 	} else {
-		rle_decompress_file(infile, outfile, rle->decompress);
+		rle_decompress_file(infile, outfile, rle);
 	}
+	free(default_index);
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,297 @@
+/*
+	Multi-Entry Archives of Run-Length Encoded (RLE) Streams
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Packs many small compressed streams into one file with a fixed-width index sorted by
+	name hash, laid out to be used in place, e.g from a read-only mmap(2). Opening checks
+	only the header, and looking up an entry is a binary search over the index followed by
+	a single decode, without any allocations or system calls.
+
+	All fields are little-endian:
+
+		offset  size  field
+		0       4     magic, "RLEA"
+		4       1     version, 1
+		5       3     reserved, 0
+		8       8     number of entries, N
+		16      8     size of the archive
+		24      8     reserved, 0
+		32      48*N  index, sorted by name hash, then name:
+		              0   8  64-bit FNV-1a hash of the name
+		              8   8  offset of the compressed data
+		              16  8  compressed size
+		              24  8  decoded size
+		              32  8  offset of the name
+		              40  2  length of the name
+		              42  1  variant id
+		              43  1  reserved, 0
+		              44  4  CRC32C of the decoded data
+
+	followed by the names, and then the compressed data of each entry.
+
+	Include one or more of the rle_<variant>.h headers, and rle_crc.h, first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_archive.h"
+#endif
+
+#define RLE_ARCHIVE_HEADER_SIZE 32
+#define RLE_ARCHIVE_ENTRY_SIZE 48
+#define RLE_ARCHIVE_VERSION 1
+#define RLE_ARCHIVE_MAX_NAME 65535
+
+struct rle_archive {
+	const uint8_t *base;
+	size_t len;
+	size_t num;
+};
+
+struct rle_archive_entry {
+	uint64_t hash;
+	const char *name;		// Not NUL-terminated.
+	size_t name_len;
+	uint8_t variant;
+	const uint8_t *data;
+	size_t compressed_size;
+	size_t decoded_size;
+	uint32_t crc;
+};
+
+// An entry to be written by rle_archive_write(), already compressed.
+struct rle_archive_input {
+	const char *name;
+	size_t name_len;
+	uint8_t variant;
+	const uint8_t *data;
+	size_t compressed_size;
+	size_t decoded_size;
+	uint32_t crc;
+};
+
+uint64_t rle_archive_hash(const char *name, size_t len);
+ssize_t rle_archive_write(const struct rle_archive_input *inputs, size_t num, uint8_t *dest, size_t dlen);
+int rle_archive_open(struct rle_archive *ar, const uint8_t *base, size_t len);
+int rle_archive_get(const struct rle_archive *ar, size_t i, struct rle_archive_entry *entry);
+ssize_t rle_archive_find(const struct rle_archive *ar, const char *name, size_t name_len, struct rle_archive_entry *entry);
+ssize_t rle_archive_decompress(rle_zoo_parse_op_fp parse_op, const struct rle_archive_entry *entry, uint8_t *dest, size_t dlen);
+
+#if defined(RLE_ZOO_ARCHIVE_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t rle_archive_magic[4] = { 'R', 'L', 'E', 'A' };
+
+static void rle_archive_put_le(uint8_t *dest, uint64_t v, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		dest[i] = (uint8_t)(v >> (8 * i));
+	}
+}
+
+static uint64_t rle_archive_get_le(const uint8_t *src, size_t n) {
+	uint64_t v = 0;
+	for (size_t i = 0 ; i < n ; ++i) {
+		v |= (uint64_t)src[i] << (8 * i);
+	}
+	return v;
+}
+
+// Returns the 64-bit FNV-1a hash of `name`, which the index is sorted by.
+uint64_t rle_archive_hash(const char *name, size_t len) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (size_t i = 0 ; i < len ; ++i) {
+		h ^= (uint8_t)name[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static int rle_archive_cmp(uint64_t ha, const char *a, size_t alen, uint64_t hb, const char *b, size_t blen) {
+	if (ha != hb) {
+		return ha < hb ? -1 : 1;
+	}
+	int res = memcmp(a, b, alen < blen ? alen : blen);
+	if (res != 0) {
+		return res;
+	}
+	return alen < blen ? -1 : (alen > blen);
+}
+
+struct rle_archive_sort_item {
+	uint64_t hash;
+	const struct rle_archive_input *in;
+};
+
+static int rle_archive_sort_cmp(const void *a, const void *b) {
+	const struct rle_archive_sort_item *ia = a;
+	const struct rle_archive_sort_item *ib = b;
+	return rle_archive_cmp(ia->hash, ia->in->name, ia->in->name_len, ib->hash, ib->in->name, ib->in->name_len);
+}
+
+// Write an archive of the `num` entries in `inputs` into `dest`, which has room for `dlen` bytes. If `dest`
+// is NULL, nothing is written. Returns the size of the archive, -1 if `dest` is too small or memory can't
+// be allocated, or -2 if names are duplicated or longer than RLE_ARCHIVE_MAX_NAME.
+ssize_t rle_archive_write(const struct rle_archive_input *inputs, size_t num, uint8_t *dest, size_t dlen) {
+	size_t names_len = 0;
+	size_t data_len = 0;
+	for (size_t i = 0 ; i < num ; ++i) {
+		if (inputs[i].name_len > RLE_ARCHIVE_MAX_NAME) {
+			return -2;
+		}
+		names_len += inputs[i].name_len;
+		data_len += inputs[i].compressed_size;
+	}
+	size_t names_ofs = RLE_ARCHIVE_HEADER_SIZE + num * RLE_ARCHIVE_ENTRY_SIZE;
+	size_t total = names_ofs + names_len + data_len;
+	if (dest && total > dlen) {
+		return -1;
+	}
+
+	struct rle_archive_sort_item *items = malloc((num ? num : 1) * sizeof(*items));
+	if (!items) {
+		return -1;
+	}
+	for (size_t i = 0 ; i < num ; ++i) {
+		items[i].hash = rle_archive_hash(inputs[i].name, inputs[i].name_len);
+		items[i].in = &inputs[i];
+	}
+	qsort(items, num, sizeof(*items), rle_archive_sort_cmp);
+	for (size_t i = 1 ; i < num ; ++i) {
+		if (rle_archive_sort_cmp(&items[i - 1], &items[i]) == 0) {
+			free(items);
+			return -2;
+		}
+	}
+
+	if (dest) {
+		memcpy(dest, rle_archive_magic, sizeof(rle_archive_magic));
+		memset(dest + 4, 0, RLE_ARCHIVE_HEADER_SIZE - 4);
+		dest[4] = RLE_ARCHIVE_VERSION;
+		rle_archive_put_le(dest + 8, num, 8);
+		rle_archive_put_le(dest + 16, total, 8);
+
+		size_t name_wp = names_ofs;
+		size_t data_wp = names_ofs + names_len;
+		for (size_t i = 0 ; i < num ; ++i) {
+			const struct rle_archive_input *in = items[i].in;
+			uint8_t *e = dest + RLE_ARCHIVE_HEADER_SIZE + i * RLE_ARCHIVE_ENTRY_SIZE;
+			rle_archive_put_le(e, items[i].hash, 8);
+			rle_archive_put_le(e + 8, data_wp, 8);
+			rle_archive_put_le(e + 16, in->compressed_size, 8);
+			rle_archive_put_le(e + 24, in->decoded_size, 8);
+			rle_archive_put_le(e + 32, name_wp, 8);
+			rle_archive_put_le(e + 40, in->name_len, 2);
+			e[42] = in->variant;
+			e[43] = 0;
+			rle_archive_put_le(e + 44, in->crc, 4);
+			if (in->name_len) {
+				memcpy(dest + name_wp, in->name, in->name_len);
+			}
+			if (in->compressed_size) {
+				memcpy(dest + data_wp, in->data, in->compressed_size);
+			}
+			name_wp += in->name_len;
+			data_wp += in->compressed_size;
+		}
+	}
+	free(items);
+
+	return (ssize_t)total;
+}
+
+// Open the archive in `base`, which must stay valid while it's in use. Only the header is checked, so
+// this takes constant time. Returns 0 on success, -1 if `base` doesn't start with an archive, or -2 if
+// the version is unsupported or the archive is truncated.
+int rle_archive_open(struct rle_archive *ar, const uint8_t *base, size_t len) {
+	if (len < RLE_ARCHIVE_HEADER_SIZE || memcmp(base, rle_archive_magic, sizeof(rle_archive_magic)) != 0) {
+		return -1;
+	}
+	uint64_t num = rle_archive_get_le(base + 8, 8);
+	uint64_t total = rle_archive_get_le(base + 16, 8);
+	if (base[4] != RLE_ARCHIVE_VERSION || total > len || total < RLE_ARCHIVE_HEADER_SIZE || num > (total - RLE_ARCHIVE_HEADER_SIZE) / RLE_ARCHIVE_ENTRY_SIZE) {
+		return -2;
+	}
+	ar->base = base;
+	ar->len = (size_t)total;
+	ar->num = (size_t)num;
+	return 0;
+}
+
+// Read entry `i` of the index, in sorted order. Returns 0 on success, -1 if `i` is out of range,
+// or -2 if the entry refers to data outside the archive, or has a decoded size no decoder can return.
+int rle_archive_get(const struct rle_archive *ar, size_t i, struct rle_archive_entry *entry) {
+	if (i >= ar->num) {
+		return -1;
+	}
+	const uint8_t *e = ar->base + RLE_ARCHIVE_HEADER_SIZE + i * RLE_ARCHIVE_ENTRY_SIZE;
+	uint64_t data_ofs = rle_archive_get_le(e + 8, 8);
+	uint64_t compressed_size = rle_archive_get_le(e + 16, 8);
+	uint64_t decoded_size = rle_archive_get_le(e + 24, 8);
+	uint64_t name_ofs = rle_archive_get_le(e + 32, 8);
+	entry->hash = rle_archive_get_le(e, 8);
+	entry->name_len = (size_t)rle_archive_get_le(e + 40, 2);
+	entry->variant = e[42];
+	entry->crc = (uint32_t)rle_archive_get_le(e + 44, 4);
+	if (data_ofs > ar->len || compressed_size > ar->len - data_ofs || name_ofs > ar->len || entry->name_len > ar->len - name_ofs ||
+		decoded_size > ((size_t)~0 >> 1UL)) {
+		return -2;
+	}
+	entry->compressed_size = (size_t)compressed_size;
+	entry->decoded_size = (size_t)decoded_size;
+	entry->data = ar->base + data_ofs;
+	entry->name = (const char *)ar->base + name_ofs;
+	return 0;
+}
+
+// Look up the entry called `name` by binary search of the index. Returns its position in the index,
+// or -1 if there's no such entry, or -2 if the entry is corrupt, as for rle_archive_get().
+ssize_t rle_archive_find(const struct rle_archive *ar, const char *name, size_t name_len, struct rle_archive_entry *entry) {
+	uint64_t hash = rle_archive_hash(name, name_len);
+	size_t lo = 0;
+	size_t hi = ar->num;
+	const uint8_t *index = ar->base + RLE_ARCHIVE_HEADER_SIZE;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (rle_archive_get_le(index + mid * RLE_ARCHIVE_ENTRY_SIZE, 8) < hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	// Entries with the same hash are ordered by name.
+	for ( ; lo < ar->num && rle_archive_get_le(index + lo * RLE_ARCHIVE_ENTRY_SIZE, 8) == hash ; ++lo) {
+		if (rle_archive_get(ar, lo, entry) != 0) {
+			return -2;
+		}
+		int res = rle_archive_cmp(hash, name, name_len, hash, entry->name, entry->name_len);
+		if (res == 0) {
+			return (ssize_t)lo;
+		} else if (res < 0) {
+			break;
+		}
+	}
+	return -1;
+}
+
+// Decode `entry` into `dest`, which has room for `dlen` bytes, and verify its size and checksum. The
+// caller selects `parse_op` from the variant of the entry. Returns the decoded length, -1 if the size or
+// checksum doesn't match, or the same error as the variant's decoder on malformed data or if `dest` is
+// too small.
+ssize_t rle_archive_decompress(rle_zoo_parse_op_fp parse_op, const struct rle_archive_entry *entry, uint8_t *dest, size_t dlen) {
+	uint32_t crc;
+	ssize_t res = rle_crc_decompress(parse_op, entry->data, entry->compressed_size, dest, dlen, &crc, NULL);
+	if (res >= 0 && ((size_t)res != entry->decoded_size || crc != entry->crc)) {
+		return -1;
+	}
+	return res;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,396 @@
+/*
+	Asynchronous Run-Length Encoding & Decoding (RLE) Jobs
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Submits compress or decompress jobs to a library-owned pool of worker threads,
+	for use from event loops where a synchronous call on a large buffer would stall.
+
+	Jobs go into one of two bounded lock-free queues depending on their size, and some
+	workers only ever serve the queue of small jobs, so that large jobs can't hold up
+	small ones. Submission fails instead of blocking when a queue is full. Completion is
+	reported through a per-job callback, or through a file descriptor that becomes
+	readable when there are completed jobs to reap, suitable for poll(2) and friends.
+
+	Requires POSIX threads and C11 atomics; link with -pthread. C only.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/types.h> // ssize_t
+
+typedef ssize_t (*rle_async_fp)(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+
+enum rle_async_state {
+	RLE_ASYNC_QUEUED,
+	RLE_ASYNC_RUNNING,
+	RLE_ASYNC_DONE,
+	RLE_ASYNC_CANCELLED,
+};
+
+struct rle_async_job;
+typedef void (*rle_async_done_fp)(struct rle_async_job *job);
+
+struct rle_async_job {
+	rle_async_fp func;	// Variant and direction, e.g packbits_compress or icns_decompress.
+	const uint8_t *src;
+	size_t slen;
+	uint8_t *dest;
+	size_t dlen;
+	rle_async_done_fp done;	// Called from a worker thread on completion. If NULL, reap the job instead.
+	void *user;
+	ssize_t result;		// Set to the return value of `func`, once DONE.
+	atomic_int state;	// enum rle_async_state
+};
+
+struct rle_async_config {
+	int nthreads;			// Number of worker threads, at least one.
+	int small_threads;		// Number of workers that only run small jobs. Less than nthreads.
+	size_t queue_size;		// Capacity of each queue. Rounded up to a power of two.
+	size_t large_threshold;	// Jobs with slen + dlen above this go to the large queue.
+};
+
+struct rle_async_pool;
+
+struct rle_async_pool *rle_async_create(const struct rle_async_config *cfg);
+void rle_async_destroy(struct rle_async_pool *pool);
+int rle_async_submit(struct rle_async_pool *pool, struct rle_async_job *job);
+int rle_async_cancel(struct rle_async_job *job);
+int rle_async_fd(const struct rle_async_pool *pool);
+size_t rle_async_reap(struct rle_async_pool *pool, struct rle_async_job **jobs, size_t max);
+
+#if defined(RLE_ZOO_ASYNC_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+// Bounded MPMC queue, after Dmitry Vyukov. Each cell carries a sequence number which tells
+// producers and consumers whether the cell is free for the current lap around the ring.
+struct rle_async_cell {
+	atomic_size_t seq;
+	struct rle_async_job *job;
+};
+
+struct rle_async_queue {
+	struct rle_async_cell *cells;
+	size_t mask;
+	atomic_size_t head;
+	atomic_size_t tail;
+};
+
+struct rle_async_pool {
+	struct rle_async_queue small;
+	struct rle_async_queue large;
+	struct rle_async_queue completed;
+	size_t large_threshold;
+	size_t max_inflight;
+	atomic_size_t inflight;		// Submitted, but not yet completed and reaped.
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_cv;
+	atomic_int sleepers;
+	atomic_int shutdown;
+
+	int notify_fd[2];			// Read and write end. The same eventfd on Linux.
+	pthread_t *threads;
+	int nthreads;
+	int small_threads;
+};
+
+struct rle_async_worker_arg {
+	struct rle_async_pool *pool;
+	int small_only;
+};
+
+static int rle_async_queue_init(struct rle_async_queue *q, size_t size) {
+	q->cells = calloc(size, sizeof(*q->cells));
+	if (!q->cells) {
+		return -1;
+	}
+	for (size_t i = 0 ; i < size ; ++i) {
+		atomic_init(&q->cells[i].seq, i);
+	}
+	q->mask = size - 1;
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+	return 0;
+}
+
+static int rle_async_queue_push(struct rle_async_queue *q, struct rle_async_job *job) {
+	size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	struct rle_async_cell *cell;
+	for (;;) {
+		cell = &q->cells[pos & q->mask];
+		size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		if (seq == pos) {
+			if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if ((ptrdiff_t)(seq - pos) < 0) {
+			return -1; // Full.
+		} else {
+			pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+		}
+	}
+	cell->job = job;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	return 0;
+}
+
+static struct rle_async_job *rle_async_queue_pop(struct rle_async_queue *q) {
+	size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+	struct rle_async_cell *cell;
+	for (;;) {
+		cell = &q->cells[pos & q->mask];
+		size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		if (seq == pos + 1) {
+			if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+			return NULL; // Empty.
+		} else {
+			pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+		}
+	}
+	struct rle_async_job *job = cell->job;
+	atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+	return job;
+}
+
+static void rle_async_notify(struct rle_async_pool *pool) {
+	uint64_t one = 1;
+	// A full pipe or eventfd is already readable, so a failed write can be ignored.
+	ssize_t res = write(pool->notify_fd[1], &one, sizeof(one));
+	(void)res;
+}
+
+static void rle_async_complete(struct rle_async_pool *pool, struct rle_async_job *job) {
+	if (job->done) {
+		job->done(job);
+		atomic_fetch_sub(&pool->inflight, 1);
+	} else {
+		// Can't fail, the number of jobs in flight is bounded by the queue size.
+		int res = rle_async_queue_push(&pool->completed, job);
+		assert(res == 0);
+		(void)res;
+		rle_async_notify(pool);
+	}
+}
+
+static struct rle_async_job *rle_async_next(struct rle_async_pool *pool, int small_only) {
+	struct rle_async_job *job = rle_async_queue_pop(&pool->small);
+	if (!job && !small_only) {
+		job = rle_async_queue_pop(&pool->large);
+	}
+	return job;
+}
+
+static void *rle_async_worker(void *varg) {
+	struct rle_async_worker_arg *arg = varg;
+	struct rle_async_pool *pool = arg->pool;
+	int small_only = arg->small_only;
+	free(arg);
+
+	for (;;) {
+		struct rle_async_job *job = rle_async_next(pool, small_only);
+		if (!job) {
+			// Announce ourselves as sleeping before the final check, so a concurrent
+			// submit either sees us and wakes us up, or we see its job.
+			pthread_mutex_lock(&pool->lock);
+			atomic_fetch_add(&pool->sleepers, 1);
+			// Pairs with the fence in rle_async_submit.
+			atomic_thread_fence(memory_order_seq_cst);
+			while (!(job = rle_async_next(pool, small_only)) && !atomic_load(&pool->shutdown)) {
+				pthread_cond_wait(&pool->work_cv, &pool->lock);
+			}
+			atomic_fetch_sub(&pool->sleepers, 1);
+			pthread_mutex_unlock(&pool->lock);
+			if (!job) {
+				break;
+			}
+		}
+
+		int expected = RLE_ASYNC_QUEUED;
+		if (atomic_compare_exchange_strong(&job->state, &expected, RLE_ASYNC_RUNNING)) {
+			job->result = job->func(job->src, job->slen, job->dest, job->dlen);
+			atomic_store(&job->state, RLE_ASYNC_DONE);
+		}
+		rle_async_complete(pool, job);
+	}
+
+	return NULL;
+}
+
+static size_t rle_async_pow2(size_t n) {
+	size_t p = 1;
+	while (p < n) {
+		p <<= 1;
+	}
+	return p;
+}
+
+// Create a pool as described by `cfg`. Returns NULL on failure or invalid configuration.
+struct rle_async_pool *rle_async_create(const struct rle_async_config *cfg) {
+	if (cfg->nthreads < 1 || cfg->small_threads < 0 || cfg->small_threads >= cfg->nthreads || cfg->queue_size == 0) {
+		return NULL;
+	}
+
+	struct rle_async_pool *pool = calloc(1, sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+	size_t size = rle_async_pow2(cfg->queue_size);
+	pool->large_threshold = cfg->large_threshold;
+	pool->max_inflight = 2 * size;
+	pool->notify_fd[0] = pool->notify_fd[1] = -1;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cv, NULL);
+
+	if (rle_async_queue_init(&pool->small, size) != 0 || rle_async_queue_init(&pool->large, size) != 0 ||
+		rle_async_queue_init(&pool->completed, pool->max_inflight) != 0) {
+		rle_async_destroy(pool);
+		return NULL;
+	}
+
+#ifdef __linux__
+	pool->notify_fd[0] = pool->notify_fd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pool->notify_fd[0] == -1) {
+		rle_async_destroy(pool);
+		return NULL;
+	}
+#else
+	if (pipe(pool->notify_fd) != 0) {
+		pool->notify_fd[0] = pool->notify_fd[1] = -1;
+		rle_async_destroy(pool);
+		return NULL;
+	}
+	for (int i = 0 ; i < 2 ; ++i) {
+		fcntl(pool->notify_fd[i], F_SETFL, fcntl(pool->notify_fd[i], F_GETFL) | O_NONBLOCK);
+		fcntl(pool->notify_fd[i], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+
+	pool->threads = calloc((size_t)cfg->nthreads, sizeof(pthread_t));
+	if (!pool->threads) {
+		rle_async_destroy(pool);
+		return NULL;
+	}
+	for (int i = 0 ; i < cfg->nthreads ; ++i) {
+		struct rle_async_worker_arg *arg = malloc(sizeof(*arg));
+		if (!arg) {
+			rle_async_destroy(pool);
+			return NULL;
+		}
+		arg->pool = pool;
+		arg->small_only = i < cfg->small_threads;
+		if (pthread_create(&pool->threads[i], NULL, rle_async_worker, arg) != 0) {
+			free(arg);
+			rle_async_destroy(pool);
+			return NULL;
+		}
+		pool->nthreads++;
+	}
+	pool->small_threads = cfg->small_threads;
+
+	return pool;
+}
+
+// Stop the pool. Jobs already submitted are run or cancelled to completion first, but
+// completed jobs not yet reaped are dropped.
+void rle_async_destroy(struct rle_async_pool *pool) {
+	if (!pool) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	atomic_store(&pool->shutdown, 1);
+	pthread_cond_broadcast(&pool->work_cv);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0 ; i < pool->nthreads ; ++i) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	if (pool->notify_fd[0] != -1) {
+		close(pool->notify_fd[0]);
+		if (pool->notify_fd[1] != pool->notify_fd[0]) {
+			close(pool->notify_fd[1]);
+		}
+	}
+	pthread_cond_destroy(&pool->work_cv);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->completed.cells);
+	free(pool->large.cells);
+	free(pool->small.cells);
+	free(pool->threads);
+	free(pool);
+}
+
+// Submit a job. The job must remain valid until completed. Returns zero on success, or -1 with
+// errno set to EAGAIN if the queue for the job, or the number of jobs in flight, is at its limit.
+// The job should be retried later, e.g after reaping completed jobs.
+int rle_async_submit(struct rle_async_pool *pool, struct rle_async_job *job) {
+	if (atomic_fetch_add(&pool->inflight, 1) >= pool->max_inflight) {
+		atomic_fetch_sub(&pool->inflight, 1);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	atomic_store(&job->state, RLE_ASYNC_QUEUED);
+	struct rle_async_queue *q = job->slen + job->dlen > pool->large_threshold ? &pool->large : &pool->small;
+	if (rle_async_queue_push(q, job) != 0) {
+		atomic_fetch_sub(&pool->inflight, 1);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	// The push is a release store, which may otherwise be reordered after the load of `sleepers`,
+	// letting a worker going to sleep miss the job while we miss the worker.
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&pool->sleepers) > 0) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->work_cv);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return 0;
+}
+
+// Cancel a job that hasn't started running. A cancelled job is still completed as usual,
+// with its state set to RLE_ASYNC_CANCELLED. Returns zero on success, or -1 if the job is
+// already running or done.
+int rle_async_cancel(struct rle_async_job *job) {
+	int expected = RLE_ASYNC_QUEUED;
+	return atomic_compare_exchange_strong(&job->state, &expected, RLE_ASYNC_CANCELLED) ? 0 : -1;
+}
+
+// Return a file descriptor which becomes readable when there are jobs to reap.
+int rle_async_fd(const struct rle_async_pool *pool) {
+	return pool->notify_fd[0];
+}
+
+// Reap up to `max` completed jobs without a `done` callback into `jobs`, returning the number
+// reaped. Never blocks. Call until it returns less than `max` to consume the notification.
+size_t rle_async_reap(struct rle_async_pool *pool, struct rle_async_job **jobs, size_t max) {
+	// Consume the notification first, so jobs completing after we stop are notified anew.
+	uint64_t buf[8];
+	while (read(pool->notify_fd[0], buf, sizeof(buf)) > 0)
+		;
+
+	size_t n = 0;
+	while (n < max && (jobs[n] = rle_async_queue_pop(&pool->completed)) != NULL) {
+		++n;
+	}
+	if (n == max) {
+		// There may be more, leave the descriptor readable.
+		rle_async_notify(pool);
+	}
+	atomic_fetch_sub(&pool->inflight, n);
+	return n;
+}
+#endif
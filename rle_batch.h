@@ -0,0 +1,222 @@
+/*
+	Run-Length Encoding & Decoding (RLE) of Batches of Buffers
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Processes large numbers of small, independent compress or decompress jobs across
+	a fixed pool of worker threads. Jobs are handed out in chunks sized to keep each
+	thread's working set in cache.
+
+	Requires POSIX threads; link with -pthread.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h> // ssize_t
+
+typedef ssize_t (*rle_batch_fp)(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+
+struct rle_batch_job {
+	rle_batch_fp func;	// Variant and direction, e.g packbits_compress or icns_decompress.
+	const uint8_t *src;
+	size_t slen;
+	uint8_t *dest;
+	size_t dlen;
+	ssize_t result;		// Set to the return value of `func`.
+};
+
+struct rle_batch_stats {
+	size_t jobs;
+	size_t failed;		// Number of jobs with a negative result.
+	size_t bytes_in;
+	size_t bytes_out;
+	double seconds;		// Wall-clock time.
+};
+
+struct rle_batch_pool;
+
+struct rle_batch_pool *rle_batch_create(int nthreads);
+void rle_batch_destroy(struct rle_batch_pool *pool);
+void rle_batch_run(struct rle_batch_pool *pool, struct rle_batch_job *jobs, size_t njobs, struct rle_batch_stats *stats);
+
+#if defined(RLE_ZOO_BATCH_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+// Target number of input+output bytes per chunk of jobs handed to a thread.
+#ifndef RLE_BATCH_CHUNK_BYTES
+#define RLE_BATCH_CHUNK_BYTES (128*1024)
+#endif
+
+struct rle_batch_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t work_cv;
+	pthread_cond_t done_cv;
+	pthread_t *threads;
+	int nthreads;
+	int shutdown;
+	unsigned int generation;	// Incremented for every batch.
+	int active;					// Number of workers still busy with the current batch.
+
+	struct rle_batch_job *jobs;
+	size_t njobs;
+	size_t chunk;
+	atomic_size_t next;
+	atomic_size_t failed;
+	atomic_size_t bytes_in;
+	atomic_size_t bytes_out;
+};
+
+static void rle_batch_work(struct rle_batch_pool *pool) {
+	size_t failed = 0;
+	size_t bytes_in = 0;
+	size_t bytes_out = 0;
+
+	for (;;) {
+		size_t i = atomic_fetch_add(&pool->next, pool->chunk);
+		if (i >= pool->njobs) {
+			break;
+		}
+		size_t end = i + pool->chunk < pool->njobs ? i + pool->chunk : pool->njobs;
+		for ( ; i < end ; ++i) {
+			struct rle_batch_job *job = &pool->jobs[i];
+			job->result = job->func(job->src, job->slen, job->dest, job->dlen);
+			bytes_in += job->slen;
+			if (job->result < 0) {
+				++failed;
+			} else {
+				bytes_out += (size_t)job->result;
+			}
+		}
+	}
+
+	atomic_fetch_add(&pool->failed, failed);
+	atomic_fetch_add(&pool->bytes_in, bytes_in);
+	atomic_fetch_add(&pool->bytes_out, bytes_out);
+}
+
+static void *rle_batch_worker(void *arg) {
+	struct rle_batch_pool *pool = arg;
+	unsigned int seen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->shutdown && pool->generation == seen) {
+			pthread_cond_wait(&pool->work_cv, &pool->lock);
+		}
+		if (pool->shutdown) {
+			break;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		rle_batch_work(pool);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->active == 0) {
+			pthread_cond_signal(&pool->done_cv);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+// Create a pool of `nthreads` worker threads. The thread calling rle_batch_run() also
+// takes part, so zero worker threads is valid. Returns NULL on failure.
+struct rle_batch_pool *rle_batch_create(int nthreads) {
+	struct rle_batch_pool *pool = calloc(1, sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cv, NULL);
+	pthread_cond_init(&pool->done_cv, NULL);
+	pool->threads = calloc(nthreads > 0 ? (size_t)nthreads : 1, sizeof(pthread_t));
+	if (!pool->threads) {
+		rle_batch_destroy(pool);
+		return NULL;
+	}
+	for (int i = 0 ; i < nthreads ; ++i) {
+		if (pthread_create(&pool->threads[i], NULL, rle_batch_worker, pool) != 0) {
+			rle_batch_destroy(pool);
+			return NULL;
+		}
+		pool->nthreads++;
+	}
+	return pool;
+}
+
+void rle_batch_destroy(struct rle_batch_pool *pool) {
+	if (!pool) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->work_cv);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0 ; i < pool->nthreads ; ++i) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	pthread_cond_destroy(&pool->done_cv);
+	pthread_cond_destroy(&pool->work_cv);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+// Run all jobs to completion, setting the result of each. If `stats` is not NULL, it
+// receives aggregate statistics for the batch. Not thread-safe; one batch at a time per pool.
+void rle_batch_run(struct rle_batch_pool *pool, struct rle_batch_job *jobs, size_t njobs, struct rle_batch_stats *stats) {
+	struct timespec t0, t1;
+	timespec_get(&t0, TIME_UTC);
+
+	size_t total = 0;
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		total += jobs[i].slen + jobs[i].dlen;
+	}
+	size_t avg = njobs > 0 ? total / njobs : 0;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->jobs = jobs;
+	pool->njobs = njobs;
+	pool->chunk = avg > 0 && avg < RLE_BATCH_CHUNK_BYTES ? RLE_BATCH_CHUNK_BYTES / avg : 1;
+	atomic_store(&pool->next, 0);
+	atomic_store(&pool->failed, 0);
+	atomic_store(&pool->bytes_in, 0);
+	atomic_store(&pool->bytes_out, 0);
+	pool->active = pool->nthreads;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->work_cv);
+	pthread_mutex_unlock(&pool->lock);
+
+	rle_batch_work(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->active > 0) {
+		pthread_cond_wait(&pool->done_cv, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	timespec_get(&t1, TIME_UTC);
+	if (stats) {
+		stats->jobs = njobs;
+		stats->failed = atomic_load(&pool->failed);
+		stats->bytes_in = atomic_load(&pool->bytes_in);
+		stats->bytes_out = atomic_load(&pool->bytes_out);
+		stats->seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+	}
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
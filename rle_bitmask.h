@@ -0,0 +1,347 @@
+/*
+	Run-Length Encoder/Decoder (RLE), Bitmask Variant
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	A variant of our own for 1-bit data, like masks and bi-level images, which reads the input as
+	a sequence of bits, low bit first, rather than having it unpacked to a byte per bit. Long runs
+	are encoded as in fax coding, and anything else as seven bits stored in the OP:
+
+		0xxxxxxx  LIT the seven bits x
+		1vnnnnnn  REP bit v, n + 1 times, or with n = 63, 64 plus a varint following the OP times
+
+	Run boundaries are found 64 bits at a time with XOR and count-trailing-zeros.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#else
+#include <sys/types.h> // ssize_t
+#endif
+
+#include "rle_zoo_common.h"
+
+ssize_t bitmask_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t bitmask_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t bitmask_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t bitmask_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+
+#if defined(RLE_ZOO_BITMASK_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+static_assert(sizeof(size_t) == sizeof(ssize_t), "");
+
+// return -(rp + 1) ... mask so it can't flip positive. Give up and just always return -1?
+#define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
+
+// RLE PARAMS: in bits, LIT=7, min REP=7, no max. The format allows REPs from 1, which the encoder only uses
+// for the last few bits of the input.
+#define BITMASK_LIT_BITS 7
+#define BITMASK_MIN_REP 7
+// REP counts held by the OP byte, past which a varint follows.
+#define BITMASK_REP_SHORT 64
+// Largest varint accepted, so counts can't overflow.
+#define BITMASK_MAX_EXT ((size_t)~0 >> 4)
+
+// Output through a sink, buffered into chunks of RLE_ZOO_SINK_BUFFER_SIZE bytes.
+struct bitmask_sink {
+	rle_zoo_sink_fp sink;
+	void *ctx;
+	size_t len;
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+};
+
+// Append `len` bytes of `data`, or if it's NULL, `len` copies of `val`. Returns non-zero if the sink aborts.
+static int bitmask_sink_put(struct bitmask_sink *s, const uint8_t *data, uint8_t val, size_t len) {
+	while (len > 0) {
+		size_t n = sizeof(s->buf) - s->len < len ? sizeof(s->buf) - s->len : len;
+		if (data) {
+			memcpy(s->buf + s->len, data, n);
+			data += n;
+		} else {
+			memset(s->buf + s->len, val, n);
+		}
+		s->len += n;
+		len -= n;
+		if (s->len == sizeof(s->buf)) {
+			if (s->sink(s->ctx, s->buf, s->len) != 0) {
+				return 1;
+			}
+			s->len = 0;
+		}
+	}
+	return 0;
+}
+
+static int bitmask_sink_flush(struct bitmask_sink *s) {
+	int res = s->len > 0 ? s->sink(s->ctx, s->buf, s->len) : 0;
+	s->len = 0;
+	return res;
+}
+
+// Output to `dest`, or if `s` is set, to the sink. The decoder gathers bits in `acc`
+// until they make up whole bytes.
+struct bitmask_out {
+	uint8_t *dest;
+	size_t dlen;
+	size_t wp;
+	struct bitmask_sink *s;
+	uint64_t acc;
+	unsigned int nacc;	// Number of bits in `acc`.
+};
+
+// Output `len` bytes of `data`, or if it's NULL, `len` copies of `val`. Returns non-zero if they don't fit.
+static int bitmask_put(struct bitmask_out *o, const uint8_t *data, uint8_t val, size_t len) {
+	if (o->s) {
+		if (bitmask_sink_put(o->s, data, val, len) != 0) {
+			return 1;
+		}
+	} else if (o->dest) {
+		if (len > o->dlen - o->wp) {
+			return 1;
+		}
+		if (data) {
+			memcpy(o->dest + o->wp, data, len);
+		} else {
+			memset(o->dest + o->wp, val, len);
+		}
+	}
+	o->wp += len;
+	return 0;
+}
+
+// Output the whole bytes in the accumulator. When it holds more than seven bytes and there's room, `dest`
+// is written a word at a time, where any byte past `len` is the one the remaining bits will complete.
+// Otherwise exactly `len` bytes are written, so nothing is written past the end of the output.
+static int bitmask_flush(struct bitmask_out *o) {
+	unsigned int len = o->nacc / 8;
+	if (o->s || o->nacc <= 56 || (o->dest && o->dlen - o->wp < 8)) {
+		uint8_t buf[8];
+		for (unsigned int i = 0 ; i < len ; ++i) {
+			buf[i] = (uint8_t)(o->acc >> (8 * i));
+		}
+		if (bitmask_put(o, buf, 0, len) != 0) {
+			return 1;
+		}
+	} else {
+		if (o->dest) {
+			uint64_t v = o->acc;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			v = __builtin_bswap64(v);
+#endif
+			memcpy(o->dest + o->wp, &v, 8);
+		}
+		o->wp += len;
+	}
+	o->acc = len == 8 ? 0 : o->acc >> (8 * len);
+	o->nacc -= 8 * len;
+	return 0;
+}
+
+// Append `nbits` copies of the bit in `fill`, which is all zeros or all ones. The accumulator is topped
+// up and output, followed by whole words of the fill, and what's left is kept in the accumulator.
+// Expects room for at least one byte in the accumulator.
+static int bitmask_fill(struct bitmask_out *o, uint64_t fill, size_t nbits) {
+	assert(o->nacc <= 56);
+	if (nbits < 64 - o->nacc) {
+		o->acc |= (fill & ((1ULL << nbits) - 1)) << o->nacc;
+		o->nacc += (unsigned int)nbits;
+		return 0;
+	}
+	nbits -= 64 - o->nacc;
+	o->acc |= fill << o->nacc;
+	o->nacc = 64;
+	if (bitmask_flush(o) != 0) {
+		return 1;
+	}
+	if (nbits >= 64) {
+		size_t len = nbits / 64 * 8;
+		if (len <= 64 && !o->s && o->dest && o->dlen - o->wp >= len) {
+			for (size_t i = 0 ; i < len ; i += 8) {
+				memcpy(o->dest + o->wp + i, &fill, 8);
+			}
+			o->wp += len;
+		} else if (bitmask_put(o, NULL, (uint8_t)fill, len) != 0) {
+			return 1;
+		}
+		nbits -= 8 * len;
+	}
+	o->acc = fill & ((1ULL << nbits) - 1);
+	o->nacc = (unsigned int)nbits;
+	return 0;
+}
+
+// The eight bytes at `src` as a little-endian word, so bit i is at bit i on any host.
+static inline uint64_t bitmask_load64(const uint8_t *src) {
+	uint64_t v;
+	memcpy(&v, src, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline unsigned int bitmask_at(const uint8_t *src, size_t i) {
+	return (src[i >> 3] >> (i & 7)) & 1;
+}
+
+// Returns the number of bits in the run of bit `i` of `src`, out of `n` bits.
+static size_t bitmask_run_length(const uint8_t *src, size_t n, size_t i) {
+	const uint64_t pattern = bitmask_at(src, i) ? ~(uint64_t)0 : 0;
+	size_t p = i + 1;
+	// Compare a word at a time. Shifting into place leaves the top bits clear, which read as equal.
+	while ((p >> 3) + 8 <= n >> 3) {
+		uint64_t diff = (bitmask_load64(src + (p >> 3)) ^ pattern) >> (p & 7);
+		if (diff) {
+			return p - i + (size_t)__builtin_ctzll(diff);
+		}
+		p += 64 - (p & 7);
+	}
+	while (p < n && bitmask_at(src, p) == bitmask_at(src, i)) {
+		++p;
+	}
+	return p - i;
+}
+
+// The seven bits from bit `i` of `src`, out of `n` bits, where i + 7 <= n.
+static inline uint8_t bitmask_get_lit(const uint8_t *src, size_t n, size_t i) {
+	(void)n;
+	unsigned int v = src[i >> 3];
+	if ((i & 7) > 8 - BITMASK_LIT_BITS) {
+		assert((i >> 3) + 1 < n >> 3);
+		v |= (unsigned int)src[(i >> 3) + 1] << 8;
+	}
+	return (uint8_t)((v >> (i & 7)) & 0x7F);
+}
+
+static size_t bitmask_put_rep(uint8_t *dest, size_t cnt, unsigned int val) {
+	size_t n = cnt - 1;
+	size_t len = 1;
+	dest[0] = (uint8_t)(0x80 | val << 6 | (n < BITMASK_REP_SHORT - 1 ? n : BITMASK_REP_SHORT - 1));
+	if (cnt >= BITMASK_REP_SHORT) {
+		for (n = cnt - BITMASK_REP_SHORT ; n >= 0x80 ; n >>= 7) {
+			dest[len++] = (uint8_t)(n | 0x80);
+		}
+		dest[len++] = (uint8_t)n;
+	}
+	return len;
+}
+
+// Encode into the output.
+static inline ssize_t bitmask_encode(const uint8_t *src, size_t slen, struct bitmask_out *o) {
+	const size_t n = 8 * slen;
+	size_t i = 0;
+	while (i < n) {
+		uint8_t op[11];
+		size_t len = 1;
+		size_t cnt = bitmask_run_length(src, n, i);
+		if (cnt >= BITMASK_MIN_REP || n - i < BITMASK_LIT_BITS) {
+			len = bitmask_put_rep(op, cnt, bitmask_at(src, i));
+		} else {
+			op[0] = bitmask_get_lit(src, n, i);
+			cnt = BITMASK_LIT_BITS;
+		}
+		if (bitmask_put(o, op, 0, len) != 0) {
+			size_t rp = i / 8;
+			RLE_ZOO_RETURN_ERR;
+		}
+		i += cnt;
+	}
+	return (ssize_t)o->wp;
+}
+
+// Decode into the output.
+static inline ssize_t bitmask_decode(const uint8_t *src, size_t slen, struct bitmask_out *o) {
+	size_t rp = 0;
+	while (rp < slen) {
+		assert((ssize_t)o->wp >= 0);
+		uint8_t b = src[rp++];
+		if (o->nacc > 56 && bitmask_flush(o) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		if (b & 0x80) {
+			size_t cnt = (size_t)(b & 0x3F) + 1;
+			size_t hp = rp;
+			if (cnt == BITMASK_REP_SHORT) {
+				size_t ext = 0;
+				for (unsigned int shift = 0 ; ; shift += 7) {
+					if (hp >= slen || shift >= 64) {
+						RLE_ZOO_RETURN_ERR;
+					}
+					uint8_t e = src[hp++];
+					ext |= (size_t)(e & 0x7F) << shift;
+					if (!(e & 0x80)) {
+						break;
+					}
+				}
+				if (ext > BITMASK_MAX_EXT) {
+					RLE_ZOO_RETURN_ERR;
+				}
+				cnt += ext;
+			}
+			if (cnt / 8 + 1 > ((size_t)~0 >> 1UL) - o->wp || bitmask_fill(o, (b & 0x40) ? ~(uint64_t)0 : 0, cnt) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			rp = hp;
+		} else {
+			o->acc |= (uint64_t)b << o->nacc;
+			o->nacc += BITMASK_LIT_BITS;
+		}
+	}
+	// The output must be whole bytes.
+	if (bitmask_flush(o) != 0 || o->nacc != 0) {
+		RLE_ZOO_RETURN_ERR;
+	}
+	assert(rp == slen);
+	assert((o->dest == NULL) || (o->wp <= o->dlen));
+	return (ssize_t)o->wp;
+}
+
+ssize_t bitmask_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	struct bitmask_out o = { dest, dlen, 0, NULL, 0, 0 };
+	return bitmask_encode(src, slen, &o);
+}
+
+ssize_t bitmask_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	struct bitmask_out o = { dest, dlen, 0, NULL, 0, 0 };
+	return bitmask_decode(src, slen, &o);
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t bitmask_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct bitmask_sink s = { sink, ctx, 0, { 0 } };
+	struct bitmask_out o = { NULL, 0, 0, &s, 0, 0 };
+	ssize_t res = bitmask_encode(src, slen, &o);
+	if (res >= 0 && bitmask_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as bitmask_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t bitmask_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct bitmask_sink s = { sink, ctx, 0, { 0 } };
+	struct bitmask_out o = { NULL, 0, 0, &s, 0, 0 };
+	ssize_t res = bitmask_decode(src, slen, &o);
+	if (res >= 0 && bitmask_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+#undef RLE_ZOO_RETURN_ERR
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,628 @@
+/*
+	Parallel Block-Framed Run-Length Encoding & Decoding (RLE)
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Splits the input into fixed-size blocks, encodes each as an independent stream,
+	and writes them as a frame with a block table (RLE_FRAME_FLAG_BLOCKS), so that the
+	blocks can be compressed and decompressed concurrently. Each block carries its own
+	CRC32C, and the CRC of the whole input is combined from them without another pass.
+
+	Blocks are handed out to `nthreads` threads, the calling thread included, which are
+	started for each call. Compressed blocks are gathered in order once all are done, while
+	decompressed blocks are written straight to their place in the output.
+
+	With rle_block_compress_adaptive(), each block is encoded with whichever of a table of
+	variants is estimated to give the smallest output, or stored if none would be smaller.
+	The estimate comes from a single pass over the runs in the block, scored against each
+	variant's rle_zoo_params, so only the chosen variant encodes it. The variant is recorded
+	per block (RLE_FRAME_FLAG_ADAPTIVE), and rle_block_decompress_adaptive() dispatches on it.
+
+	Requires POSIX threads; link with -pthread.
+
+	Include one or more of the rle_<variant>.h headers, rle_crc.h and rle_frame.h first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_block.h"
+#endif
+#ifndef RLE_FRAME_HEADER_SIZE
+#error "Include rle_crc.h and rle_frame.h before rle_block.h"
+#endif
+
+#define RLE_BLOCK_DEFAULT_SIZE (1024*1024)
+// Largest block size, keeping the compressed size of any block well within 32 bits.
+#define RLE_BLOCK_MAX_SIZE (1024*1024*1024)
+// Most variants an adaptive frame can choose from.
+#define RLE_BLOCK_MAX_VARIANTS 16
+
+// A variant available to adaptive frames. The id must be non-zero.
+struct rle_block_variant {
+	uint8_t id;
+	const struct rle_zoo_params *params;
+	rle_crc_cstream_fp compress_stream;
+	rle_zoo_parse_op_fp parse_op;
+};
+
+void rle_block_estimate(const struct rle_block_variant *variants, size_t num, const uint8_t *src, size_t slen, size_t *sizes);
+ssize_t rle_block_compress(rle_crc_cstream_fp compress_stream, uint8_t variant, const uint8_t *src, size_t slen, size_t block_size, int nthreads, uint8_t *dest, size_t dlen);
+ssize_t rle_block_decompress(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, int nthreads);
+ssize_t rle_block_compress_adaptive(const struct rle_block_variant *variants, size_t num, const uint8_t *src, size_t slen, size_t block_size, int nthreads, uint8_t *dest, size_t dlen);
+ssize_t rle_block_decompress_adaptive(const struct rle_block_variant *variants, size_t num, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, int nthreads);
+
+#if defined(RLE_ZOO_BLOCK_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+struct rle_block_work {
+	const struct rle_frame_block *blocks;	// Decoding: the block table.
+	struct rle_frame_block *out_blocks;		// Encoding: filled in per block.
+	size_t nblocks;
+	atomic_size_t next;
+	atomic_size_t failed;		// Index of the first failed block, or nblocks.
+	ssize_t error;				// Result for the first failed block, under `lock`.
+	pthread_mutex_t lock;
+
+	rle_crc_cstream_fp compress_stream;
+	rle_zoo_parse_op_fp parse_op;
+	const struct rle_block_variant *variants;	// Adaptive frames: the variants to pick from.
+	size_t nvariants;
+	size_t *estimates;			// Adaptive encoding: per block, the estimated size with each variant.
+	const uint8_t *redo;		// Re-encoding: the blocks to encode, prefixed with `redo_id`.
+	uint8_t redo_id;
+	const uint8_t *src;
+	size_t slen;
+	size_t block_size;
+	uint8_t **bufs;				// Encoding: the compressed blocks.
+	const size_t *src_ofs;		// Decoding: per block offsets into `src` and `dest`.
+	const size_t *dest_ofs;
+	uint8_t *dest;
+	int check_crc;
+};
+
+static void rle_block_fail(struct rle_block_work *w, size_t i, ssize_t error) {
+	pthread_mutex_lock(&w->lock);
+	if (i < atomic_load(&w->failed)) {
+		atomic_store(&w->failed, i);
+		w->error = error;
+	}
+	pthread_mutex_unlock(&w->lock);
+}
+
+static rle_zoo_parse_op_fp rle_block_parse_op(const struct rle_block_variant *variants, size_t num, uint8_t id) {
+	for (size_t i = 0 ; i < num ; ++i) {
+		if (id != 0 && variants[i].id == id) {
+			return variants[i].parse_op;
+		}
+	}
+	return NULL;
+}
+
+// Add the cost of `lit` bytes not covered by a REP, split into CPYs.
+static size_t rle_block_estimate_lits(const struct rle_zoo_params *p, size_t lit) {
+	return lit + (lit + p->max_cpy - 1) / p->max_cpy * p->cpy_overhead;
+}
+
+// Estimate the size of `src` encoded with each of the `num` variants, at most RLE_BLOCK_MAX_VARIANTS, into
+// `sizes`. This takes a single pass over the runs in `src`, and is exact or close for most inputs.
+void rle_block_estimate(const struct rle_block_variant *variants, size_t num, const uint8_t *src, size_t slen, size_t *sizes) {
+	// Keep the parameters and totals local, where they can't alias the input.
+	struct rle_zoo_params params[RLE_BLOCK_MAX_VARIANTS];
+	size_t est[RLE_BLOCK_MAX_VARIANTS] = { 0 };
+	size_t lits[RLE_BLOCK_MAX_VARIANTS] = { 0 };
+	const uint64_t ones = 0x0101010101010101ULL;
+	if (num > RLE_BLOCK_MAX_VARIANTS) {
+		num = RLE_BLOCK_MAX_VARIANTS;
+	}
+	// Runs shorter than every variant's REPs, of values no variant escapes, only add literals to all of them,
+	// so they're summed up in `pending` without visiting each variant.
+	size_t min_rep = (size_t)~0;
+	unsigned int min_limit = 256;
+	size_t pending = 0;
+	for (size_t k = 0 ; k < num ; ++k) {
+		params[k] = *variants[k].params;
+		if (params[k].min_rep < min_rep) {
+			min_rep = params[k].min_rep;
+		}
+		if (params[k].lit_limit && params[k].lit_limit < min_limit) {
+			min_limit = params[k].lit_limit;
+		}
+	}
+	const uint64_t high = 0x8080808080808080ULL;
+	const uint64_t low = 0x7F7F7F7F7F7F7F7FULL;
+	for (size_t i = 0 ; i < slen ; ) {
+		// Skip over single bytes eight at a time, while each differs from the next and is below `min_limit`.
+		while (min_rep > 1 && i + 9 <= slen) {
+			uint64_t x, y;
+			memcpy(&x, src + i, 8);
+			memcpy(&y, src + i + 1, 8);
+			uint64_t z = x ^ y;
+			uint64_t stop = ~(((z & low) + low) | z | low);
+			if (min_limit < 256) {
+				uint64_t lo = (x & low) + (min_limit <= 128 ? 128 - min_limit : 256 - min_limit) * ones;
+				stop |= (min_limit <= 128 ? (x | lo) : (x & lo)) & high;
+			}
+			if (stop) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+				size_t j = (size_t)__builtin_ctzll(stop) / 8;
+#else
+				size_t j = (size_t)__builtin_clzll(stop) / 8;
+#endif
+				pending += j;
+				i += j;
+				break;
+			}
+			pending += 8;
+			i += 8;
+		}
+		if (i >= slen) {
+			break;
+		}
+		uint8_t v = src[i];
+		size_t run = 1;
+		// Compare a word at a time, the first differing byte ending the run.
+		while (i + run + 8 <= slen) {
+			uint64_t diff;
+			memcpy(&diff, src + i + run, 8);
+			diff ^= v * ones;
+			if (diff) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+				run += (size_t)__builtin_ctzll(diff) / 8;
+#else
+				run += (size_t)__builtin_clzll(diff) / 8;
+#endif
+				goto counted;
+			}
+			run += 8;
+		}
+		while (i + run < slen && src[i + run] == v) {
+			++run;
+		}
+counted:
+		i += run;
+		if (run < min_rep && v < min_limit) {
+			pending += run;
+			continue;
+		}
+
+		for (size_t k = 0 ; k < num ; ++k) {
+			const struct rle_zoo_params *p = &params[k];
+			lits[k] += pending;
+			// Most runs are short, so avoid the divisions for them.
+			size_t reps = run < p->max_rep ? 0 : run / p->max_rep;
+			size_t rest = run < p->max_rep ? run : run % p->max_rep;
+			if (rest >= p->min_rep) {
+				++reps;
+				rest = 0;
+			}
+			if (reps > 0) {
+				est[k] += rle_block_estimate_lits(p, lits[k]) + reps * 2;
+				lits[k] = 0;
+			}
+			lits[k] += rest;
+			if (p->lit_limit && v >= p->lit_limit) {
+				est[k] += rest;
+			}
+		}
+		pending = 0;
+	}
+	for (size_t k = 0 ; k < num ; ++k) {
+		sizes[k] = est[k] + rle_block_estimate_lits(&params[k], lits[k] + pending);
+	}
+}
+
+static void *rle_block_compress_worker(void *arg) {
+	struct rle_block_work *w = arg;
+	for (;;) {
+		size_t i = atomic_fetch_add(&w->next, 1);
+		if (i >= w->nblocks || atomic_load(&w->failed) < w->nblocks) {
+			break;
+		}
+		if (w->redo && !w->redo[i]) {
+			continue;
+		}
+		const uint8_t *in = w->src + i * w->block_size;
+		size_t n = w->slen - i * w->block_size < w->block_size ? w->slen - i * w->block_size : w->block_size;
+		rle_crc_cstream_fp compress_stream = w->compress_stream;
+		uint8_t id = 0;
+		size_t hlen = 0;
+		if (w->redo) {
+			id = w->redo_id;
+			hlen = 1;
+		} else if (w->variants) {
+			// Pick the variant with the smallest estimate, if any is smaller than storing the block.
+			size_t *sizes = w->estimates + i * w->nvariants;
+			size_t best = n;
+			rle_block_estimate(w->variants, w->nvariants, in, n, sizes);
+			compress_stream = NULL;
+			for (size_t k = 0 ; k < w->nvariants ; ++k) {
+				if (sizes[k] < best) {
+					best = sizes[k];
+					id = w->variants[k].id;
+					compress_stream = w->variants[k].compress_stream;
+				}
+			}
+			hlen = 1;
+		}
+		// No variant expands by more than 2x, but size exactly if that proves wrong.
+		size_t cap = 2 * n + 16;
+		uint8_t *buf = malloc(hlen + cap);
+		uint32_t out_crc;
+		uint32_t in_crc = 0;
+		ssize_t res = -1;
+		if (buf && compress_stream) {
+			res = rle_crc_compress(compress_stream, in, n, buf + hlen, cap, &out_crc, &in_crc);
+			if (res < 0) {
+				cap = (size_t)rle_crc_compress(compress_stream, in, n, NULL, 0, &out_crc, NULL);
+				uint8_t *nbuf = realloc(buf, hlen + cap);
+				if (nbuf) {
+					buf = nbuf;
+					res = rle_crc_compress(compress_stream, in, n, buf + hlen, cap, &out_crc, &in_crc);
+				}
+			}
+		}
+		if (buf && w->variants && (!compress_stream || (res >= 0 && (size_t)res >= n))) {
+			// Store the block, when nothing is smaller after all.
+			id = 0;
+			memcpy(buf + hlen, in, n);
+			in_crc = rle_crc32c(0, in, n);
+			res = (ssize_t)n;
+		}
+		w->bufs[i] = buf;
+		if (res < 0) {
+			rle_block_fail(w, i, -1);
+			break;
+		}
+		if (hlen) {
+			buf[0] = id;
+		}
+		struct rle_frame_block b = { (uint32_t)n, (uint32_t)(hlen + (size_t)res), in_crc };
+		w->out_blocks[i] = b;
+	}
+	return NULL;
+}
+
+static void *rle_block_decompress_worker(void *arg) {
+	struct rle_block_work *w = arg;
+	for (;;) {
+		size_t i = atomic_fetch_add(&w->next, 1);
+		if (i >= w->nblocks || atomic_load(&w->failed) < w->nblocks) {
+			break;
+		}
+		const struct rle_frame_block *b = &w->blocks[i];
+		size_t ofs = w->src_ofs[i];
+		size_t clen = b->compressed_size;
+		uint8_t *out = w->dest + w->dest_ofs[i];
+		rle_zoo_parse_op_fp parse_op = w->parse_op;
+		if (w->variants) {
+			// Each block starts with the id of its variant, or zero if stored.
+			uint8_t id = clen > 0 ? w->src[ofs] : 0;
+			if (clen > 0 && id == 0 && clen - 1 == b->decoded_size) {
+				memcpy(out, w->src + ofs + 1, b->decoded_size);
+				if (w->check_crc && rle_crc32c(0, out, b->decoded_size) != b->crc) {
+					rle_block_fail(w, i, -1);
+					break;
+				}
+				continue;
+			}
+			parse_op = rle_block_parse_op(w->variants, w->nvariants, id);
+			if (clen == 0 || !parse_op) {
+				rle_block_fail(w, i, -1);
+				break;
+			}
+			++ofs;
+			--clen;
+		}
+		uint32_t crc;
+		ssize_t res = rle_crc_decompress(parse_op, w->src + ofs, clen, out, b->decoded_size, &crc, NULL);
+		if (res < 0) {
+			// Translate the position to one within the frame.
+			size_t rp = (size_t)~res - 1 + ofs;
+			rle_block_fail(w, i, (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL)));
+			break;
+		}
+		if ((size_t)res != b->decoded_size || (w->check_crc && crc != b->crc)) {
+			rle_block_fail(w, i, -1);
+			break;
+		}
+	}
+	return NULL;
+}
+
+// Run `worker` on `nthreads` threads, including the calling one. If threads can't be started,
+// the ones that were, and the calling thread, do all the work.
+static void rle_block_run(void *(*worker)(void *), struct rle_block_work *w, int nthreads) {
+	pthread_t threads[64];
+	int started = 0;
+	if (nthreads > (int)(sizeof(threads) / sizeof(threads[0]))) {
+		nthreads = (int)(sizeof(threads) / sizeof(threads[0]));
+	}
+	while (started < nthreads - 1 && (size_t)started + 1 < w->nblocks) {
+		if (pthread_create(&threads[started], NULL, worker, w) != 0) {
+			break;
+		}
+		++started;
+	}
+	worker(w);
+	for (int i = 0 ; i < started ; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+// If the blocks of an adaptive frame picked different variants, also encode those that didn't pick the variant
+// with the smallest estimated total with it, and keep them if a plain frame of that variant is no larger.
+static void rle_block_unify(struct rle_block_work *w, int nthreads) {
+	size_t nblocks = w->nblocks;
+	size_t num = w->nvariants;
+	size_t i = 1;
+	while (i < nblocks && w->bufs[i][0] == w->bufs[0][0]) {
+		++i;
+	}
+	if (nblocks == 0 || num == 0 || (i == nblocks && w->bufs[0][0] != 0)) {
+		return;
+	}
+	size_t best = 0;
+	uint64_t best_total = ~(uint64_t)0;
+	for (size_t k = 0 ; k < num ; ++k) {
+		uint64_t total = 0;
+		for (i = 0 ; i < nblocks ; ++i) {
+			total += w->estimates[i * num + k];
+		}
+		if (total < best_total) {
+			best_total = total;
+			best = k;
+		}
+	}
+
+	uint8_t *redo = malloc(nblocks);
+	struct rle_block_work r = {
+		.nblocks = nblocks,
+		.failed = nblocks,
+		.compress_stream = w->variants[best].compress_stream,
+		.redo = redo,
+		.redo_id = w->variants[best].id,
+		.src = w->src,
+		.slen = w->slen,
+		.block_size = w->block_size,
+	};
+	r.out_blocks = malloc(nblocks * sizeof(*r.out_blocks));
+	r.bufs = calloc(nblocks, sizeof(*r.bufs));
+	if (redo && r.out_blocks && r.bufs) {
+		for (i = 0 ; i < nblocks ; ++i) {
+			redo[i] = w->bufs[i][0] != r.redo_id;
+		}
+		pthread_mutex_init(&r.lock, NULL);
+		rle_block_run(rle_block_compress_worker, &r, nthreads);
+		pthread_mutex_destroy(&r.lock);
+		if (atomic_load(&r.failed) == nblocks) {
+			// Both include an id per block, which the plain frame drops.
+			uint64_t mixed = 0;
+			uint64_t single = 0;
+			for (i = 0 ; i < nblocks ; ++i) {
+				mixed += w->out_blocks[i].compressed_size;
+				single += (redo[i] ? r.out_blocks[i] : w->out_blocks[i]).compressed_size - 1;
+			}
+			for (i = 0 ; single <= mixed && i < nblocks ; ++i) {
+				if (redo[i]) {
+					free(w->bufs[i]);
+					w->bufs[i] = r.bufs[i];
+					w->out_blocks[i] = r.out_blocks[i];
+					r.bufs[i] = NULL;
+				}
+			}
+		}
+	}
+	for (i = 0 ; r.bufs && i < nblocks ; ++i) {
+		free(r.bufs[i]);
+	}
+	free(r.bufs);
+	free(r.out_blocks);
+	free(redo);
+}
+
+static ssize_t rle_block_encode(const struct rle_block_variant *variants, size_t nvariants, rle_crc_cstream_fp compress_stream, uint8_t variant, const uint8_t *src, size_t slen, size_t block_size, int nthreads, uint8_t *dest, size_t dlen) {
+	if (block_size == 0 || block_size > RLE_BLOCK_MAX_SIZE || nvariants > RLE_BLOCK_MAX_VARIANTS) {
+		return -1;
+	}
+	size_t nblocks = (slen + block_size - 1) / block_size;
+	struct rle_block_work w = {
+		.nblocks = nblocks,
+		.failed = nblocks,
+		.compress_stream = compress_stream,
+		.variants = variants,
+		.nvariants = nvariants,
+		.src = src,
+		.slen = slen,
+		.block_size = block_size,
+	};
+	w.out_blocks = malloc((nblocks ? nblocks : 1) * sizeof(*w.out_blocks));
+	w.bufs = calloc(nblocks ? nblocks : 1, sizeof(*w.bufs));
+	w.estimates = variants ? malloc((nblocks ? nblocks : 1) * (nvariants ? nvariants : 1) * sizeof(*w.estimates)) : NULL;
+	if (!w.out_blocks || !w.bufs || (variants && !w.estimates)) {
+		free(w.out_blocks);
+		free(w.bufs);
+		free(w.estimates);
+		return -1;
+	}
+	pthread_mutex_init(&w.lock, NULL);
+
+	rle_block_run(rle_block_compress_worker, &w, nthreads);
+	if (variants && atomic_load(&w.failed) == nblocks) {
+		rle_block_unify(&w, nthreads);
+	}
+
+	ssize_t res = -1;
+	if (atomic_load(&w.failed) == nblocks) {
+		struct rle_frame_header hdr = { .variant = variant, .flags = RLE_FRAME_FLAG_CRC | RLE_FRAME_FLAG_BLOCKS, .decoded_size = slen };
+		// If every block picked the same variant, drop the per-block ids and write a plain block frame.
+		size_t skip = 0;
+		if (variants) {
+			size_t i = 1;
+			while (i < nblocks && w.bufs[i][0] == w.bufs[0][0]) {
+				++i;
+			}
+			if (nblocks > 0 && i == nblocks && w.bufs[0][0] != 0) {
+				hdr.variant = w.bufs[0][0];
+				skip = 1;
+				for (i = 0 ; i < nblocks ; ++i) {
+					w.out_blocks[i].compressed_size -= 1;
+				}
+			} else {
+				hdr.variant = 0;
+				hdr.flags |= RLE_FRAME_FLAG_ADAPTIVE;
+			}
+		}
+		size_t clen = 4 + nblocks * RLE_FRAME_BLOCK_ENTRY_SIZE;
+		for (size_t i = 0 ; i < nblocks ; ++i) {
+			clen += w.out_blocks[i].compressed_size;
+			hdr.crc = rle_crc32c_combine(hdr.crc, w.out_blocks[i].crc, w.out_blocks[i].decoded_size);
+		}
+		hdr.compressed_size = clen;
+		if (!dest) {
+			res = (ssize_t)(RLE_FRAME_HEADER_SIZE + clen);
+		} else if (RLE_FRAME_HEADER_SIZE + clen <= dlen) {
+			uint8_t *p = dest + rle_frame_write_header(&hdr, dest);
+			p += rle_frame_write_blocks(w.out_blocks, nblocks, p);
+			for (size_t i = 0 ; i < nblocks ; ++i) {
+				memcpy(p, w.bufs[i] + skip, w.out_blocks[i].compressed_size);
+				p += w.out_blocks[i].compressed_size;
+			}
+			res = p - dest;
+		}
+	}
+
+	for (size_t i = 0 ; i < nblocks ; ++i) {
+		free(w.bufs[i]);
+	}
+	pthread_mutex_destroy(&w.lock);
+	free(w.estimates);
+	free(w.bufs);
+	free(w.out_blocks);
+
+	return res;
+}
+
+// Encode `src` with a variant's stream compressor into a block-framed stream in `dest`, which has room for
+// `dlen` bytes, using blocks of `block_size` bytes and `nthreads` threads. The header records `variant`, and
+// a CRC32C of the input. If `dest` is NULL, nothing is written, but the blocks are still encoded to size the
+// frame. The output doesn't depend on `nthreads`. Returns the size of the frame, or -1 if `dest` is too small,
+// `block_size` is zero or above RLE_BLOCK_MAX_SIZE, or memory can't be allocated.
+ssize_t rle_block_compress(rle_crc_cstream_fp compress_stream, uint8_t variant, const uint8_t *src, size_t slen, size_t block_size, int nthreads, uint8_t *dest, size_t dlen) {
+	return rle_block_encode(NULL, 0, compress_stream, variant, src, slen, block_size, nthreads, dest, dlen);
+}
+
+// As rle_block_compress(), but each block is encoded with the one of the `num` variants, at most
+// RLE_BLOCK_MAX_VARIANTS, estimated to give the smallest output, or stored if none is smaller. If
+// all blocks pick the same variant, the frame is the same as from rle_block_compress() with it. If not,
+// the blocks are also encoded with the variant of the smallest estimated total, and that frame is written
+// instead if it's no larger, so the output is never larger than that variant's.
+ssize_t rle_block_compress_adaptive(const struct rle_block_variant *variants, size_t num, const uint8_t *src, size_t slen, size_t block_size, int nthreads, uint8_t *dest, size_t dlen) {
+	return rle_block_encode(variants, num, NULL, 0, src, slen, block_size, nthreads, dest, dlen);
+}
+
+static ssize_t rle_block_decode(const struct rle_block_variant *variants, size_t nvariants, rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, int nthreads) {
+	struct rle_frame_header hdr;
+	ssize_t hlen = rle_frame_read_header(src, slen, &hdr);
+	if (hlen < 0 || hdr.decoded_size > dlen) {
+		return -1;
+	}
+	if (hdr.flags & RLE_FRAME_FLAG_ADAPTIVE) {
+		parse_op = NULL;
+	} else if (variants) {
+		parse_op = rle_block_parse_op(variants, nvariants, hdr.variant);
+		variants = NULL;
+	}
+	if (!parse_op && !variants) {
+		return -1;
+	}
+	const uint8_t *payload = src + hlen;
+	int check_crc = (hdr.flags & RLE_FRAME_FLAG_CRC) != 0;
+
+	if (!(hdr.flags & RLE_FRAME_FLAG_BLOCKS)) {
+		uint32_t crc;
+		ssize_t res = rle_crc_decompress(parse_op, payload, hdr.compressed_size, dest, hdr.decoded_size, &crc, NULL);
+		if (res < 0) {
+			size_t rp = (size_t)~res - 1 + (size_t)hlen;
+			return (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL));
+		}
+		return ((uint64_t)res == hdr.decoded_size && (!check_crc || crc == hdr.crc)) ? res : -1;
+	}
+
+	size_t nblocks;
+	ssize_t tlen = rle_frame_read_blocks(payload, hdr.compressed_size, NULL, 0, &nblocks);
+	if (tlen < 0) {
+		return -1;
+	}
+	struct rle_frame_block *blocks = malloc((nblocks ? nblocks : 1) * sizeof(*blocks));
+	size_t *ofs = malloc((nblocks ? nblocks : 1) * 2 * sizeof(*ofs));
+	if (!blocks || !ofs) {
+		free(blocks);
+		free(ofs);
+		return -1;
+	}
+	rle_frame_read_blocks(payload, hdr.compressed_size, blocks, nblocks, &nblocks);
+
+	// Lay out the blocks, and check that they add up to the sizes and checksum in the header.
+	size_t *src_ofs = ofs;
+	size_t *dest_ofs = ofs + nblocks;
+	size_t rp = (size_t)hlen + (size_t)tlen;
+	uint64_t wp = 0;
+	uint32_t crc = 0;
+	for (size_t i = 0 ; i < nblocks ; ++i) {
+		src_ofs[i] = rp;
+		dest_ofs[i] = (size_t)wp;
+		rp += blocks[i].compressed_size;
+		wp += blocks[i].decoded_size;
+		crc = rle_crc32c_combine(crc, blocks[i].crc, blocks[i].decoded_size);
+	}
+	ssize_t res = -1;
+	if (rp == (size_t)hlen + hdr.compressed_size && wp == hdr.decoded_size && (!check_crc || crc == hdr.crc)) {
+		struct rle_block_work w = {
+			.blocks = blocks,
+			.nblocks = nblocks,
+			.failed = nblocks,
+			.parse_op = parse_op,
+			.variants = variants,
+			.nvariants = nvariants,
+			.src = src,
+			.src_ofs = src_ofs,
+			.dest_ofs = dest_ofs,
+			.dest = dest,
+			.check_crc = check_crc,
+		};
+		pthread_mutex_init(&w.lock, NULL);
+		rle_block_run(rle_block_decompress_worker, &w, nthreads);
+		pthread_mutex_destroy(&w.lock);
+		res = atomic_load(&w.failed) == nblocks ? (ssize_t)wp : w.error;
+	}
+
+	free(ofs);
+	free(blocks);
+
+	return res;
+}
+
+// Decode the frame in `src` into `dest`, which has room for `dlen` bytes, using `nthreads` threads if it's
+// block-framed, and verify its sizes and checksums. The caller selects `parse_op` from the variant in the
+// header. Returns the decoded length, the negated position plus one in `src` of a malformed OP, or -1 if the
+// frame is malformed or adaptive, `dest` is too small, a checksum doesn't match, or memory can't be allocated.
+ssize_t rle_block_decompress(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, int nthreads) {
+	return rle_block_decode(NULL, 0, parse_op, src, slen, dest, dlen, nthreads);
+}
+
+// As rle_block_decompress(), but the variant is looked up among the `num` variants, per block for adaptive
+// frames. Returns -1 if a variant isn't among them.
+ssize_t rle_block_decompress_adaptive(const struct rle_block_variant *variants, size_t num, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, int nthreads) {
+	return rle_block_decode(variants, num, NULL, src, slen, dest, dlen, nthreads);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,300 @@
+/*
+	Fused CRC32C Checksums for Run-Length Encoding & Decoding (RLE)
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Decodes or encodes any variant while computing the CRC32C (Castagnoli) of the output,
+	and optionally of the input, as it's produced, saving a separate pass over memory.
+	REPs are folded into the checksum arithmetically, by combining CRCs in GF(2), so a
+	long run costs O(log n) rather than n.
+
+	Uses the SSE4.2 crc32 instruction when compiled with it, over three interleaved
+	streams for long buffers, and a table otherwise.
+
+	Include one or more of the rle_<variant>.h headers first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_crc.h"
+#endif
+
+typedef ssize_t (*rle_crc_cstream_fp)(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final);
+
+uint32_t rle_crc32c(uint32_t crc, const void *data, size_t len);
+uint32_t rle_crc32c_rep(uint32_t crc, uint8_t val, size_t n);
+uint32_t rle_crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b);
+ssize_t rle_crc_decompress(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, uint32_t *out_crc, uint32_t *in_crc);
+ssize_t rle_crc_compress(rle_crc_cstream_fp compress_stream, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, uint32_t *out_crc, uint32_t *in_crc);
+
+#if defined(RLE_ZOO_CRC_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+// Reflected CRC32C polynomial.
+#define RLE_CRC_POLY 0x82F63B78U
+
+// Size of each of the three streams interleaved by the hardware path.
+#define RLE_CRC_STRIDE 2048
+
+// The input to rle_crc_decompress() is checksummed in batches of this size, trailing the decoder
+// closely enough to still be in cache, without a call per OP.
+#define RLE_CRC_IN_BATCH 4096
+
+// Size of the chunks passed to the compressor by rle_crc_compress().
+#define RLE_CRC_CHUNK 65536
+
+#ifdef __SSE4_2__
+// Runs shorter than this are cheaper to checksum directly than through rle_crc_shift().
+#define RLE_CRC_REP_DIRECT 4096
+#else
+#define RLE_CRC_REP_DIRECT 256
+static const uint32_t rle_crc_table[256] = {
+	0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c, 0x26a1e7e8, 0xd4ca64eb,
+	0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b, 0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24,
+	0x105ec76f, 0xe235446c, 0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+	0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc, 0xbc267848, 0x4e4dfb4b,
+	0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a, 0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35,
+	0xaa64d611, 0x580f5512, 0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+	0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad, 0x1642ae59, 0xe4292d5a,
+	0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a, 0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595,
+	0x417b1dbc, 0xb3109ebf, 0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+	0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f, 0xed03a29b, 0x1f682198,
+	0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927, 0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38,
+	0xdbfc821c, 0x2997011f, 0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+	0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e, 0x4767748a, 0xb50cf789,
+	0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859, 0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46,
+	0x7198540d, 0x83f3d70e, 0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+	0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de, 0xdde0eb2a, 0x2f8b6829,
+	0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c, 0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93,
+	0x082f63b7, 0xfa44e0b4, 0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+	0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b, 0xb4091bff, 0x466298fc,
+	0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c, 0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033,
+	0xa24bb5a6, 0x502036a5, 0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+	0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975, 0x0e330a81, 0xfc588982,
+	0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d, 0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622,
+	0x38cc2a06, 0xcaa7a905, 0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+	0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8, 0xe52cc12c, 0x1747422f,
+	0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff, 0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0,
+	0xd3d3e1ab, 0x21b862a8, 0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+	0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78, 0x7fab5e8c, 0x8dc0dd8f,
+	0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee, 0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1,
+	0x69e9f0d5, 0x9b8273d6, 0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+	0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69, 0xd5cf889d, 0x27a40b9e,
+	0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
+};
+#endif
+
+// Multiply `a` and `b` modulo the polynomial, in the reflected bit order where x^0 is the top bit.
+static uint32_t rle_crc_mul(uint32_t a, uint32_t b) {
+	uint32_t prod = 0;
+	for (int i = 0 ; i < 32 ; ++i) {
+		if (a & 0x80000000U) {
+			prod ^= b;
+		}
+		a <<= 1;
+		b = (b >> 1) ^ ((b & 1) ? RLE_CRC_POLY : 0);
+	}
+	return prod;
+}
+
+// Returns x^(8n) modulo the polynomial, which shifts a CRC past `n` zero bytes when multiplied in.
+static uint32_t rle_crc_shift(size_t n) {
+	uint32_t res = 0x80000000U;	// x^0
+	uint32_t p = 0x00800000U;	// x^8
+	while (n) {
+		if (n & 1) {
+			res = rle_crc_mul(res, p);
+		}
+		p = rle_crc_mul(p, p);
+		n >>= 1;
+	}
+	return res;
+}
+
+// Update the raw (non-inverted) CRC register over `len` bytes.
+#ifdef __SSE4_2__
+static uint32_t rle_crc_update(uint32_t reg, const uint8_t *p, size_t len) {
+	uint64_t c0 = reg;
+	if (len >= 3 * RLE_CRC_STRIDE) {
+		// Three independent streams hide the latency of the crc32 instruction. The results are
+		// combined by shifting the earlier streams past the later ones.
+		static_assert(RLE_CRC_STRIDE == 2048, "Update the shift constants");
+		const uint32_t shift1 = 0x0d65762aU; // rle_crc_shift(RLE_CRC_STRIDE)
+		const uint32_t shift2 = 0x35d73a62U; // rle_crc_shift(2 * RLE_CRC_STRIDE)
+		do {
+			uint64_t c1 = 0;
+			uint64_t c2 = 0;
+			for (size_t i = 0 ; i < RLE_CRC_STRIDE ; i += 8) {
+				uint64_t w0, w1, w2;
+				memcpy(&w0, p + i, 8);
+				memcpy(&w1, p + RLE_CRC_STRIDE + i, 8);
+				memcpy(&w2, p + 2 * RLE_CRC_STRIDE + i, 8);
+				c0 = _mm_crc32_u64(c0, w0);
+				c1 = _mm_crc32_u64(c1, w1);
+				c2 = _mm_crc32_u64(c2, w2);
+			}
+			c0 = rle_crc_mul(shift2, (uint32_t)c0) ^ rle_crc_mul(shift1, (uint32_t)c1) ^ (uint32_t)c2;
+			p += 3 * RLE_CRC_STRIDE;
+			len -= 3 * RLE_CRC_STRIDE;
+		} while (len >= 3 * RLE_CRC_STRIDE);
+	}
+	while (len >= 8) {
+		uint64_t w;
+		memcpy(&w, p, 8);
+		c0 = _mm_crc32_u64(c0, w);
+		p += 8;
+		len -= 8;
+	}
+	uint32_t c = (uint32_t)c0;
+	while (len--) {
+		c = _mm_crc32_u8(c, *p++);
+	}
+	return c;
+}
+#else
+static uint32_t rle_crc_update(uint32_t reg, const uint8_t *p, size_t len) {
+	while (len--) {
+		reg = (reg >> 8) ^ rle_crc_table[(reg ^ *p++) & 0xFF];
+	}
+	return reg;
+}
+#endif
+
+// Returns the CRC32C of `data` appended to data with CRC `crc`. Pass zero to start.
+uint32_t rle_crc32c(uint32_t crc, const void *data, size_t len) {
+	return ~rle_crc_update(~crc, (const uint8_t*)data, len);
+}
+
+// Returns the CRC32C of `crc_a`'s data followed by `len_b` bytes of data with CRC `crc_b`.
+uint32_t rle_crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b) {
+	return rle_crc_mul(rle_crc_shift(len_b), crc_a) ^ crc_b;
+}
+
+// Returns the CRC32C of `n` bytes of `val` appended to data with CRC `crc`.
+uint32_t rle_crc32c_rep(uint32_t crc, uint8_t val, size_t n) {
+	if (n < RLE_CRC_REP_DIRECT) {
+		uint8_t buf[64];
+		memset(buf, val, sizeof(buf));
+		uint32_t reg = ~crc;
+		for ( ; n >= sizeof(buf) ; n -= sizeof(buf)) {
+			reg = rle_crc_update(reg, buf, sizeof(buf));
+		}
+		return ~rle_crc_update(reg, buf, n);
+	}
+	// Build the CRC of the run by doubling, from the top bit of `n` down, tracking x^(8*len)
+	// for the current length so each step is one or two multiplications.
+	const uint32_t x8 = 0x00800000U;
+	const uint32_t one = rle_crc32c(0, &val, 1);
+	uint32_t run = one;
+	uint32_t p = x8;
+	int bit = (int)(sizeof(n) * 8) - 1;
+	while (!((n >> bit) & 1)) {
+		--bit;
+	}
+	while (--bit >= 0) {
+		run = rle_crc_mul(p, run) ^ run;
+		p = rle_crc_mul(p, p);
+		if ((n >> bit) & 1) {
+			run = rle_crc_mul(x8, run) ^ one;
+			p = rle_crc_mul(p, x8);
+		}
+	}
+	return rle_crc_mul(p, crc) ^ run;
+}
+
+// Decode `src` into `dest`, which has room for `dlen` bytes, setting `out_crc` to the CRC32C of the output,
+// and `in_crc`, unless NULL, to that of the input. If `dest` is NULL, nothing is written, but the CRCs are
+// still computed. Returns the decoded length, or the negated position plus one in `src` of the OP that is
+// truncated or doesn't fit in `dest`, like `rle_cursor.h` does.
+ssize_t rle_crc_decompress(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, uint32_t *out_crc, uint32_t *in_crc) {
+	uint32_t oc = 0;
+	uint32_t ic = 0;
+	size_t ic_rp = 0;	// Input checksummed so far.
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < slen) {
+		if (in_crc && rp - ic_rp >= RLE_CRC_IN_BATCH) {
+			ic = rle_crc32c(ic, src + ic_rp, rp - ic_rp);
+			ic_rp = rp;
+		}
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0 || (dest && wp + op.cnt > dlen)) {
+			return (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL));
+		}
+		if (op.kind == RLE_ZOO_OP_REP) {
+			if (dest) {
+				memset(dest + wp, op.data[0], op.cnt);
+			}
+			oc = rle_crc32c_rep(oc, op.data[0], op.cnt);
+		} else if (op.cnt > 0) {
+			if (dest) {
+				memcpy(dest + wp, op.data, op.cnt);
+			}
+			oc = rle_crc32c(oc, op.data, op.cnt);
+		}
+		wp += op.cnt;
+		rp += (size_t)oplen;
+	}
+	if (in_crc) {
+		*in_crc = rle_crc32c(ic, src + ic_rp, rp - ic_rp);
+	}
+	*out_crc = oc;
+	return (ssize_t)wp;
+}
+
+// Encode `src` into `dest` with a variant's stream compressor, setting `out_crc` to the CRC32C of the
+// output, and `in_crc`, unless NULL, to that of the input. The input is passed in chunks, and each chunk
+// of input and output is checksummed right after being processed. If `dest` is NULL, nothing is written,
+// but the size and CRCs are still computed. Returns the compressed length, or the negated input position
+// if `dest` is too small.
+ssize_t rle_crc_compress(rle_crc_cstream_fp compress_stream, const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, uint32_t *out_crc, uint32_t *in_crc) {
+	struct rle_zoo_cstream cs;
+	rle_zoo_cstream_init(&cs);
+	uint8_t scratch[4096];
+	uint32_t oc = 0;
+	uint32_t ic = 0;
+	size_t rp = 0;
+	size_t wp = 0;
+	for (;;) {
+		size_t n = slen - rp < RLE_CRC_CHUNK ? slen - rp : RLE_CRC_CHUNK;
+		int final = rp + n == slen;
+		uint8_t *out = dest ? dest + wp : scratch;
+		size_t olen = dest ? dlen - wp : sizeof(scratch);
+		size_t consumed = 0;
+		ssize_t produced = compress_stream(&cs, src + rp, n, &consumed, out, olen, final);
+		if (produced < 0) {
+			return produced;
+		}
+		if (consumed == 0 && produced == 0) {
+			if (final && rp == slen && cs.op_rp == cs.op_len && cs.win_rp == cs.win_len) {
+				break;
+			}
+			// No progress, so `dest` is full.
+			return (ssize_t)~(rp & ((size_t)~0 >> 1UL));
+		}
+		if (in_crc) {
+			ic = rle_crc32c(ic, src + rp, consumed);
+		}
+		oc = rle_crc32c(oc, out, (size_t)produced);
+		rp += consumed;
+		wp += (size_t)produced;
+	}
+	if (in_crc) {
+		*in_crc = ic;
+	}
+	*out_crc = oc;
+	return (ssize_t)wp;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+/*
+	Run-Length Decoding (RLE) with a Resumable Cursor
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Partial and skip-ahead decoding of any variant. A cursor tracks the position in both
+	the compressed and decoded stream, and can read a prefix or window of the output, or
+	skip over output without writing it; REPs are skipped arithmetically and CPY payloads
+	without being copied, so the cost scales with the output wanted.
+
+	A checkpoint index, built in one pass over the input, records the cursor state at
+	regular intervals of output, so that a cursor can be positioned anywhere by skipping
+	at most one interval.
+
+	Include one or more of the rle_<variant>.h headers first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_cursor.h"
+#endif
+
+struct rle_cursor {
+	rle_zoo_parse_op_fp parse_op;
+	const uint8_t *src;
+	size_t slen;
+	size_t rp;			// Input position of the current OP.
+	size_t wp;			// Output position.
+	size_t op_ofs;		// Number of output bytes of the current OP already read or skipped.
+};
+
+// Cursor state at a position in the output.
+struct rle_cursor_checkpoint {
+	size_t rp;
+	size_t wp;
+	size_t op_ofs;
+};
+
+void rle_cursor_init(struct rle_cursor *cur, rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen);
+ssize_t rle_cursor_read(struct rle_cursor *cur, uint8_t *dest, size_t dlen);
+ssize_t rle_cursor_skip(struct rle_cursor *cur, size_t n);
+ssize_t rle_cursor_index(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, size_t interval, struct rle_cursor_checkpoint *index, size_t max, size_t *num);
+ssize_t rle_cursor_seek(struct rle_cursor *cur, const struct rle_cursor_checkpoint *index, size_t num, size_t interval, size_t offset);
+
+#if defined(RLE_ZOO_CURSOR_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+void rle_cursor_init(struct rle_cursor *cur, rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen) {
+	cur->parse_op = parse_op;
+	cur->src = src;
+	cur->slen = slen;
+	cur->rp = 0;
+	cur->wp = 0;
+	cur->op_ofs = 0;
+}
+
+// Advance the cursor by up to `n` output bytes, copying them into `dest` unless it's NULL.
+static ssize_t rle_cursor_advance(struct rle_cursor *cur, uint8_t *dest, size_t n) {
+	size_t done = 0;
+	while (done < n && cur->rp < cur->slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = cur->parse_op(cur->src + cur->rp, cur->slen - cur->rp, &op);
+		if (oplen < 0) {
+			return (ssize_t)~((cur->rp + 1) & ((size_t)~0 >> 1UL));
+		}
+		assert(cur->op_ofs <= op.cnt);
+
+		size_t cnt = op.cnt - cur->op_ofs;
+		if (cnt > n - done) {
+			cnt = n - done;
+		}
+		if (dest && cnt) {
+			if (op.kind == RLE_ZOO_OP_REP) {
+				memset(dest + done, op.data[0], cnt);
+			} else {
+				memcpy(dest + done, op.data + cur->op_ofs, cnt);
+			}
+		}
+		done += cnt;
+		cur->op_ofs += cnt;
+		if (cur->op_ofs == op.cnt) {
+			cur->rp += (size_t)oplen;
+			cur->op_ofs = 0;
+		}
+	}
+	cur->wp += done;
+	return (ssize_t)done;
+}
+
+// Read up to `dlen` bytes of output into `dest`, continuing from the cursor position.
+// Returns the number of bytes read, which is only less than `dlen` at the end of the stream,
+// or the same error as the variant's decoder if a truncated OP is encountered.
+ssize_t rle_cursor_read(struct rle_cursor *cur, uint8_t *dest, size_t dlen) {
+	return rle_cursor_advance(cur, dest, dlen);
+}
+
+// Skip `n` bytes of output without writing it. Returns the number of bytes skipped, which is
+// only less than `n` at the end of the stream, or an error as for rle_cursor_read().
+ssize_t rle_cursor_skip(struct rle_cursor *cur, size_t n) {
+	return rle_cursor_advance(cur, NULL, n);
+}
+
+// Build an index of checkpoints at every multiple of `interval` output bytes short of the end, i.e
+// index[k] is at output position k * interval. At most `max` checkpoints are written into `index`,
+// which may be NULL, and `num` is set to the number needed. Returns the decoded length, or an error
+// as for rle_cursor_read(); the whole input is parsed, so a successful return means it's well-formed.
+ssize_t rle_cursor_index(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, size_t interval, struct rle_cursor_checkpoint *index, size_t max, size_t *num) {
+	struct rle_cursor cur;
+	rle_cursor_init(&cur, parse_op, src, slen);
+	assert(interval > 0);
+
+	size_t n = 0;
+	for (;;) {
+		struct rle_cursor_checkpoint cp = { cur.rp, cur.wp, cur.op_ofs };
+		ssize_t res = rle_cursor_skip(&cur, interval);
+		if (res < 0) {
+			return res;
+		}
+		if (res == 0) {
+			break;
+		}
+		if (index && n < max) {
+			index[n] = cp;
+		}
+		++n;
+		if ((size_t)res < interval) {
+			break;
+		}
+	}
+	*num = n;
+
+	return (ssize_t)cur.wp;
+}
+
+// Position an initialized cursor at output position `offset`, starting from the closest preceding
+// checkpoint of an index built by rle_cursor_index() with the same `interval`. Returns the new output
+// position, which is only less than `offset` if past the end, or an error as for rle_cursor_read().
+ssize_t rle_cursor_seek(struct rle_cursor *cur, const struct rle_cursor_checkpoint *index, size_t num, size_t interval, size_t offset) {
+	size_t k = offset / interval;
+	if (k >= num) {
+		k = num - 1;
+	}
+	if (num > 0) {
+		cur->rp = index[k].rp;
+		cur->wp = index[k].wp;
+		cur->op_ofs = index[k].op_ofs;
+	} else {
+		cur->rp = cur->wp = cur->op_ofs = 0;
+	}
+	ssize_t res = rle_cursor_skip(cur, offset - cur->wp);
+	return res < 0 ? res : (ssize_t)cur->wp;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,275 @@
+/*
+	Compressed-Domain Editing of Run-Length Encoded (RLE) Data
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Slices, concatenates and remaps compressed streams of any variant without decoding them.
+	OPs that are kept whole are copied as-is, and only OPs at a boundary are decoded and
+	re-encoded with the variant's compressor.
+
+	Include one or more of the rle_<variant>.h headers first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_edit.h"
+#endif
+
+// Large enough for the output of any single OP, short of the unbounded ones of the longrun variant.
+#define RLE_EDIT_OP_MAX_CNT 256
+
+typedef ssize_t (*rle_edit_fp)(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+
+ssize_t rle_edit_slice(rle_zoo_parse_op_fp parse_op, rle_edit_fp compress, const uint8_t *src, size_t slen, size_t offset, size_t len, uint8_t *dest, size_t dlen);
+ssize_t rle_edit_concat(rle_zoo_parse_op_fp parse_op, rle_edit_fp compress, const uint8_t *a, size_t alen, const uint8_t *b, size_t blen, uint8_t *dest, size_t dlen);
+ssize_t rle_edit_remap(rle_zoo_parse_op_fp parse_op, rle_edit_fp compress, const uint8_t lut[256], const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+
+#if defined(RLE_ZOO_EDIT_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+#define RLE_EDIT_RETURN_ERR(rp) return (ssize_t)~((rp) & ((size_t)~0 >> 1UL))
+
+// Append `n` bytes from `src` to `dest` at `*wp`, or just count them if `dest` is NULL.
+static int rle_edit_put(const uint8_t *src, size_t n, uint8_t *dest, size_t dlen, size_t *wp) {
+	if (dest) {
+		if (*wp + n > dlen) {
+			return -1;
+		}
+		memcpy(dest + *wp, src, n);
+	}
+	*wp += n;
+	return 0;
+}
+
+// Decode `cnt` bytes of `op`, starting `ofs` bytes into it, and append them encoded with `compress`.
+// Longer OPs than RLE_EDIT_OP_MAX_CNT are re-encoded in pieces of that size.
+static int rle_edit_reencode(rle_edit_fp compress, const struct rle_zoo_op *op, size_t ofs, size_t cnt, uint8_t *dest, size_t dlen, size_t *wp) {
+	uint8_t tmp[RLE_EDIT_OP_MAX_CNT];
+	assert(ofs + cnt <= op->cnt);
+	if (op->kind == RLE_ZOO_OP_REP) {
+		memset(tmp, op->data[0], cnt < sizeof(tmp) ? cnt : sizeof(tmp));
+	}
+	do {
+		size_t n = cnt < sizeof(tmp) ? cnt : sizeof(tmp);
+		if (op->kind != RLE_ZOO_OP_REP) {
+			memcpy(tmp, op->data + ofs, n);
+		}
+		ssize_t res = compress(tmp, n, dest ? dest + *wp : NULL, dest ? dlen - *wp : 0);
+		if (res < 0) {
+			return -1;
+		}
+		*wp += (size_t)res;
+		ofs += n;
+		cnt -= n;
+	} while (cnt > 0);
+	return 0;
+}
+
+// Write the stream for the decoded range [offset, offset+len) of `src` into `dest`, which has room for
+// `dlen` bytes. The range is clamped to the decoded length. If `dest` is NULL, nothing is written and
+// the required size is returned. Returns the number of bytes written, the same error as the variant's
+// decoder on truncated input, or the negated input position if `dest` is too small.
+ssize_t rle_edit_slice(rle_zoo_parse_op_fp parse_op, rle_edit_fp compress, const uint8_t *src, size_t slen, size_t offset, size_t len, uint8_t *dest, size_t dlen) {
+	size_t end = len > SIZE_MAX - offset ? SIZE_MAX : offset + len;
+	size_t rp = 0;
+	size_t pos = 0;			// Decoded position of the OP at `rp`.
+	size_t wp = 0;
+	size_t copy_rp = slen;	// Start of a pending run of whole OPs, if less than `slen`.
+
+	while (rp < slen && pos < end) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			RLE_EDIT_RETURN_ERR(rp + 1);
+		}
+		size_t op_end = pos + op.cnt;
+
+		if (op_end <= offset) {
+			// Before the slice.
+		} else if (pos >= offset && op_end <= end) {
+			if (copy_rp == slen) {
+				copy_rp = rp;
+			}
+		} else {
+			if (copy_rp < slen) {
+				if (rle_edit_put(src + copy_rp, rp - copy_rp, dest, dlen, &wp) != 0) {
+					RLE_EDIT_RETURN_ERR(rp);
+				}
+				copy_rp = slen;
+			}
+			size_t lo = pos < offset ? offset - pos : 0;
+			size_t hi = op_end > end ? end - pos : op.cnt;
+			if (rle_edit_reencode(compress, &op, lo, hi - lo, dest, dlen, &wp) != 0) {
+				RLE_EDIT_RETURN_ERR(rp);
+			}
+		}
+		pos = op_end;
+		rp += (size_t)oplen;
+	}
+	if (copy_rp < slen && rle_edit_put(src + copy_rp, rp - copy_rp, dest, dlen, &wp) != 0) {
+		RLE_EDIT_RETURN_ERR(rp);
+	}
+
+	return (ssize_t)wp;
+}
+
+// Find the last OP of a stream, setting `last_rp` to its input position. Returns zero on success, 1 if
+// the stream has no output, or an error as the variant's decoder on truncated input.
+static ssize_t rle_edit_last_op(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, size_t *last_rp, struct rle_zoo_op *last) {
+	size_t rp = 0;
+	ssize_t res = 1;
+	while (rp < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			RLE_EDIT_RETURN_ERR(rp + 1);
+		}
+		if (op.cnt > 0) {
+			*last_rp = rp;
+			*last = op;
+			res = 0;
+		}
+		rp += (size_t)oplen;
+	}
+	return res;
+}
+
+// Write the concatenation of streams `a` and `b` into `dest`. The last OP of `a` and the first OP of `b`
+// are merged by re-encoding them together, if that makes the output smaller, e.g two REPs of the same
+// value, and together they're at most 2 * RLE_EDIT_OP_MAX_CNT bytes. Otherwise the streams are copied as-is. Only `a` and the first OP of `b` are parsed, the rest
+// of `b` is copied unchecked. Returns as rle_edit_slice(), where input positions for `b` are relative to `b`.
+ssize_t rle_edit_concat(rle_zoo_parse_op_fp parse_op, rle_edit_fp compress, const uint8_t *a, size_t alen, const uint8_t *b, size_t blen, uint8_t *dest, size_t dlen) {
+	size_t wp = 0;
+	size_t a_last_rp = 0;
+	struct rle_zoo_op a_last = { RLE_ZOO_OP_NOP, 0, NULL };
+	ssize_t res = rle_edit_last_op(parse_op, a, alen, &a_last_rp, &a_last);
+	if (res < 0) {
+		return res;
+	}
+
+	// Find the first OP of `b` with output.
+	size_t b_rp = 0;
+	struct rle_zoo_op b_first = { RLE_ZOO_OP_NOP, 0, NULL };
+	ssize_t b_oplen = 0;
+	while (res == 0 && b_rp < blen) {
+		b_oplen = parse_op(b + b_rp, blen - b_rp, &b_first);
+		if (b_oplen < 0) {
+			RLE_EDIT_RETURN_ERR(b_rp + 1);
+		}
+		b_rp += (size_t)b_oplen;
+		if (b_first.cnt > 0) {
+			break;
+		}
+	}
+
+	if (res == 0 && b_first.cnt > 0 && a_last.cnt <= RLE_EDIT_OP_MAX_CNT && b_first.cnt <= RLE_EDIT_OP_MAX_CNT) {
+		uint8_t seam[2 * RLE_EDIT_OP_MAX_CNT];
+		uint8_t enc[2 * RLE_EDIT_OP_MAX_CNT + 8];
+		const struct rle_zoo_op *ops[2] = { &a_last, &b_first };
+		size_t n = 0;
+		for (int i = 0 ; i < 2 ; ++i) {
+			if (ops[i]->kind == RLE_ZOO_OP_REP) {
+				memset(seam + n, ops[i]->data[0], ops[i]->cnt);
+			} else {
+				memcpy(seam + n, ops[i]->data, ops[i]->cnt);
+			}
+			n += ops[i]->cnt;
+		}
+		size_t a_tail = alen - a_last_rp;
+		size_t b_head = b_rp;
+		ssize_t merged = compress(seam, n, enc, sizeof(enc));
+		if (merged >= 0 && (size_t)merged < a_tail + b_head) {
+			if (rle_edit_put(a, a_last_rp, dest, dlen, &wp) != 0) {
+				RLE_EDIT_RETURN_ERR(a_last_rp);
+			}
+			if (rle_edit_put(enc, (size_t)merged, dest, dlen, &wp) != 0) {
+				RLE_EDIT_RETURN_ERR(alen);
+			}
+			if (rle_edit_put(b + b_rp, blen - b_rp, dest, dlen, &wp) != 0) {
+				RLE_EDIT_RETURN_ERR(b_rp);
+			}
+			return (ssize_t)wp;
+		}
+	}
+
+	if (rle_edit_put(a, alen, dest, dlen, &wp) != 0) {
+		RLE_EDIT_RETURN_ERR((size_t)0);
+	}
+	if (rle_edit_put(b, blen, dest, dlen, &wp) != 0) {
+		RLE_EDIT_RETURN_ERR((size_t)0);
+	}
+	return (ssize_t)wp;
+}
+
+// Write `src` into `dest` with every decoded byte `v` replaced by `lut[v]`, e.g to remap a palette.
+// OPs are copied as-is with only their payload remapped, except where the variant can't encode the
+// remapped OP the same way, e.g a pcx LIT that maps to a value >= 0xC0, which is re-encoded with
+// `compress`. Runs that become adjacent with the same value are left unmerged. `src` and `dest` must
+// not overlap. Returns as rle_edit_slice().
+ssize_t rle_edit_remap(rle_zoo_parse_op_fp parse_op, rle_edit_fp compress, const uint8_t lut[256], const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	size_t rp = 0;
+	size_t wp = 0;
+
+	while (rp < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			RLE_EDIT_RETURN_ERR(rp + 1);
+		}
+		const uint8_t *p = src + rp;
+
+		if (op.kind == RLE_ZOO_OP_LIT) {
+			// The OP is its own value, so check that the remapped value is still a LIT.
+			uint8_t v = lut[op.data[0]];
+			struct rle_zoo_op lit;
+			if (parse_op(&v, 1, &lit) == 1 && lit.kind == RLE_ZOO_OP_LIT && lit.cnt == 1) {
+				if (rle_edit_put(&v, 1, dest, dlen, &wp) != 0) {
+					RLE_EDIT_RETURN_ERR(rp);
+				}
+			} else {
+				lit.kind = RLE_ZOO_OP_LIT;
+				lit.cnt = 1;
+				lit.data = &v;
+				if (rle_edit_reencode(compress, &lit, 0, 1, dest, dlen, &wp) != 0) {
+					RLE_EDIT_RETURN_ERR(rp);
+				}
+			}
+		} else if (dest) {
+			if (wp + (size_t)oplen > dlen) {
+				RLE_EDIT_RETURN_ERR(rp);
+			}
+			uint8_t *d = dest + wp;
+			size_t pay_ofs = 0;
+			size_t pay_len = 0;
+			if (op.kind == RLE_ZOO_OP_REP) {
+				pay_ofs = (size_t)(op.data - p);
+				pay_len = 1;
+			} else if (op.kind == RLE_ZOO_OP_CPY && op.cnt > 0) {
+				pay_ofs = (size_t)(op.data - p);
+				pay_len = op.cnt;
+			}
+			memcpy(d, p, pay_ofs);
+			for (size_t i = 0 ; i < pay_len ; ++i) {
+				d[pay_ofs + i] = lut[p[pay_ofs + i]];
+			}
+			memcpy(d + pay_ofs + pay_len, p + pay_ofs + pay_len, (size_t)oplen - pay_ofs - pay_len);
+			wp += (size_t)oplen;
+		} else {
+			wp += (size_t)oplen;
+		}
+		rp += (size_t)oplen;
+	}
+
+	return (ssize_t)wp;
+}
+
+#undef RLE_EDIT_RETURN_ERR
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,179 @@
+/*
+	Framed Container for Run-Length Encoded (RLE) Streams
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	A fixed-size header in front of a raw stream of any variant, recording the variant,
+	the decoded and compressed sizes, and optionally a CRC32C of the decoded data, so that
+	a decoder can allocate its output once, decode in a single pass, and verify the result.
+
+	All fields are little-endian:
+
+		offset  size  field
+		0       4     magic, "RLEZ"
+		4       1     version, 1
+		5       1     variant id
+		6       1     flags, RLE_FRAME_FLAG_*
+		7       1     reserved, 0
+		8       8     decoded size
+		16      8     compressed size of the stream following the header
+		24      4     CRC32C of the decoded data, or 0 without RLE_FRAME_FLAG_CRC
+
+	With RLE_FRAME_FLAG_BLOCKS, the data is split into independently encoded blocks, and
+	the stream following the header starts with a block table:
+
+		0       4     number of blocks, N
+		4       12*N  per block: decoded size, compressed size, CRC32C of the decoded block
+
+	followed by the compressed blocks in order.
+
+	With RLE_FRAME_FLAG_ADAPTIVE also set, the header variant is 0, and each block instead
+	starts with the id of the variant it's encoded with, where 0 means stored as-is. The
+	compressed size of a block includes this byte.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h> // ssize_t
+
+#define RLE_FRAME_HEADER_SIZE 28
+#define RLE_FRAME_VERSION 1
+
+#define RLE_FRAME_BLOCK_ENTRY_SIZE 12
+
+// The header carries a CRC32C of the decoded data.
+#define RLE_FRAME_FLAG_CRC 0x01
+// The stream is made up of independently encoded blocks, described by a block table.
+#define RLE_FRAME_FLAG_BLOCKS 0x02
+// Each block records its own variant. Requires RLE_FRAME_FLAG_BLOCKS.
+#define RLE_FRAME_FLAG_ADAPTIVE 0x04
+// Flags understood by this version. The rest are reserved for filters applied before encoding;
+// frames with other flags set are rejected.
+#define RLE_FRAME_FLAGS_KNOWN (RLE_FRAME_FLAG_CRC | RLE_FRAME_FLAG_BLOCKS | RLE_FRAME_FLAG_ADAPTIVE)
+
+struct rle_frame_header {
+	uint8_t variant;
+	uint8_t flags;
+	uint64_t decoded_size;
+	uint64_t compressed_size;
+	uint32_t crc;
+};
+
+struct rle_frame_block {
+	uint32_t decoded_size;
+	uint32_t compressed_size;
+	uint32_t crc;
+};
+
+size_t rle_frame_write_header(const struct rle_frame_header *hdr, uint8_t dest[RLE_FRAME_HEADER_SIZE]);
+ssize_t rle_frame_read_header(const uint8_t *src, size_t slen, struct rle_frame_header *hdr);
+size_t rle_frame_write_blocks(const struct rle_frame_block *blocks, size_t num, uint8_t *dest);
+ssize_t rle_frame_read_blocks(const uint8_t *src, size_t slen, struct rle_frame_block *blocks, size_t max, size_t *num);
+
+#if defined(RLE_ZOO_FRAME_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <string.h>
+
+static const uint8_t rle_frame_magic[4] = { 'R', 'L', 'E', 'Z' };
+
+static void rle_frame_put_le(uint8_t *dest, uint64_t v, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		dest[i] = (uint8_t)(v >> (8 * i));
+	}
+}
+
+static uint64_t rle_frame_get_le(const uint8_t *src, size_t n) {
+	uint64_t v = 0;
+	for (size_t i = 0 ; i < n ; ++i) {
+		v |= (uint64_t)src[i] << (8 * i);
+	}
+	return v;
+}
+
+// Write the header into `dest`. Returns RLE_FRAME_HEADER_SIZE.
+size_t rle_frame_write_header(const struct rle_frame_header *hdr, uint8_t dest[RLE_FRAME_HEADER_SIZE]) {
+	memcpy(dest, rle_frame_magic, sizeof(rle_frame_magic));
+	dest[4] = RLE_FRAME_VERSION;
+	dest[5] = hdr->variant;
+	dest[6] = hdr->flags;
+	dest[7] = 0;
+	rle_frame_put_le(dest + 8, hdr->decoded_size, 8);
+	rle_frame_put_le(dest + 16, hdr->compressed_size, 8);
+	rle_frame_put_le(dest + 24, (hdr->flags & RLE_FRAME_FLAG_CRC) ? hdr->crc : 0, 4);
+	return RLE_FRAME_HEADER_SIZE;
+}
+
+// Read the header at the start of `src`. Returns RLE_FRAME_HEADER_SIZE on success, -1 if `src` doesn't
+// start with a frame header, or -2 if the version or flags are unsupported or inconsistent, the
+// compressed size exceeds the rest of `src`, or the decoded size can't be returned by a decoder.
+ssize_t rle_frame_read_header(const uint8_t *src, size_t slen, struct rle_frame_header *hdr) {
+	if (slen < RLE_FRAME_HEADER_SIZE || memcmp(src, rle_frame_magic, sizeof(rle_frame_magic)) != 0) {
+		return -1;
+	}
+	hdr->variant = src[5];
+	hdr->flags = src[6];
+	hdr->decoded_size = rle_frame_get_le(src + 8, 8);
+	hdr->compressed_size = rle_frame_get_le(src + 16, 8);
+	hdr->crc = (uint32_t)rle_frame_get_le(src + 24, 4);
+	if (src[4] != RLE_FRAME_VERSION || (hdr->flags & ~RLE_FRAME_FLAGS_KNOWN) ||
+		((hdr->flags & RLE_FRAME_FLAG_ADAPTIVE) && !(hdr->flags & RLE_FRAME_FLAG_BLOCKS)) || hdr->compressed_size > slen - RLE_FRAME_HEADER_SIZE ||
+		hdr->decoded_size > ((size_t)~0 >> 1UL)) {
+		return -2;
+	}
+	return RLE_FRAME_HEADER_SIZE;
+}
+
+// Write the block table for `num` blocks into `dest`, which must have room for 4 + num * RLE_FRAME_BLOCK_ENTRY_SIZE
+// bytes. Returns the number of bytes written.
+size_t rle_frame_write_blocks(const struct rle_frame_block *blocks, size_t num, uint8_t *dest) {
+	rle_frame_put_le(dest, num, 4);
+	uint8_t *p = dest + 4;
+	for (size_t i = 0 ; i < num ; ++i) {
+		rle_frame_put_le(p, blocks[i].decoded_size, 4);
+		rle_frame_put_le(p + 4, blocks[i].compressed_size, 4);
+		rle_frame_put_le(p + 8, blocks[i].crc, 4);
+		p += RLE_FRAME_BLOCK_ENTRY_SIZE;
+	}
+	return (size_t)(p - dest);
+}
+
+// Read the block table at the start of `src`, the stream following the header. At most `max` entries are
+// read into `blocks`, which may be NULL, and `num` is set to the number of blocks. Returns the size of the
+// table, or -2 if it's truncated, or its blocks exceed the rest of `src`.
+ssize_t rle_frame_read_blocks(const uint8_t *src, size_t slen, struct rle_frame_block *blocks, size_t max, size_t *num) {
+	if (slen < 4) {
+		return -2;
+	}
+	size_t n = (size_t)rle_frame_get_le(src, 4);
+	if (n > (slen - 4) / RLE_FRAME_BLOCK_ENTRY_SIZE) {
+		return -2;
+	}
+	size_t tlen = 4 + n * RLE_FRAME_BLOCK_ENTRY_SIZE;
+	size_t clen = 0;
+	const uint8_t *p = src + 4;
+	for (size_t i = 0 ; i < n ; ++i) {
+		struct rle_frame_block b = {
+			(uint32_t)rle_frame_get_le(p, 4),
+			(uint32_t)rle_frame_get_le(p + 4, 4),
+			(uint32_t)rle_frame_get_le(p + 8, 4),
+		};
+		clen += b.compressed_size;
+		if (blocks && i < max) {
+			blocks[i] = b;
+		}
+		p += RLE_FRAME_BLOCK_ENTRY_SIZE;
+	}
+	if (clen > slen - tlen) {
+		return -2;
+	}
+	*num = n;
+	return (ssize_t)tlen;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,178 @@
+/*
+	Seek Index Sidecars for Raw Run-Length Encoded (RLE) Streams
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Serializes a checkpoint index from rle_cursor.h, so that random reads into an existing
+	raw stream, whose format can't be changed, decode only the window wanted, skipping at
+	most one interval of output to reach it, rather than the whole stream.
+
+	All fields are little-endian:
+
+		offset  size  field
+		0       4     magic, "RLEI"
+		4       1     version, 1
+		5       1     variant id
+		6       2     reserved, 0
+		8       8     interval, in decoded bytes
+		16      8     decoded size of the stream
+		24      8     compressed size of the stream
+		32      8     number of checkpoints, N
+		40      24*N  per checkpoint: input offset of the OP, decoded offset, output of the OP before it
+
+	Checkpoint k is at decoded offset k * interval.
+
+	Include one or more of the rle_<variant>.h headers, and rle_cursor.h, first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_index.h"
+#endif
+
+#define RLE_INDEX_HEADER_SIZE 40
+#define RLE_INDEX_ENTRY_SIZE 24
+#define RLE_INDEX_VERSION 1
+#define RLE_INDEX_DEFAULT_INTERVAL 4096
+
+struct rle_index {
+	uint8_t variant;
+	size_t interval;
+	size_t decoded_size;
+	size_t compressed_size;
+	size_t num;
+	const struct rle_cursor_checkpoint *checkpoints;
+};
+
+size_t rle_index_size(size_t num);
+size_t rle_index_write(const struct rle_index *idx, uint8_t *dest);
+ssize_t rle_index_read(const uint8_t *src, size_t slen, struct rle_index *idx, struct rle_cursor_checkpoint *checkpoints, size_t max);
+ssize_t rle_index_extract(rle_zoo_parse_op_fp parse_op, const struct rle_index *idx, const uint8_t *src, size_t slen, size_t offset, uint8_t *dest, size_t dlen);
+
+#if defined(RLE_ZOO_INDEX_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <string.h>
+
+static const uint8_t rle_index_magic[4] = { 'R', 'L', 'E', 'I' };
+
+static void rle_index_put_le(uint8_t *dest, uint64_t v, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) {
+		dest[i] = (uint8_t)(v >> (8 * i));
+	}
+}
+
+static uint64_t rle_index_get_le(const uint8_t *src, size_t n) {
+	uint64_t v = 0;
+	for (size_t i = 0 ; i < n ; ++i) {
+		v |= (uint64_t)src[i] << (8 * i);
+	}
+	return v;
+}
+
+// Returns the serialized size of an index with `num` checkpoints.
+size_t rle_index_size(size_t num) {
+	return RLE_INDEX_HEADER_SIZE + num * RLE_INDEX_ENTRY_SIZE;
+}
+
+// Write the index into `dest`, which must have room for rle_index_size(idx->num) bytes. Returns the number
+// of bytes written.
+size_t rle_index_write(const struct rle_index *idx, uint8_t *dest) {
+	memcpy(dest, rle_index_magic, sizeof(rle_index_magic));
+	dest[4] = RLE_INDEX_VERSION;
+	dest[5] = idx->variant;
+	dest[6] = dest[7] = 0;
+	rle_index_put_le(dest + 8, idx->interval, 8);
+	rle_index_put_le(dest + 16, idx->decoded_size, 8);
+	rle_index_put_le(dest + 24, idx->compressed_size, 8);
+	rle_index_put_le(dest + 32, idx->num, 8);
+	uint8_t *p = dest + RLE_INDEX_HEADER_SIZE;
+	for (size_t i = 0 ; i < idx->num ; ++i) {
+		rle_index_put_le(p, idx->checkpoints[i].rp, 8);
+		rle_index_put_le(p + 8, idx->checkpoints[i].wp, 8);
+		rle_index_put_le(p + 16, idx->checkpoints[i].op_ofs, 8);
+		p += RLE_INDEX_ENTRY_SIZE;
+	}
+	return (size_t)(p - dest);
+}
+
+// Read the index in `src`. The checkpoints are read into `checkpoints`, which has room for `max`, and
+// `idx->checkpoints` is pointed at them. If `checkpoints` is NULL, the index is only validated, e.g to size
+// the array, and can't be used for extraction. Returns the size of the index, -1 if `src` doesn't start with
+// an index, -2 if the version is unsupported, it's truncated, or a checkpoint is out of place, or -3 if
+// `max` is less than the number of checkpoints.
+ssize_t rle_index_read(const uint8_t *src, size_t slen, struct rle_index *idx, struct rle_cursor_checkpoint *checkpoints, size_t max) {
+	if (slen < RLE_INDEX_HEADER_SIZE || memcmp(src, rle_index_magic, sizeof(rle_index_magic)) != 0) {
+		return -1;
+	}
+	uint64_t interval = rle_index_get_le(src + 8, 8);
+	uint64_t decoded_size = rle_index_get_le(src + 16, 8);
+	uint64_t compressed_size = rle_index_get_le(src + 24, 8);
+	uint64_t num = rle_index_get_le(src + 32, 8);
+	if (src[4] != RLE_INDEX_VERSION || interval == 0 || num > (slen - RLE_INDEX_HEADER_SIZE) / RLE_INDEX_ENTRY_SIZE ||
+		decoded_size > ((size_t)~0 >> 1UL) || compressed_size > ((size_t)~0 >> 1UL) ||
+		num != decoded_size / interval + (decoded_size % interval != 0)) {
+		return -2;
+	}
+	idx->variant = src[5];
+	idx->interval = (size_t)interval;
+	idx->decoded_size = (size_t)decoded_size;
+	idx->compressed_size = (size_t)compressed_size;
+	idx->num = (size_t)num;
+	idx->checkpoints = checkpoints;
+	if (checkpoints && max < idx->num) {
+		return -3;
+	}
+	const uint8_t *p = src + RLE_INDEX_HEADER_SIZE;
+	for (size_t i = 0 ; i < idx->num ; ++i) {
+		struct rle_cursor_checkpoint cp = {
+			(size_t)rle_index_get_le(p, 8),
+			(size_t)rle_index_get_le(p + 8, 8),
+			(size_t)rle_index_get_le(p + 16, 8),
+		};
+		if (cp.rp >= idx->compressed_size || cp.wp != i * idx->interval) {
+			return -2;
+		}
+		if (checkpoints) {
+			checkpoints[i] = cp;
+		}
+		p += RLE_INDEX_ENTRY_SIZE;
+	}
+	return (ssize_t)rle_index_size(idx->num);
+}
+
+// Decode up to `dlen` bytes at decoded `offset` of the stream `src` described by `idx` into `dest`,
+// starting from the closest preceding checkpoint. Returns the number of bytes decoded, which is only
+// less than `dlen` at the end of the stream, -1 if `src` doesn't match the index, or the same error
+// as the variant's decoder if a truncated OP is encountered.
+ssize_t rle_index_extract(rle_zoo_parse_op_fp parse_op, const struct rle_index *idx, const uint8_t *src, size_t slen, size_t offset, uint8_t *dest, size_t dlen) {
+	if (slen != idx->compressed_size) {
+		return -1;
+	}
+	if (offset >= idx->decoded_size) {
+		return 0;
+	}
+	if (!idx->checkpoints || offset / idx->interval >= idx->num) {
+		return -1;
+	}
+	// Check that the checkpoint lands inside an OP before trusting it.
+	const struct rle_cursor_checkpoint *cp = &idx->checkpoints[offset / idx->interval];
+	struct rle_zoo_op op;
+	if (parse_op(src + cp->rp, slen - cp->rp, &op) < 0 || (cp->op_ofs > 0 && cp->op_ofs >= op.cnt)) {
+		return -1;
+	}
+
+	struct rle_cursor cur;
+	rle_cursor_init(&cur, parse_op, src, slen);
+	ssize_t res = rle_cursor_seek(&cur, idx->checkpoints, idx->num, idx->interval, offset);
+	if (res < 0) {
+		return res;
+	}
+	return rle_cursor_read(&cur, dest, dlen);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,374 @@
+/*
+	Lazily Decoded Run-Length Encoded (RLE) Buffers
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Reserves a virtual region the size of the decoded data of a compressed stream, and
+	decodes pages into it only as they are accessed. A checkpoint index from rle_cursor.h,
+	with one entry per page, lets each page be decoded from just the OPs that cover it, and
+	only a bounded number of pages are kept resident, the oldest being dropped first.
+
+	On Linux the region is backed by userfaultfd(2) where available, so the data can be read
+	through a plain pointer; a handler thread decodes each page on first touch. Otherwise,
+	or if asked to, pages are only loaded through rle_lazy_get() and rle_lazy_read().
+
+	Requires POSIX threads; link with -pthread. Define _DEFAULT_SOURCE (or _GNU_SOURCE)
+	before including any system header.
+
+	Include one or more of the rle_<variant>.h headers, and rle_cursor.h, first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_lazy.h"
+#endif
+
+struct rle_lazy_config {
+	size_t max_resident;	// Most pages kept decoded at once, at least one.
+	int no_fault;			// If set, don't use userfaultfd even if available.
+};
+
+struct rle_lazy_stats {
+	size_t loads;			// Number of pages decoded.
+	size_t evictions;		// Number of pages dropped to stay within max_resident.
+	size_t resident;		// Number of pages currently decoded.
+};
+
+struct rle_lazy;
+
+struct rle_lazy *rle_lazy_create(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, const struct rle_lazy_config *cfg);
+void rle_lazy_destroy(struct rle_lazy *lz);
+size_t rle_lazy_size(const struct rle_lazy *lz);
+const uint8_t *rle_lazy_data(const struct rle_lazy *lz);
+const uint8_t *rle_lazy_get(struct rle_lazy *lz, size_t offset);
+ssize_t rle_lazy_read(struct rle_lazy *lz, size_t offset, uint8_t *dest, size_t dlen);
+void rle_lazy_stats(struct rle_lazy *lz, struct rle_lazy_stats *stats);
+
+#if defined(RLE_ZOO_LAZY_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#if defined(SYS_userfaultfd) && defined(UFFDIO_COPY)
+#define RLE_LAZY_UFFD
+#endif
+#endif
+
+#if !defined(MAP_ANONYMOUS) || !defined(MADV_DONTNEED)
+#error "Define _DEFAULT_SOURCE before including any system header, for MAP_ANONYMOUS and madvise()"
+#endif
+
+struct rle_lazy {
+	rle_zoo_parse_op_fp parse_op;
+	const uint8_t *src;
+	size_t slen;
+	struct rle_cursor_checkpoint *index;	// One checkpoint per page.
+	size_t npages;
+	size_t page_size;
+	size_t size;
+	uint8_t *base;
+	uint8_t *resident;		// Per page flag.
+	size_t *ring;			// Resident pages, oldest first from `next` once full.
+	size_t max_resident;
+	size_t next;
+	struct rle_lazy_stats stats;
+	pthread_mutex_t lock;
+	int uffd;				// Negative if not faulting.
+#ifdef RLE_LAZY_UFFD
+	int stop_fd;
+	uint8_t *page_buf;
+	pthread_t handler;
+#endif
+};
+
+// Decode page `page` into `dest`, zero-filling past the end of the data.
+static void rle_lazy_decode_page(struct rle_lazy *lz, size_t page, uint8_t *dest) {
+	struct rle_cursor cur;
+	rle_cursor_init(&cur, lz->parse_op, lz->src, lz->slen);
+	ssize_t res = rle_cursor_seek(&cur, lz->index, lz->npages, lz->page_size, page * lz->page_size);
+	assert(res == (ssize_t)(page * lz->page_size));
+	res = rle_cursor_read(&cur, dest, lz->page_size);
+	// The index pass checked the whole input, so this can't fail.
+	assert(res >= 0);
+	if (res < 0) {
+		res = 0;
+	}
+	memset(dest + res, 0, lz->page_size - (size_t)res);
+}
+
+// Make room for one more resident page, dropping the oldest if full, and record `page` as resident.
+// Called with the lock held.
+static void rle_lazy_admit(struct rle_lazy *lz, size_t page) {
+	if (lz->stats.resident == lz->max_resident) {
+		size_t old = lz->ring[lz->next];
+		madvise(lz->base + old * lz->page_size, lz->page_size, MADV_DONTNEED);
+		lz->resident[old] = 0;
+		lz->stats.evictions++;
+	} else {
+		lz->stats.resident++;
+	}
+	lz->ring[lz->next] = page;
+	lz->next = (lz->next + 1) % lz->max_resident;
+	lz->resident[page] = 1;
+	lz->stats.loads++;
+}
+
+#ifdef RLE_LAZY_UFFD
+static void *rle_lazy_handler(void *arg) {
+	struct rle_lazy *lz = arg;
+	for (;;) {
+		struct pollfd pfd[2] = {
+			{ .fd = lz->uffd, .events = POLLIN },
+			{ .fd = lz->stop_fd, .events = POLLIN },
+		};
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (pfd[1].revents) {
+			break;
+		}
+		struct uffd_msg msg;
+		if (read(lz->uffd, &msg, sizeof(msg)) != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT) {
+			continue;
+		}
+		size_t page = (size_t)((uintptr_t)msg.arg.pagefault.address - (uintptr_t)lz->base) / lz->page_size;
+		assert(page < lz->npages);
+
+		pthread_mutex_lock(&lz->lock);
+		rle_lazy_decode_page(lz, page, lz->page_buf);
+		struct uffdio_copy copy = {
+			.dst = (uintptr_t)(lz->base + page * lz->page_size),
+			.src = (uintptr_t)lz->page_buf,
+			.len = lz->page_size,
+			.mode = 0,
+		};
+		// EEXIST means a racing fault on the same page was already served.
+		if (ioctl(lz->uffd, UFFDIO_COPY, &copy) == 0 && !lz->resident[page]) {
+			rle_lazy_admit(lz, page);
+		}
+		pthread_mutex_unlock(&lz->lock);
+	}
+	return NULL;
+}
+
+// Back the region with userfaultfd, and start the handler thread. Returns zero on success.
+static int rle_lazy_start_uffd(struct rle_lazy *lz) {
+	lz->uffd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+#ifdef UFFD_USER_MODE_ONLY
+	if (lz->uffd < 0) {
+		// Unprivileged; faults from within the kernel, e.g write(2) from the region, fail with EFAULT.
+		lz->uffd = (int)syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+	}
+#endif
+	if (lz->uffd < 0) {
+		return -1;
+	}
+	struct uffdio_api api = { .api = UFFD_API, .features = 0 };
+	struct uffdio_register reg = {
+		.range = { .start = (uintptr_t)lz->base, .len = lz->npages * lz->page_size },
+		.mode = UFFDIO_REGISTER_MODE_MISSING,
+	};
+	if (ioctl(lz->uffd, UFFDIO_API, &api) != 0 || ioctl(lz->uffd, UFFDIO_REGISTER, &reg) != 0) {
+		goto fail_uffd;
+	}
+	lz->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (lz->stop_fd < 0) {
+		goto fail_uffd;
+	}
+	lz->page_buf = malloc(lz->page_size);
+	if (!lz->page_buf) {
+		goto fail_stop;
+	}
+	if (pthread_create(&lz->handler, NULL, rle_lazy_handler, lz) != 0) {
+		goto fail_buf;
+	}
+	return 0;
+
+fail_buf:
+	free(lz->page_buf);
+fail_stop:
+	close(lz->stop_fd);
+fail_uffd:
+	close(lz->uffd);
+	lz->uffd = -1;
+	return -1;
+}
+#endif
+
+// Create a lazily decoded buffer for the compressed stream `src`, which must stay valid, and unchanged,
+// until the buffer is destroyed. Returns NULL and sets errno to EINVAL if the input is malformed, or
+// ENOMEM if out of memory.
+struct rle_lazy *rle_lazy_create(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, const struct rle_lazy_config *cfg) {
+	if (cfg->max_resident < 1) {
+		errno = EINVAL;
+		return NULL;
+	}
+	struct rle_lazy *lz = calloc(1, sizeof(*lz));
+	if (!lz) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	lz->parse_op = parse_op;
+	lz->src = src;
+	lz->slen = slen;
+	lz->page_size = (size_t)sysconf(_SC_PAGESIZE);
+	lz->max_resident = cfg->max_resident;
+	lz->uffd = -1;
+
+	ssize_t res = rle_cursor_index(parse_op, src, slen, lz->page_size, NULL, 0, &lz->npages);
+	if (res < 0) {
+		free(lz);
+		errno = EINVAL;
+		return NULL;
+	}
+	lz->size = (size_t)res;
+	if (lz->npages == 0) {
+		return lz;
+	}
+
+	lz->index = malloc(lz->npages * sizeof(*lz->index));
+	lz->resident = calloc(lz->npages, 1);
+	lz->ring = malloc(lz->max_resident * sizeof(*lz->ring));
+	void *base = mmap(NULL, lz->npages * lz->page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (!lz->index || !lz->resident || !lz->ring || base == MAP_FAILED) {
+		if (base != MAP_FAILED) {
+			munmap(base, lz->npages * lz->page_size);
+		}
+		free(lz->ring);
+		free(lz->resident);
+		free(lz->index);
+		free(lz);
+		errno = ENOMEM;
+		return NULL;
+	}
+	lz->base = base;
+	rle_cursor_index(parse_op, src, slen, lz->page_size, lz->index, lz->npages, &lz->npages);
+	pthread_mutex_init(&lz->lock, NULL);
+
+#ifdef RLE_LAZY_UFFD
+	if (!cfg->no_fault) {
+		// Fall back to explicit access if userfaultfd is unavailable.
+		rle_lazy_start_uffd(lz);
+	}
+#endif
+
+	return lz;
+}
+
+void rle_lazy_destroy(struct rle_lazy *lz) {
+	if (!lz) {
+		return;
+	}
+#ifdef RLE_LAZY_UFFD
+	if (lz->uffd >= 0) {
+		uint64_t one = 1;
+		ssize_t res = write(lz->stop_fd, &one, sizeof(one));
+		assert(res == sizeof(one));
+		(void)res;
+		pthread_join(lz->handler, NULL);
+		close(lz->stop_fd);
+		close(lz->uffd);
+		free(lz->page_buf);
+	}
+#endif
+	if (lz->base) {
+		munmap(lz->base, lz->npages * lz->page_size);
+		pthread_mutex_destroy(&lz->lock);
+	}
+	free(lz->ring);
+	free(lz->resident);
+	free(lz->index);
+	free(lz);
+}
+
+// Returns the decoded size.
+size_t rle_lazy_size(const struct rle_lazy *lz) {
+	return lz->size;
+}
+
+// Returns a pointer to the decoded data, which can be read directly if the buffer is backed by
+// userfaultfd, or NULL if not.
+const uint8_t *rle_lazy_data(const struct rle_lazy *lz) {
+	return lz->uffd >= 0 ? lz->base : NULL;
+}
+
+// Returns a pointer to the decoded byte at `offset`, loading the page it's in if needed, or NULL if
+// `offset` is past the end. Unless the buffer is backed by userfaultfd, the pointer is only valid up to
+// the end of the page, and only until `max_resident` other pages have been loaded.
+const uint8_t *rle_lazy_get(struct rle_lazy *lz, size_t offset) {
+	if (offset >= lz->size) {
+		return NULL;
+	}
+	if (lz->uffd < 0) {
+		size_t page = offset / lz->page_size;
+		pthread_mutex_lock(&lz->lock);
+		if (!lz->resident[page]) {
+			rle_lazy_admit(lz, page);
+			rle_lazy_decode_page(lz, page, lz->base + page * lz->page_size);
+		}
+		pthread_mutex_unlock(&lz->lock);
+	}
+	return lz->base + offset;
+}
+
+// Copy up to `dlen` decoded bytes starting at `offset` into `dest`. Returns the number of bytes copied,
+// which is only less than `dlen` at the end of the data.
+ssize_t rle_lazy_read(struct rle_lazy *lz, size_t offset, uint8_t *dest, size_t dlen) {
+	size_t done = 0;
+	while (done < dlen && offset < lz->size) {
+		size_t n = lz->page_size - offset % lz->page_size;
+		if (n > dlen - done) {
+			n = dlen - done;
+		}
+		if (n > lz->size - offset) {
+			n = lz->size - offset;
+		}
+		if (lz->uffd < 0) {
+			// Hold the lock so the page can't be dropped while copying.
+			size_t page = offset / lz->page_size;
+			pthread_mutex_lock(&lz->lock);
+			if (!lz->resident[page]) {
+				rle_lazy_admit(lz, page);
+				rle_lazy_decode_page(lz, page, lz->base + page * lz->page_size);
+			}
+			memcpy(dest + done, lz->base + offset, n);
+			pthread_mutex_unlock(&lz->lock);
+		} else {
+			memcpy(dest + done, lz->base + offset, n);
+		}
+		done += n;
+		offset += n;
+	}
+	return (ssize_t)done;
+}
+
+void rle_lazy_stats(struct rle_lazy *lz, struct rle_lazy_stats *stats) {
+	if (lz->base) {
+		pthread_mutex_lock(&lz->lock);
+		*stats = lz->stats;
+		pthread_mutex_unlock(&lz->lock);
+	} else {
+		*stats = lz->stats;
+	}
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,491 @@
+/*
+	Run-Length Encoder/Decoder (RLE), Long-Run Variant
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	A variant of our own for sparse data, where runs of thousands or millions of bytes are common.
+	The count of an OP continues in a varint when its seven bits run out, so a single REP covers a
+	run of any length, and decodes with one memset.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#else
+#include <sys/types.h> // ssize_t
+#endif
+
+#include "rle_zoo_common.h"
+
+ssize_t longrun_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t longrun_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t longrun_decompress_stream(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen);
+ssize_t longrun_compress_stream(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final);
+ssize_t longrun_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t longrun_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t longrun_parse_op(const uint8_t *src, size_t slen, struct rle_zoo_op *op);
+extern const struct rle_zoo_params longrun_params;
+
+#if defined(RLE_ZOO_LONGRUN_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+static_assert(sizeof(size_t) == sizeof(ssize_t), "");
+
+// return -(rp + 1) ... mask so it can't flip positive. Give up and just always return -1?
+#define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
+
+// RLE PARAMS: min CPY=1, max CPY=127, min REP=3, no max REP. The limit on REPs here is only for estimates.
+const struct rle_zoo_params longrun_params = { 3, 65535, 127, 1, 0 };
+
+#define LONGRUN_MIN_REP 3
+// Longest CPY output by the encoder, the most that fits in the OP byte. Keeps every OP within RLE_ZOO_MAX_OP_SIZE.
+#define LONGRUN_MAX_CPY 127
+// Largest varint accepted, so counts can't overflow.
+#define LONGRUN_MAX_EXT ((size_t)~0 >> 2)
+
+// Least number of input bytes that must be available, short of the end of the input,
+// for longrun_next_op() to make the same decision as it would on the complete input.
+#define LONGRUN_LOOKAHEAD 130
+
+// Decoder states of our own, for reading varints and skipping input after an error.
+#define LONGRUN_DSTREAM_REP_LEN (RLE_ZOO_DSTREAM_CPY + 1)
+#define LONGRUN_DSTREAM_CPY_LEN (RLE_ZOO_DSTREAM_CPY + 2)
+#define LONGRUN_DSTREAM_ERR (RLE_ZOO_DSTREAM_CPY + 3)
+
+static size_t longrun_varint_size(size_t v) {
+	size_t n = 1;
+	while (v >= 0x80) {
+		v >>= 7;
+		++n;
+	}
+	return n;
+}
+
+// Add the seven bits of varint byte `b` at `shift` into `v`. Returns non-zero if the value would exceed LONGRUN_MAX_EXT.
+static inline int longrun_varint_add(size_t *v, uint8_t b, unsigned int shift) {
+	size_t bits = b & 0x7F;
+	if (shift >= 8 * sizeof(size_t) || bits > (LONGRUN_MAX_EXT >> shift)) {
+		return 1;
+	}
+	*v |= bits << shift;
+	return 0;
+}
+
+// Parse the count following OP byte `b`, with any varint starting at src[*rp]. Advances `rp` past the varint.
+// Returns zero, or -1 if the varint is truncated or too large.
+static inline int longrun_get_count(uint8_t b, const uint8_t *src, size_t slen, size_t *rp, size_t *cnt) {
+	size_t n = b & 0x7F;
+	if (n == 0x7F) {
+		size_t ext = 0;
+		unsigned int shift = 0;
+		uint8_t c;
+		do {
+			if (*rp >= slen) {
+				return -1;
+			}
+			c = src[(*rp)++];
+			if (longrun_varint_add(&ext, c, shift)) {
+				return -1;
+			}
+			shift += 7;
+		} while (c & 0x80);
+		n += ext;
+	}
+	*cnt = n + ((b & 0x80) ? LONGRUN_MIN_REP : 1);
+	return 0;
+}
+
+// Returns the length of the run at the start of `src`, comparing a word at a time.
+static size_t longrun_run_length(const uint8_t *src, size_t slen) {
+	const uint64_t pattern = src[0] * 0x0101010101010101ULL;
+	size_t n = 1;
+	while (n + 8 <= slen) {
+		uint64_t diff;
+		memcpy(&diff, src + n, 8);
+		diff ^= pattern;
+		if (diff) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			return n + (size_t)__builtin_ctzll(diff) / 8;
+#else
+			return n + (size_t)__builtin_clzll(diff) / 8;
+#endif
+		}
+		n += 8;
+	}
+	while (n < slen && src[n] == src[0]) {
+		++n;
+	}
+	return n;
+}
+
+// Determine the next OP at the start of `src`. Sets `rep` for a REP, and returns the number of input bytes covered.
+static size_t longrun_next_op(const uint8_t *src, size_t slen, int *rep) {
+	size_t cnt = longrun_run_length(src, slen);
+	*rep = cnt >= LONGRUN_MIN_REP;
+	if (*rep) {
+		return cnt;
+	}
+
+	// Count literals, up to where a REP starts.
+	cnt = 0;
+	while (cnt < slen && cnt < LONGRUN_MAX_CPY) {
+		size_t n = 1;
+		while (n < LONGRUN_MIN_REP && cnt + n < slen && src[cnt + n] == src[cnt]) {
+			++n;
+		}
+		if (n == LONGRUN_MIN_REP) {
+			break;
+		}
+		cnt += n;
+	}
+	if (cnt > LONGRUN_MAX_CPY) {
+		cnt = LONGRUN_MAX_CPY;
+	}
+
+	assert(cnt > 0);
+	assert(cnt <= slen);
+	return cnt;
+}
+
+static size_t longrun_op_size(size_t cnt, int rep) {
+	size_t n = cnt - (rep ? LONGRUN_MIN_REP : 1);
+	size_t len = n < 0x7F ? 1 : 1 + longrun_varint_size(n - 0x7F);
+	return len + (rep ? 1 : cnt);
+}
+
+// Write the OP covering `cnt` bytes of `src` into `dest`, which must have room. Returns the number of bytes written.
+static size_t longrun_put_op(const uint8_t *src, size_t cnt, int rep, uint8_t *dest) {
+	size_t n = cnt - (rep ? LONGRUN_MIN_REP : 1);
+	uint8_t kind = rep ? 0x80 : 0x00;
+	size_t len = 1;
+	if (n < 0x7F) {
+		dest[0] = (uint8_t)(kind | n);
+	} else {
+		dest[0] = (uint8_t)(kind | 0x7F);
+		for (n -= 0x7F ; n >= 0x80 ; n >>= 7) {
+			dest[len++] = (uint8_t)(n | 0x80);
+		}
+		dest[len++] = (uint8_t)n;
+	}
+	if (rep) {
+		dest[len++] = src[0];
+	} else {
+		memcpy(dest + len, src, cnt);
+		len += cnt;
+	}
+	return len;
+}
+
+ssize_t longrun_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	size_t rp = 0;
+	size_t wp = 0;
+
+	while (rp < slen) {
+		assert((ssize_t)wp >= 0);
+		assert((ssize_t)rp >= 0);
+
+		int rep;
+		size_t cnt = longrun_next_op(src + rp, slen - rp, &rep);
+		size_t oplen = longrun_op_size(cnt, rep);
+
+		if (dest) {
+			if (wp + oplen <= dlen) {
+				longrun_put_op(src + rp, cnt, rep, dest + wp);
+			} else {
+				RLE_ZOO_RETURN_ERR;
+			}
+		}
+		rp += cnt;
+		wp += oplen;
+	}
+	assert(rp == slen);
+	assert((dest == NULL) || (wp <= dlen));
+	return (ssize_t)wp;
+}
+
+ssize_t longrun_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	size_t wp = 0;
+	size_t rp = 0;
+	while (rp < slen) {
+		assert((ssize_t)wp >= 0);
+		assert((ssize_t)rp >= 0);
+
+		uint8_t b = src[rp++];
+		// Errors are reported following the OP byte, so read the rest of the OP from `hp`.
+		size_t hp = rp;
+		size_t cnt;
+		if (longrun_get_count(b, src, slen, &hp, &cnt) != 0 || cnt > ((size_t)~0 >> 1UL) - wp) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		if (b & 0x80) {
+			// REP
+			if (!(hp < slen)) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			if (dest) {
+				if (cnt <= dlen - wp) {
+					memset(dest + wp, src[hp], cnt);
+				} else {
+					RLE_ZOO_RETURN_ERR;
+				}
+			}
+			rp = hp + 1;
+		} else {
+			// CPY
+			if (!(cnt <= slen - hp)) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			if (dest) {
+				if (cnt <= dlen - wp) {
+					memcpy(dest + wp, src + hp, cnt);
+				} else {
+					RLE_ZOO_RETURN_ERR;
+				}
+			}
+			rp = hp + cnt;
+		}
+		wp += cnt;
+	}
+	assert(rp == slen);
+	assert((dest == NULL) || (wp <= dlen));
+	return (ssize_t)wp;
+}
+
+// Resumable decoder. Consumes input from `src` and writes output into `dest` until either is
+// exhausted, with OPs allowed to straddle calls on both sides. Sets `consumed` to the number of
+// input bytes used, and returns the number of bytes written. Call rle_zoo_dstream_end() when done.
+ssize_t longrun_decompress_stream(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen) {
+	size_t wp = 0;
+	size_t rp = 0;
+	for (;;) {
+		assert(rp <= slen);
+		assert(wp <= dlen);
+
+		if (ds->state == RLE_ZOO_DSTREAM_REP) {
+			size_t n = ds->cnt < dlen - wp ? ds->cnt : dlen - wp;
+			if (n) {
+				memset(dest + wp, ds->val, n);
+			}
+			wp += n;
+			ds->cnt -= n;
+			if (ds->cnt > 0) {
+				break; // Output full.
+			}
+			ds->state = RLE_ZOO_DSTREAM_OP;
+		} else if (ds->state == RLE_ZOO_DSTREAM_CPY) {
+			size_t n = ds->cnt < dlen - wp ? ds->cnt : dlen - wp;
+			if (n > slen - rp) {
+				n = slen - rp;
+			}
+			if (n) {
+				memcpy(dest + wp, src + rp, n);
+			}
+			rp += n;
+			wp += n;
+			ds->cnt -= n;
+			if (ds->cnt > 0) {
+				break; // Input exhausted or output full.
+			}
+			ds->state = RLE_ZOO_DSTREAM_OP;
+		} else if (ds->state == LONGRUN_DSTREAM_ERR) {
+			// Swallow the rest of the input, leaving the error to rle_zoo_dstream_end().
+			rp = slen;
+			break;
+		} else if (rp == slen) {
+			break;
+		} else if (ds->state == RLE_ZOO_DSTREAM_REP_VAL) {
+			ds->val = src[rp++];
+			ds->state = RLE_ZOO_DSTREAM_REP;
+		} else if (ds->state == LONGRUN_DSTREAM_REP_LEN || ds->state == LONGRUN_DSTREAM_CPY_LEN) {
+			// Accumulate the varint in `cnt`, with the shift kept in `val`.
+			uint8_t c = src[rp++];
+			if (longrun_varint_add(&ds->cnt, c, ds->val)) {
+				ds->state = LONGRUN_DSTREAM_ERR;
+			} else if (c & 0x80) {
+				ds->val += 7;
+			} else {
+				int rep = ds->state == LONGRUN_DSTREAM_REP_LEN;
+				ds->cnt += 0x7Fu + (rep ? (size_t)LONGRUN_MIN_REP : 1u);
+				if (ds->cnt > ((size_t)~0 >> 1UL) - (ds->total_out + wp)) {
+					ds->state = LONGRUN_DSTREAM_ERR;
+				} else {
+					ds->state = rep ? RLE_ZOO_DSTREAM_REP_VAL : RLE_ZOO_DSTREAM_CPY;
+				}
+			}
+		} else {
+			uint8_t b = src[rp++];
+			ds->op_pos = ds->total_in + rp;
+			int rep = b & 0x80;
+			if ((b & 0x7F) == 0x7F) {
+				ds->cnt = 0;
+				ds->val = 0;
+				ds->state = rep ? LONGRUN_DSTREAM_REP_LEN : LONGRUN_DSTREAM_CPY_LEN;
+			} else {
+				ds->cnt = (size_t)(b & 0x7F) + (rep ? LONGRUN_MIN_REP : 1);
+				ds->state = rep ? RLE_ZOO_DSTREAM_REP_VAL : RLE_ZOO_DSTREAM_CPY;
+			}
+		}
+	}
+	*consumed = rp;
+	ds->total_in += rp;
+	ds->total_out += wp;
+	return (ssize_t)wp;
+}
+
+// Resumable encoder. Consumes input from `src` and writes output into `dest`, holding back
+// at most LONGRUN_LOOKAHEAD bytes of input until the next call, or until `final` is set to
+// signal the end of the input. A run reaching the end of the lookahead is counted in `cs->run`
+// until it ends, keeping one byte of it in the window for its value. Sets `consumed` to the
+// number of input bytes used, and returns the number of bytes written. Once `final` is set, call
+// until all input is consumed and nothing more is written. The concatenated output is identical
+// to that of longrun_compress().
+ssize_t longrun_compress_stream(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final) {
+	static_assert(LONGRUN_LOOKAHEAD <= RLE_ZOO_CSTREAM_WINDOW, "");
+	size_t rp = 0;
+	size_t wp = 0;
+	for (;;) {
+		assert(cs->win_rp <= cs->win_len);
+		assert(cs->op_rp <= cs->op_len);
+
+		// Flush any pending OP.
+		if (cs->op_rp < cs->op_len) {
+			size_t n = cs->op_len - cs->op_rp;
+			if (n > dlen - wp) {
+				n = dlen - wp;
+			}
+			memcpy(dest + wp, cs->op + cs->op_rp, n);
+			wp += n;
+			cs->op_rp += n;
+			if (cs->op_rp < cs->op_len) {
+				break; // Output full.
+			}
+		}
+
+		// Top up the window once it runs low.
+		if (cs->win_len - cs->win_rp < LONGRUN_LOOKAHEAD && rp < slen) {
+			cs->win_len -= cs->win_rp;
+			memmove(cs->win, cs->win + cs->win_rp, cs->win_len);
+			cs->win_rp = 0;
+			size_t n = RLE_ZOO_CSTREAM_WINDOW - cs->win_len;
+			if (n > slen - rp) {
+				n = slen - rp;
+			}
+			memcpy(cs->win + cs->win_len, src + rp, n);
+			cs->win_len += n;
+			rp += n;
+		}
+
+		size_t avail = cs->win_len - cs->win_rp;
+		int at_end = final && rp == slen;
+		if (avail == 0 || (avail < LONGRUN_LOOKAHEAD && !at_end)) {
+			break; // Need more input.
+		}
+
+		int rep = 1;
+		const uint8_t *p = cs->win + cs->win_rp;
+		size_t cnt;
+		if (cs->run > 0) {
+			// Continue the run being counted, whose last byte is at the head of the window.
+			cnt = longrun_run_length(p, avail);
+		} else {
+			cnt = longrun_next_op(p, avail, &rep);
+		}
+		if (rep && cnt == avail && !at_end) {
+			// The run may go on; count all but its last byte, and look again with more input.
+			cs->run += cnt - 1;
+			cs->win_rp += cnt - 1;
+			continue;
+		}
+		cs->win_rp += cnt;
+		cnt += cs->run;
+		cs->run = 0;
+		size_t oplen = longrun_op_size(cnt, rep);
+		if (oplen <= dlen - wp) {
+			wp += longrun_put_op(p, cnt, rep, dest + wp);
+		} else {
+			cs->op_len = longrun_put_op(p, cnt, rep, cs->op);
+			cs->op_rp = 0;
+		}
+	}
+	*consumed = rp;
+	cs->total_in += rp;
+	cs->total_out += wp;
+	return (ssize_t)wp;
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t longrun_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+	struct rle_zoo_cstream cs;
+	rle_zoo_cstream_init(&cs);
+
+	size_t rp = 0;
+	ssize_t produced;
+	do {
+		size_t consumed;
+		produced = longrun_compress_stream(&cs, src + rp, slen - rp, &consumed, buf, sizeof(buf), 1);
+		rp += consumed;
+		if (produced > 0 && sink(ctx, buf, (size_t)produced) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+	} while ((size_t)produced == sizeof(buf));
+	assert(rp == slen);
+	return (ssize_t)cs.total_out;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as longrun_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t longrun_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+	struct rle_zoo_dstream ds;
+	rle_zoo_dstream_init(&ds);
+
+	size_t rp = 0;
+	ssize_t produced;
+	do {
+		size_t consumed;
+		produced = longrun_decompress_stream(&ds, src + rp, slen - rp, &consumed, buf, sizeof(buf));
+		rp += consumed;
+		if (produced > 0 && sink(ctx, buf, (size_t)produced) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+	} while ((size_t)produced == sizeof(buf));
+	assert(rp == slen);
+	return rle_zoo_dstream_end(&ds);
+}
+
+// Parse the OP at the start of `src`, without decoding it. Returns the size of the encoded OP,
+// or a negative value if the input is truncated or the count too large.
+ssize_t longrun_parse_op(const uint8_t *src, size_t slen, struct rle_zoo_op *op) {
+	if (slen == 0) {
+		return -1;
+	}
+	uint8_t b = src[0];
+	size_t hp = 1;
+	if (longrun_get_count(b, src, slen, &hp, &op->cnt) != 0) {
+		return -1;
+	}
+	op->data = src + hp;
+	if (b & 0x80) {
+		op->kind = RLE_ZOO_OP_REP;
+		return slen - hp < 1 ? -1 : (ssize_t)hp + 1;
+	}
+	op->kind = RLE_ZOO_OP_CPY;
+	return slen - hp < op->cnt ? -1 : (ssize_t)(hp + op->cnt);
+}
+#undef LONGRUN_LOOKAHEAD
+#undef RLE_ZOO_RETURN_ERR
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,417 @@
+/*
+	Run-Length Encoder/Decoder (RLE), Nibble Variant
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	A variant of our own for 4-bit data, like 16-colour images, which reads the input as a sequence
+	of nibbles, low nibble first, rather than having it unpacked to a byte per nibble:
+
+		0nnnnnnn  CPY n + 1 nibbles, packed into the bytes following the OP
+		1cccvvvv  REP nibble v, c + 4 times, or with c = 7, 11 plus a varint following the OP times
+
+	Run boundaries are found sixteen nibbles at a time with XOR and count-trailing-zeros.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#else
+#include <sys/types.h> // ssize_t
+#endif
+
+#include "rle_zoo_common.h"
+
+ssize_t nibble_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t nibble_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t nibble_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t nibble_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+
+#if defined(RLE_ZOO_NIBBLE_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+static_assert(sizeof(size_t) == sizeof(ssize_t), "");
+
+// return -(rp + 1) ... mask so it can't flip positive. Give up and just always return -1?
+#define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
+
+// RLE PARAMS: in nibbles, min CPY=1, max CPY=128, min REP=4, no max
+#define NIBBLE_MIN_REP 4
+#define NIBBLE_MAX_CPY 128
+// REP counts held by the OP byte, past which a varint follows.
+#define NIBBLE_REP_SHORT 7
+// Largest varint accepted, so counts in bits can't overflow.
+#define NIBBLE_MAX_EXT ((size_t)~0 >> 4)
+#define NIBBLE_ONES 0x1111111111111111ULL
+
+// Output through a sink, buffered into chunks of RLE_ZOO_SINK_BUFFER_SIZE bytes.
+struct nibble_sink {
+	rle_zoo_sink_fp sink;
+	void *ctx;
+	size_t len;
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+};
+
+// Append `len` bytes of `data`, or if it's NULL, `len` copies of `val`. Returns non-zero if the sink aborts.
+static int nibble_sink_put(struct nibble_sink *s, const uint8_t *data, uint8_t val, size_t len) {
+	while (len > 0) {
+		size_t n = sizeof(s->buf) - s->len < len ? sizeof(s->buf) - s->len : len;
+		if (data) {
+			memcpy(s->buf + s->len, data, n);
+			data += n;
+		} else {
+			memset(s->buf + s->len, val, n);
+		}
+		s->len += n;
+		len -= n;
+		if (s->len == sizeof(s->buf)) {
+			if (s->sink(s->ctx, s->buf, s->len) != 0) {
+				return 1;
+			}
+			s->len = 0;
+		}
+	}
+	return 0;
+}
+
+static int nibble_sink_flush(struct nibble_sink *s) {
+	int res = s->len > 0 ? s->sink(s->ctx, s->buf, s->len) : 0;
+	s->len = 0;
+	return res;
+}
+
+// Output to `dest`, or if `s` is set, to the sink. The decoder gathers nibbles in `acc`
+// until they make up whole bytes.
+struct nibble_out {
+	uint8_t *dest;
+	size_t dlen;
+	size_t wp;
+	struct nibble_sink *s;
+	uint64_t acc;
+	unsigned int nacc;	// Number of bits in `acc`.
+};
+
+// Output `len` bytes of `data`, or if it's NULL, `len` copies of `val`. Returns non-zero if they don't fit.
+static int nibble_put(struct nibble_out *o, const uint8_t *data, uint8_t val, size_t len) {
+	if (o->s) {
+		if (nibble_sink_put(o->s, data, val, len) != 0) {
+			return 1;
+		}
+	} else if (o->dest) {
+		if (len > o->dlen - o->wp) {
+			return 1;
+		}
+		if (data) {
+			memcpy(o->dest + o->wp, data, len);
+		} else {
+			memset(o->dest + o->wp, val, len);
+		}
+	}
+	o->wp += len;
+	return 0;
+}
+
+// Output the whole bytes in the accumulator. When it holds more than seven bytes and there's room, `dest`
+// is written a word at a time, where any byte past `len` is the one the remaining bits will complete.
+// Otherwise exactly `len` bytes are written, so nothing is written past the end of the output.
+static int nibble_flush(struct nibble_out *o) {
+	unsigned int len = o->nacc / 8;
+	if (o->s || o->nacc <= 56 || (o->dest && o->dlen - o->wp < 8)) {
+		uint8_t buf[8];
+		for (unsigned int i = 0 ; i < len ; ++i) {
+			buf[i] = (uint8_t)(o->acc >> (8 * i));
+		}
+		if (nibble_put(o, buf, 0, len) != 0) {
+			return 1;
+		}
+	} else {
+		if (o->dest) {
+			uint64_t v = o->acc;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			v = __builtin_bswap64(v);
+#endif
+			memcpy(o->dest + o->wp, &v, 8);
+		}
+		o->wp += len;
+	}
+	o->acc = len == 8 ? 0 : o->acc >> (8 * len);
+	o->nacc -= 8 * len;
+	return 0;
+}
+
+// Append `nbits` bits of `pattern`, repeated, which must be the same in every byte. The accumulator is
+// topped up and output, followed by whole words of the pattern, and what's left is kept in the accumulator.
+// Expects room for at least one byte in the accumulator.
+static int nibble_fill(struct nibble_out *o, uint64_t pattern, size_t nbits) {
+	assert(o->nacc <= 56);
+	if (nbits < 64 - o->nacc) {
+		o->acc |= (pattern & ((1ULL << nbits) - 1)) << o->nacc;
+		o->nacc += (unsigned int)nbits;
+		return 0;
+	}
+	nbits -= 64 - o->nacc;
+	o->acc |= pattern << o->nacc;
+	o->nacc = 64;
+	if (nibble_flush(o) != 0) {
+		return 1;
+	}
+	if (nbits >= 64) {
+		size_t len = nbits / 64 * 8;
+		if (len <= 64 && !o->s && o->dest && o->dlen - o->wp >= len) {
+			for (size_t i = 0 ; i < len ; i += 8) {
+				memcpy(o->dest + o->wp + i, &pattern, 8);
+			}
+			o->wp += len;
+		} else if (nibble_put(o, NULL, (uint8_t)pattern, len) != 0) {
+			return 1;
+		}
+		nbits -= 8 * len;
+	}
+	o->acc = pattern & ((1ULL << nbits) - 1);
+	o->nacc = (unsigned int)nbits;
+	return 0;
+}
+
+// The eight bytes at `src` as a little-endian word, so nibble i is at bit 4 * i on any host.
+static inline uint64_t nibble_load64(const uint8_t *src) {
+	uint64_t v;
+	memcpy(&v, src, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+// Append the first `nbits` bits of `src`, which holds `avail` bytes, low bit first. Expects room for at
+// least one byte in the accumulator.
+static int nibble_append(struct nibble_out *o, const uint8_t *src, size_t avail, size_t nbits) {
+	assert(o->nacc <= 56);
+	if (o->nacc == 0 && nbits >= 128) {
+		// Byte aligned; copy the whole bytes directly.
+		if (nibble_put(o, src, 0, nbits / 8) != 0) {
+			return 1;
+		}
+		src += nbits / 8;
+		avail -= nbits / 8;
+		nbits %= 8;
+	}
+	while (nbits > 0) {
+		size_t k = (64 - o->nacc) & ~7U;
+		if (k > nbits) {
+			k = nbits;
+		}
+		uint64_t v = 0;
+		if (avail >= 8) {
+			v = nibble_load64(src);
+		} else {
+			for (size_t i = 0 ; i < avail ; ++i) {
+				v |= (uint64_t)src[i] << (8 * i);
+			}
+		}
+		if (k < 64) {
+			v &= (1ULL << k) - 1;
+		}
+		o->acc |= v << o->nacc;
+		o->nacc += (unsigned int)k;
+		src += k / 8;
+		avail -= k / 8;
+		nbits -= k;
+		if (o->nacc > 56 && nibble_flush(o) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static inline unsigned int nibble_at(const uint8_t *src, size_t i) {
+	return (src[i >> 1] >> ((i & 1) * 4)) & 0xF;
+}
+
+// Returns the number of nibbles in the run of nibble `i` of `src`, not counting past nibble `n`.
+static size_t nibble_run_length(const uint8_t *src, size_t n, size_t i) {
+	const uint64_t pattern = nibble_at(src, i) * NIBBLE_ONES;
+	size_t p = i + 1;
+	// Compare a word at a time. Shifting an odd nibble into place leaves the top nibble clear, which reads as equal.
+	while ((p >> 1) + 8 <= n >> 1) {
+		uint64_t diff = (nibble_load64(src + (p >> 1)) ^ pattern) >> ((p & 1) * 4);
+		if (diff) {
+			return p - i + (size_t)__builtin_ctzll(diff) / 4;
+		}
+		p += 16 - (p & 1);
+	}
+	while (p < n && nibble_at(src, p) == nibble_at(src, i)) {
+		++p;
+	}
+	return p - i;
+}
+
+// Returns the number of nibbles from nibble `i` of `src`, out of `n`, to output as a CPY. Stops
+// at the first run long enough for a REP.
+static size_t nibble_scan_literals(const uint8_t *src, size_t n, size_t i) {
+	size_t p = i;
+	while (p < n && p - i < NIBBLE_MAX_CPY) {
+		// Skip several nibbles at a time while no two neighbouring nibbles are equal.
+		if ((p >> 1) + 8 <= n >> 1) {
+			uint64_t w = nibble_load64(src + (p >> 1)) >> ((p & 1) * 4);
+			unsigned int pairs = 15 - (unsigned int)(p & 1);
+			// Nibble j of `d` is zero where nibbles j and j+1 are equal. Pairs past the word are marked unequal.
+			uint64_t d = (w ^ (w >> 4)) | (NIBBLE_ONES & ~((1ULL << (4 * pairs)) - 1));
+			if ((((d - NIBBLE_ONES) & ~d) & (NIBBLE_ONES << 3)) == 0) {
+				p += pairs;
+				continue;
+			}
+		}
+		size_t run = nibble_run_length(src, n - p < NIBBLE_MIN_REP ? n : p + NIBBLE_MIN_REP, p);
+		if (run >= NIBBLE_MIN_REP) {
+			break;
+		}
+		p += run;
+	}
+	return p - i < NIBBLE_MAX_CPY ? p - i : NIBBLE_MAX_CPY;
+}
+
+static size_t nibble_put_rep(uint8_t *dest, size_t cnt, unsigned int val) {
+	size_t n = cnt - NIBBLE_MIN_REP;
+	size_t len = 1;
+	dest[0] = (uint8_t)(0x80 | (n < NIBBLE_REP_SHORT ? n : NIBBLE_REP_SHORT) << 4 | val);
+	if (n >= NIBBLE_REP_SHORT) {
+		for (n -= NIBBLE_REP_SHORT ; n >= 0x80 ; n >>= 7) {
+			dest[len++] = (uint8_t)(n | 0x80);
+		}
+		dest[len++] = (uint8_t)n;
+	}
+	return len;
+}
+
+// Encode into the output.
+static inline ssize_t nibble_encode(const uint8_t *src, size_t slen, struct nibble_out *o) {
+	const size_t n = 2 * slen;
+	size_t i = 0;
+	while (i < n) {
+		uint8_t op[1 + NIBBLE_MAX_CPY / 2];
+		size_t len;
+		size_t cnt = nibble_run_length(src, n, i);
+		if (cnt >= NIBBLE_MIN_REP) {
+			len = nibble_put_rep(op, cnt, nibble_at(src, i));
+		} else {
+			cnt = nibble_scan_literals(src, n, i);
+			op[0] = (uint8_t)(cnt - 1);
+			len = 1 + (cnt + 1) / 2;
+			if (i & 1) {
+				for (size_t j = 0 ; j < cnt ; j += 2) {
+					unsigned int hi = j + 1 < cnt ? nibble_at(src, i + j + 1) : 0;
+					op[1 + j / 2] = (uint8_t)(nibble_at(src, i + j) | hi << 4);
+				}
+			} else {
+				memcpy(op + 1, src + i / 2, cnt / 2);
+				if (cnt & 1) {
+					op[len - 1] = (uint8_t)nibble_at(src, i + cnt - 1);
+				}
+			}
+		}
+		if (nibble_put(o, op, 0, len) != 0) {
+			size_t rp = i / 2;
+			RLE_ZOO_RETURN_ERR;
+		}
+		i += cnt;
+	}
+	return (ssize_t)o->wp;
+}
+
+// Decode into the output.
+static inline ssize_t nibble_decode(const uint8_t *src, size_t slen, struct nibble_out *o) {
+	size_t rp = 0;
+	while (rp < slen) {
+		assert((ssize_t)o->wp >= 0);
+		uint8_t b = src[rp++];
+		if (o->nacc > 56 && nibble_flush(o) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		if (b & 0x80) {
+			size_t cnt = (b >> 4) & 7;
+			size_t hp = rp;
+			if (cnt == NIBBLE_REP_SHORT) {
+				size_t ext = 0;
+				for (unsigned int shift = 0 ; ; shift += 7) {
+					if (hp >= slen || shift >= 64) {
+						RLE_ZOO_RETURN_ERR;
+					}
+					uint8_t e = src[hp++];
+					ext |= (size_t)(e & 0x7F) << shift;
+					if (!(e & 0x80)) {
+						break;
+					}
+				}
+				if (ext > NIBBLE_MAX_EXT) {
+					RLE_ZOO_RETURN_ERR;
+				}
+				cnt += ext;
+			}
+			cnt += NIBBLE_MIN_REP;
+			if (cnt / 2 + 1 > ((size_t)~0 >> 1UL) - o->wp || nibble_fill(o, (b & 0xF) * NIBBLE_ONES, 4 * cnt) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			rp = hp;
+		} else {
+			size_t cnt = (size_t)b + 1;
+			if ((cnt + 1) / 2 > slen - rp || nibble_append(o, src + rp, slen - rp, 4 * cnt) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			rp += (cnt + 1) / 2;
+		}
+	}
+	// The output must be whole bytes.
+	if (nibble_flush(o) != 0 || o->nacc != 0) {
+		RLE_ZOO_RETURN_ERR;
+	}
+	assert(rp == slen);
+	assert((o->dest == NULL) || (o->wp <= o->dlen));
+	return (ssize_t)o->wp;
+}
+
+ssize_t nibble_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	struct nibble_out o = { dest, dlen, 0, NULL, 0, 0 };
+	return nibble_encode(src, slen, &o);
+}
+
+ssize_t nibble_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	struct nibble_out o = { dest, dlen, 0, NULL, 0, 0 };
+	return nibble_decode(src, slen, &o);
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t nibble_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct nibble_sink s = { sink, ctx, 0, { 0 } };
+	struct nibble_out o = { NULL, 0, 0, &s, 0, 0 };
+	ssize_t res = nibble_encode(src, slen, &o);
+	if (res >= 0 && nibble_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as nibble_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t nibble_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct nibble_sink s = { sink, ctx, 0, { 0 } };
+	struct nibble_out o = { NULL, 0, 0, &s, 0, 0 };
+	ssize_t res = nibble_decode(src, slen, &o);
+	if (res >= 0 && nibble_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+#undef RLE_ZOO_RETURN_ERR
+#endif
+
+#ifdef __cplusplus
+}
+#endif
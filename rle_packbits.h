@@ -17,11 +17,20 @@ typedef SSIZE_T ssize_t;
 #include <sys/types.h> // ssize_t
 #endif
 
+#include "rle_zoo_common.h"
+
 ssize_t packbits_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
 ssize_t packbits_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t packbits_decompress_stream(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen);
+ssize_t packbits_compress_stream(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final);
+ssize_t packbits_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t packbits_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t packbits_parse_op(const uint8_t *src, size_t slen, struct rle_zoo_op *op);
+extern const struct rle_zoo_params packbits_params;
 
 #if defined(RLE_ZOO_PACKBITS_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
 #include <assert.h>
+#include <string.h>
 
 static_assert(sizeof(size_t) == sizeof(ssize_t), "");
 
@@ -29,6 +38,47 @@ static_assert(sizeof(size_t) == sizeof(ssize_t), "");
 #define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
 
 // RLE PARAMS: min CPY=1, max CPY=128, min REP=2, max REP=128
+const struct rle_zoo_params packbits_params = { 2, 128, 128, 1, 0 };
+
+// Least number of input bytes that must be available, short of the end of the input,
+// for packbits_next_op() to make the same decision as it would on the complete input.
+#define PACKBITS_LOOKAHEAD 129
+
+// Determine the next OP at the start of `src`. Sets `rep` for a REP, and returns the number of input bytes covered.
+static size_t packbits_next_op(const uint8_t *src, size_t slen, int *rep) {
+	size_t cnt = 0;
+	do { ++cnt; } while ((cnt < slen) && (cnt < 128) && (src[cnt-1] == src[cnt]));
+
+	*rep = cnt > 1;
+	if (*rep) {
+		assert(cnt >= 2 && cnt <= 128);
+		return cnt;
+	}
+
+	cnt = 0;
+	// Count number of literal bytes, up to 128.
+	while ((cnt+1 <= slen) && (cnt < 128) && ((cnt+1 == slen) || (src[cnt] != src[cnt+1]))) {
+		++cnt;
+	}
+
+	assert(cnt > 0);
+	assert(cnt <= 128);
+	assert(cnt <= slen);
+	return cnt;
+}
+
+// Write the OP covering `cnt` bytes of `src` into `dest`, which must have room. Returns the number of bytes written.
+static size_t packbits_put_op(const uint8_t *src, size_t cnt, int rep, uint8_t *dest) {
+	if (rep) {
+		dest[0] = (uint8_t)(257 - cnt);
+		dest[1] = src[0];
+		return 2;
+	}
+	dest[0] = (uint8_t)(cnt - 1);
+	memcpy(dest + 1, src, cnt);
+	return cnt + 1;
+}
+
 ssize_t packbits_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
 	size_t rp = 0;
 	size_t wp = 0;
@@ -37,47 +87,19 @@ ssize_t packbits_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t
 		assert((ssize_t)wp >= 0);
 		assert((ssize_t)rp >= 0);
 
-		uint8_t cnt = 0;
-		do { ++cnt; } while ((rp + cnt < slen) && (cnt < 128) && (src[rp + cnt-1] == src[rp + cnt]));
-
-		// Output REP.
-		if (cnt > 1) {
-			assert(cnt >= 2 && cnt <= 128);
-			if (dest) {
-				if (wp + 1 < dlen) {
-					dest[wp+0] = (uint8_t)(257 - cnt);
-					dest[wp+1] = src[rp];
-				} else {
-					RLE_ZOO_RETURN_ERR;
-				}
-			}
-			wp += 2;
-			rp += cnt;
-			continue;
-		}
-
-		cnt = 0;
-		// Count number of literal bytes, up to 128.
-		while ((rp+cnt+1 <= slen) && (cnt < 128) && ((rp+cnt+1 == slen) || (src[rp+cnt] != src[rp+cnt+1]))) {
-			++cnt;
-		}
-
-		assert(cnt > 0);
-		assert(cnt <= 128);
-		assert(rp + cnt <= slen);
+		int rep;
+		size_t cnt = packbits_next_op(src + rp, slen - rp, &rep);
+		size_t oplen = rep ? 2 : cnt + 1;
 
-		// Output CPY
 		if (dest) {
-			if (wp + cnt + 1 <= dlen) {
-				dest[wp] = cnt - 1;
-				for (unsigned int i = 0 ; i < cnt ; ++i)
-					dest[wp + 1 + i] = src[rp + i];
+			if (wp + oplen <= dlen) {
+				packbits_put_op(src + rp, cnt, rep, dest + wp);
 			} else {
 				RLE_ZOO_RETURN_ERR;
 			}
 		}
 		rp += cnt;
-		wp += cnt + 1;
+		wp += oplen;
 	}
 	assert(rp == slen);
 	assert((dest == NULL) || (wp <= dlen));
@@ -130,6 +152,198 @@ ssize_t packbits_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size
 	assert((dest == NULL) || (wp <= dlen));
 	return (ssize_t)wp;
 }
+
+// Resumable decoder. Consumes input from `src` and writes output into `dest` until either is
+// exhausted, with OPs allowed to straddle calls on both sides. Sets `consumed` to the number of
+// input bytes used, and returns the number of bytes written. Call rle_zoo_dstream_end() when done.
+ssize_t packbits_decompress_stream(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen) {
+	size_t wp = 0;
+	size_t rp = 0;
+	for (;;) {
+		assert(rp <= slen);
+		assert(wp <= dlen);
+
+		if (ds->state == RLE_ZOO_DSTREAM_REP) {
+			size_t n = ds->cnt < dlen - wp ? ds->cnt : dlen - wp;
+			if (n) {
+				memset(dest + wp, ds->val, n);
+			}
+			wp += n;
+			ds->cnt -= n;
+			if (ds->cnt > 0) {
+				break; // Output full.
+			}
+			ds->state = RLE_ZOO_DSTREAM_OP;
+		} else if (ds->state == RLE_ZOO_DSTREAM_CPY) {
+			size_t n = ds->cnt < dlen - wp ? ds->cnt : dlen - wp;
+			if (n > slen - rp) {
+				n = slen - rp;
+			}
+			if (n) {
+				memcpy(dest + wp, src + rp, n);
+			}
+			rp += n;
+			wp += n;
+			ds->cnt -= n;
+			if (ds->cnt > 0) {
+				break; // Input exhausted or output full.
+			}
+			ds->state = RLE_ZOO_DSTREAM_OP;
+		} else if (rp == slen) {
+			break;
+		} else if (ds->state == RLE_ZOO_DSTREAM_REP_VAL) {
+			ds->val = src[rp++];
+			ds->state = RLE_ZOO_DSTREAM_REP;
+		} else {
+			uint8_t b = src[rp++];
+			ds->op_pos = ds->total_in + rp;
+			if (b > 0x80) {
+				ds->cnt = (size_t)(257 - b);
+				ds->state = RLE_ZOO_DSTREAM_REP_VAL;
+			} else if (b < 0x80) {
+				ds->cnt = (size_t)b + 1;
+				ds->state = RLE_ZOO_DSTREAM_CPY;
+			} // else b == 0x80: Reserved. Just skip byte as suggested by TN1023.
+		}
+	}
+	*consumed = rp;
+	ds->total_in += rp;
+	ds->total_out += wp;
+	return (ssize_t)wp;
+}
+
+// Resumable encoder. Consumes input from `src` and writes output into `dest`, holding back
+// at most PACKBITS_LOOKAHEAD bytes of input until the next call, or until `final` is set to
+// signal the end of the input. Sets `consumed` to the number of input bytes used, and returns
+// the number of bytes written. Once `final` is set, call until all input is consumed and
+// nothing more is written. The concatenated output is identical to that of packbits_compress().
+ssize_t packbits_compress_stream(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final) {
+	static_assert(PACKBITS_LOOKAHEAD <= RLE_ZOO_CSTREAM_WINDOW, "");
+	size_t rp = 0;
+	size_t wp = 0;
+	for (;;) {
+		assert(cs->win_rp <= cs->win_len);
+		assert(cs->op_rp <= cs->op_len);
+
+		// Flush any pending OP.
+		if (cs->op_rp < cs->op_len) {
+			size_t n = cs->op_len - cs->op_rp;
+			if (n > dlen - wp) {
+				n = dlen - wp;
+			}
+			memcpy(dest + wp, cs->op + cs->op_rp, n);
+			wp += n;
+			cs->op_rp += n;
+			if (cs->op_rp < cs->op_len) {
+				break; // Output full.
+			}
+		}
+
+		// Top up the window once it runs low.
+		if (cs->win_len - cs->win_rp < PACKBITS_LOOKAHEAD && rp < slen) {
+			cs->win_len -= cs->win_rp;
+			memmove(cs->win, cs->win + cs->win_rp, cs->win_len);
+			cs->win_rp = 0;
+			size_t n = RLE_ZOO_CSTREAM_WINDOW - cs->win_len;
+			if (n > slen - rp) {
+				n = slen - rp;
+			}
+			memcpy(cs->win + cs->win_len, src + rp, n);
+			cs->win_len += n;
+			rp += n;
+		}
+
+		size_t avail = cs->win_len - cs->win_rp;
+		if (avail == 0 || (avail < PACKBITS_LOOKAHEAD && !(final && rp == slen))) {
+			break; // Need more input.
+		}
+
+		int rep;
+		const uint8_t *p = cs->win + cs->win_rp;
+		size_t cnt = packbits_next_op(p, avail, &rep);
+		size_t oplen = rep ? 2 : cnt + 1;
+		if (oplen <= dlen - wp) {
+			wp += packbits_put_op(p, cnt, rep, dest + wp);
+		} else {
+			cs->op_len = packbits_put_op(p, cnt, rep, cs->op);
+			cs->op_rp = 0;
+		}
+		cs->win_rp += cnt;
+	}
+	*consumed = rp;
+	cs->total_in += rp;
+	cs->total_out += wp;
+	return (ssize_t)wp;
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t packbits_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+	struct rle_zoo_cstream cs;
+	rle_zoo_cstream_init(&cs);
+
+	size_t rp = 0;
+	ssize_t produced;
+	do {
+		size_t consumed;
+		produced = packbits_compress_stream(&cs, src + rp, slen - rp, &consumed, buf, sizeof(buf), 1);
+		rp += consumed;
+		if (produced > 0 && sink(ctx, buf, (size_t)produced) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+	} while ((size_t)produced == sizeof(buf));
+	assert(rp == slen);
+	return (ssize_t)cs.total_out;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as packbits_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t packbits_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+	struct rle_zoo_dstream ds;
+	rle_zoo_dstream_init(&ds);
+
+	size_t rp = 0;
+	ssize_t produced;
+	do {
+		size_t consumed;
+		produced = packbits_decompress_stream(&ds, src + rp, slen - rp, &consumed, buf, sizeof(buf));
+		rp += consumed;
+		if (produced > 0 && sink(ctx, buf, (size_t)produced) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+	} while ((size_t)produced == sizeof(buf));
+	assert(rp == slen);
+	return rle_zoo_dstream_end(&ds);
+}
+
+// Parse the OP at the start of `src`, without decoding it. Returns the size of the encoded OP,
+// or a negative value if the input is truncated.
+ssize_t packbits_parse_op(const uint8_t *src, size_t slen, struct rle_zoo_op *op) {
+	if (slen == 0) {
+		return -1;
+	}
+	uint8_t b = src[0];
+	if (b > 0x80) {
+		op->kind = RLE_ZOO_OP_REP;
+		op->cnt = (size_t)(257 - b);
+		op->data = src + 1;
+		return slen < 2 ? -1 : 2;
+	} else if (b < 0x80) {
+		op->kind = RLE_ZOO_OP_CPY;
+		op->cnt = (size_t)b + 1;
+		op->data = src + 1;
+		return slen < op->cnt + 1 ? -1 : (ssize_t)op->cnt + 1;
+	}
+	// b == 0x80: Reserved. Just skip byte as suggested by TN1023.
+	op->kind = RLE_ZOO_OP_NOP;
+	op->cnt = 0;
+	op->data = NULL;
+	return 1;
+}
+#undef PACKBITS_LOOKAHEAD
 #undef RLE_ZOO_RETURN_ERR
 #endif
 
@@ -17,17 +17,58 @@ typedef SSIZE_T ssize_t;
 #include <sys/types.h> // ssize_t
 #endif
 
+#include "rle_zoo_common.h"
+
 ssize_t pcx_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
 ssize_t pcx_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t pcx_decompress_stream(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen);
+ssize_t pcx_compress_stream(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final);
+ssize_t pcx_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t pcx_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t pcx_parse_op(const uint8_t *src, size_t slen, struct rle_zoo_op *op);
+extern const struct rle_zoo_params pcx_params;
 
 #if defined(RLE_ZOO_PCX_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
 #include <assert.h>
+#include <string.h>
 
 static_assert(sizeof(size_t) == sizeof(ssize_t), "");
 
 // return -(rp + 1) ... mask so it can't flip positive. Give up and just always return -1?
 #define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
 
+// RLE PARAMS: max REP=63, LITs from 0xC0 up are encoded as a REP of one
+const struct rle_zoo_params pcx_params = { 2, 63, 1, 0, 0xC0 };
+
+// Least number of input bytes that must be available, short of the end of the input,
+// for pcx_next_op() to make the same decision as it would on the complete input.
+#define PCX_LOOKAHEAD 63
+
+// Determine the next OP at the start of `src`. Sets `rep` for a REP, and returns the number of input bytes covered.
+static size_t pcx_next_op(const uint8_t *src, size_t slen, int *rep) {
+	size_t cnt = 0;
+	do { ++cnt; } while ((cnt < slen) && (cnt < 63) && (src[cnt - 1] == src[cnt]));
+
+	// Output REP, also include any bytes that can't be encoded as a LIT.
+	// PERF: Again, this is probably suboptimal, and also results in encoding runs of 2 LITs as REP, which differs from IM encoder.
+	*rep = cnt > 1 || ((src[0] & 0xC0) == 0xC0); // or >= 192
+	assert(cnt <= 63);
+	assert(*rep || cnt == 1);
+	return cnt;
+}
+
+// Write the OP covering `cnt` bytes of `src` into `dest`, which must have room. Returns the number of bytes written.
+static size_t pcx_put_op(const uint8_t *src, size_t cnt, int rep, uint8_t *dest) {
+	if (rep) {
+		dest[0] = (uint8_t)(0xC0 | cnt);
+		dest[1] = src[0];
+		return 2;
+	}
+	// Output LIT.
+	dest[0] = src[0];
+	return 1;
+}
+
 ssize_t pcx_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
 	size_t rp = 0;
 	size_t wp = 0;
@@ -36,36 +77,19 @@ ssize_t pcx_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen
 		assert((ssize_t)wp >= 0);
 		assert((ssize_t)rp >= 0);
 
-		size_t cnt = 0;
-		// size_t cnt = rle_count_rep(src + rp, slen - rp, 63);
-		do { ++cnt; } while ((rp + cnt < slen) && (cnt < 63) && (src[rp + cnt - 1] == src[rp + cnt]));
-
-		// Output REP, also include any bytes that can't be encoded as a LIT.
-		if (cnt > 1 || ((src[rp] & 0xC0) == 0xC0)) { // or >= 192
-			assert(cnt <= 63);
-			if (dest) {
-				if (wp + 1 < dlen) {
-					dest[wp+0] = (uint8_t)(0xC0 | cnt);
-					dest[wp+1] = src[rp];
-				} else {
-					RLE_ZOO_RETURN_ERR;
-				}
-			}
-			wp += 2;
-			rp += cnt;
-		} else {
-			// Output LIT.
-			// PERF: Again, this is probably suboptimal, and also results in encoding runs of 2 LITs as REP, which differs from IM encoder.
-			if (dest) {
-				if (wp < dlen) {
-					dest[wp] = src[rp];
-				} else {
-					RLE_ZOO_RETURN_ERR;
-				}
+		int rep;
+		size_t cnt = pcx_next_op(src + rp, slen - rp, &rep);
+		size_t oplen = rep ? 2 : 1;
+
+		if (dest) {
+			if (wp + oplen <= dlen) {
+				pcx_put_op(src + rp, cnt, rep, dest + wp);
+			} else {
+				RLE_ZOO_RETURN_ERR;
 			}
-			++rp;
-			++wp;
 		}
+		rp += cnt;
+		wp += oplen;
 	}
 	assert(rp == slen);
 	assert((dest == NULL) || (wp <= dlen));
@@ -104,6 +128,194 @@ ssize_t pcx_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dl
 	assert((dest == NULL) || (wp <= dlen));
 	return (ssize_t)wp;
 }
+
+// Resumable decoder. Consumes input from `src` and writes output into `dest` until either is
+// exhausted, with OPs allowed to straddle calls on both sides. Sets `consumed` to the number of
+// input bytes used, and returns the number of bytes written. Call rle_zoo_dstream_end() when done.
+ssize_t pcx_decompress_stream(struct rle_zoo_dstream *ds, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen) {
+	size_t wp = 0;
+	size_t rp = 0;
+	for (;;) {
+		assert(rp <= slen);
+		assert(wp <= dlen);
+
+		if (ds->state == RLE_ZOO_DSTREAM_REP) {
+			size_t n = ds->cnt < dlen - wp ? ds->cnt : dlen - wp;
+			if (n) {
+				memset(dest + wp, ds->val, n);
+			}
+			wp += n;
+			ds->cnt -= n;
+			if (ds->cnt > 0) {
+				break; // Output full.
+			}
+			ds->state = RLE_ZOO_DSTREAM_OP;
+		} else if (ds->state == RLE_ZOO_DSTREAM_CPY) {
+			size_t n = ds->cnt < dlen - wp ? ds->cnt : dlen - wp;
+			if (n > slen - rp) {
+				n = slen - rp;
+			}
+			if (n) {
+				memcpy(dest + wp, src + rp, n);
+			}
+			rp += n;
+			wp += n;
+			ds->cnt -= n;
+			if (ds->cnt > 0) {
+				break; // Input exhausted or output full.
+			}
+			ds->state = RLE_ZOO_DSTREAM_OP;
+		} else if (rp == slen) {
+			break;
+		} else if (ds->state == RLE_ZOO_DSTREAM_REP_VAL) {
+			ds->val = src[rp++];
+			ds->state = RLE_ZOO_DSTREAM_REP;
+		} else {
+			uint8_t b = src[rp++];
+			ds->op_pos = ds->total_in + rp;
+			if ((b & 0xC0) == 0xC0) {
+				ds->cnt = b & 0x3F;
+				ds->state = RLE_ZOO_DSTREAM_REP_VAL;
+			} else {
+				// LIT is output as a REP 1 of itself.
+				ds->cnt = 1;
+				ds->val = b;
+				ds->state = RLE_ZOO_DSTREAM_REP;
+			}
+		}
+	}
+	*consumed = rp;
+	ds->total_in += rp;
+	ds->total_out += wp;
+	return (ssize_t)wp;
+}
+
+// Resumable encoder. Consumes input from `src` and writes output into `dest`, holding back
+// at most PCX_LOOKAHEAD bytes of input until the next call, or until `final` is set to
+// signal the end of the input. Sets `consumed` to the number of input bytes used, and returns
+// the number of bytes written. Once `final` is set, call until all input is consumed and
+// nothing more is written. The concatenated output is identical to that of pcx_compress().
+ssize_t pcx_compress_stream(struct rle_zoo_cstream *cs, const uint8_t *src, size_t slen, size_t *consumed, uint8_t *dest, size_t dlen, int final) {
+	static_assert(PCX_LOOKAHEAD <= RLE_ZOO_CSTREAM_WINDOW, "");
+	size_t rp = 0;
+	size_t wp = 0;
+	for (;;) {
+		assert(cs->win_rp <= cs->win_len);
+		assert(cs->op_rp <= cs->op_len);
+
+		// Flush any pending OP.
+		if (cs->op_rp < cs->op_len) {
+			size_t n = cs->op_len - cs->op_rp;
+			if (n > dlen - wp) {
+				n = dlen - wp;
+			}
+			memcpy(dest + wp, cs->op + cs->op_rp, n);
+			wp += n;
+			cs->op_rp += n;
+			if (cs->op_rp < cs->op_len) {
+				break; // Output full.
+			}
+		}
+
+		// Top up the window once it runs low.
+		if (cs->win_len - cs->win_rp < PCX_LOOKAHEAD && rp < slen) {
+			cs->win_len -= cs->win_rp;
+			memmove(cs->win, cs->win + cs->win_rp, cs->win_len);
+			cs->win_rp = 0;
+			size_t n = RLE_ZOO_CSTREAM_WINDOW - cs->win_len;
+			if (n > slen - rp) {
+				n = slen - rp;
+			}
+			memcpy(cs->win + cs->win_len, src + rp, n);
+			cs->win_len += n;
+			rp += n;
+		}
+
+		size_t avail = cs->win_len - cs->win_rp;
+		if (avail == 0 || (avail < PCX_LOOKAHEAD && !(final && rp == slen))) {
+			break; // Need more input.
+		}
+
+		int rep;
+		const uint8_t *p = cs->win + cs->win_rp;
+		size_t cnt = pcx_next_op(p, avail, &rep);
+		size_t oplen = rep ? 2 : 1;
+		if (oplen <= dlen - wp) {
+			wp += pcx_put_op(p, cnt, rep, dest + wp);
+		} else {
+			cs->op_len = pcx_put_op(p, cnt, rep, cs->op);
+			cs->op_rp = 0;
+		}
+		cs->win_rp += cnt;
+	}
+	*consumed = rp;
+	cs->total_in += rp;
+	cs->total_out += wp;
+	return (ssize_t)wp;
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t pcx_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+	struct rle_zoo_cstream cs;
+	rle_zoo_cstream_init(&cs);
+
+	size_t rp = 0;
+	ssize_t produced;
+	do {
+		size_t consumed;
+		produced = pcx_compress_stream(&cs, src + rp, slen - rp, &consumed, buf, sizeof(buf), 1);
+		rp += consumed;
+		if (produced > 0 && sink(ctx, buf, (size_t)produced) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+	} while ((size_t)produced == sizeof(buf));
+	assert(rp == slen);
+	return (ssize_t)cs.total_out;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as pcx_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t pcx_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+	struct rle_zoo_dstream ds;
+	rle_zoo_dstream_init(&ds);
+
+	size_t rp = 0;
+	ssize_t produced;
+	do {
+		size_t consumed;
+		produced = pcx_decompress_stream(&ds, src + rp, slen - rp, &consumed, buf, sizeof(buf));
+		rp += consumed;
+		if (produced > 0 && sink(ctx, buf, (size_t)produced) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+	} while ((size_t)produced == sizeof(buf));
+	assert(rp == slen);
+	return rle_zoo_dstream_end(&ds);
+}
+
+// Parse the OP at the start of `src`, without decoding it. Returns the size of the encoded OP,
+// or a negative value if the input is truncated.
+ssize_t pcx_parse_op(const uint8_t *src, size_t slen, struct rle_zoo_op *op) {
+	if (slen == 0) {
+		return -1;
+	}
+	uint8_t b = src[0];
+	if ((b & 0xC0) == 0xC0) {
+		op->kind = RLE_ZOO_OP_REP;
+		op->cnt = b & 0x3F;
+		op->data = src + 1;
+		return slen < 2 ? -1 : 2;
+	}
+	op->kind = RLE_ZOO_OP_LIT;
+	op->cnt = 1;
+	op->data = src;
+	return 1;
+}
+#undef PCX_LOOKAHEAD
 #undef RLE_ZOO_RETURN_ERR
 #endif
 
@@ -0,0 +1,189 @@
+/*
+	Compressed-Domain Queries on Run-Length Encoded (RLE) Data
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Computes statistics of the decoded data of any variant without decoding it. A REP
+	contributes its value times its count arithmetically, and only CPY payloads are
+	scanned, so long runs cost nothing. Results are the same as decoding and computing.
+
+	Include one or more of the rle_<variant>.h headers first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_query.h"
+#endif
+
+ssize_t rle_query_histogram(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint64_t hist[256]);
+ssize_t rle_query_count(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t val, uint64_t *count);
+ssize_t rle_query_sum(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint64_t *sum);
+int rle_query_equal(rle_zoo_parse_op_fp parse_a, const uint8_t *a, size_t alen, rle_zoo_parse_op_fp parse_b, const uint8_t *b, size_t blen);
+
+#if defined(RLE_ZOO_QUERY_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+// Clear `hist` and fill it with the number of occurrences of each byte value in the decoded data.
+// Returns the decoded length, or the same error as the variant's decoder on truncated input.
+ssize_t rle_query_histogram(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint64_t hist[256]) {
+	// Four sub-histograms, to avoid stalling on consecutive increments of the same counter.
+	uint64_t sub[4][256];
+	memset(sub, 0, sizeof(sub));
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			return (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL));
+		}
+		if (op.kind == RLE_ZOO_OP_REP) {
+			sub[0][op.data[0]] += op.cnt;
+		} else if (op.cnt > 0) {
+			size_t i = 0;
+			for ( ; i + 4 <= op.cnt ; i += 4) {
+				sub[0][op.data[i + 0]]++;
+				sub[1][op.data[i + 1]]++;
+				sub[2][op.data[i + 2]]++;
+				sub[3][op.data[i + 3]]++;
+			}
+			for ( ; i < op.cnt ; ++i) {
+				sub[0][op.data[i]]++;
+			}
+		}
+		wp += op.cnt;
+		rp += (size_t)oplen;
+	}
+	for (size_t v = 0 ; v < 256 ; ++v) {
+		hist[v] = sub[0][v] + sub[1][v] + sub[2][v] + sub[3][v];
+	}
+	return (ssize_t)wp;
+}
+
+// Set `count` to the number of bytes equal to `val` in the decoded data. Returns as rle_query_histogram().
+ssize_t rle_query_count(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint8_t val, uint64_t *count) {
+	uint64_t n = 0;
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			return (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL));
+		}
+		if (op.kind == RLE_ZOO_OP_REP) {
+			n += op.data[0] == val ? op.cnt : 0;
+		} else {
+			for (size_t i = 0 ; i < op.cnt ; ++i) {
+				n += op.data[i] == val;
+			}
+		}
+		wp += op.cnt;
+		rp += (size_t)oplen;
+	}
+	*count = n;
+	return (ssize_t)wp;
+}
+
+// Set `sum` to the sum of all bytes in the decoded data. Returns as rle_query_histogram().
+ssize_t rle_query_sum(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, uint64_t *sum) {
+	uint64_t s = 0;
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			return (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL));
+		}
+		if (op.kind == RLE_ZOO_OP_REP) {
+			s += (uint64_t)op.data[0] * op.cnt;
+		} else {
+			for (size_t i = 0 ; i < op.cnt ; ++i) {
+				s += op.data[i];
+			}
+		}
+		wp += op.cnt;
+		rp += (size_t)oplen;
+	}
+	*sum = s;
+	return (ssize_t)wp;
+}
+
+// Position in a stream for rle_query_equal(): the current OP, and how much of it is consumed.
+struct rle_query_pos {
+	rle_zoo_parse_op_fp parse_op;
+	const uint8_t *src;
+	size_t slen;
+	size_t rp;
+	size_t ofs;
+	struct rle_zoo_op op;
+};
+
+// Make sure `p->op` has output left, skipping empty OPs. Returns 1 if so, 0 at the end, -1 on error.
+static int rle_query_fill(struct rle_query_pos *p) {
+	while (p->ofs == p->op.cnt) {
+		if (p->rp == p->slen) {
+			return 0;
+		}
+		ssize_t oplen = p->parse_op(p->src + p->rp, p->slen - p->rp, &p->op);
+		if (oplen < 0) {
+			return -1;
+		}
+		p->rp += (size_t)oplen;
+		p->ofs = 0;
+	}
+	return 1;
+}
+
+// Compare the decoded data of two streams, which may be of different variants, without decoding
+// either. Returns 1 if equal, 0 if not, or -1 if either stream is truncated before a difference
+// is found.
+int rle_query_equal(rle_zoo_parse_op_fp parse_a, const uint8_t *a, size_t alen, rle_zoo_parse_op_fp parse_b, const uint8_t *b, size_t blen) {
+	struct rle_query_pos pa = { parse_a, a, alen, 0, 0, { RLE_ZOO_OP_NOP, 0, NULL } };
+	struct rle_query_pos pb = { parse_b, b, blen, 0, 0, { RLE_ZOO_OP_NOP, 0, NULL } };
+
+	for (;;) {
+		int ra = rle_query_fill(&pa);
+		int rb = rle_query_fill(&pb);
+		if (ra < 0 || rb < 0) {
+			return -1;
+		}
+		if (ra == 0 || rb == 0) {
+			return ra == rb;
+		}
+
+		size_t n = pa.op.cnt - pa.ofs;
+		if (n > pb.op.cnt - pb.ofs) {
+			n = pb.op.cnt - pb.ofs;
+		}
+		int rep_a = pa.op.kind == RLE_ZOO_OP_REP;
+		int rep_b = pb.op.kind == RLE_ZOO_OP_REP;
+		if (rep_a && rep_b) {
+			if (pa.op.data[0] != pb.op.data[0]) {
+				return 0;
+			}
+		} else if (rep_a || rep_b) {
+			uint8_t val = rep_a ? pa.op.data[0] : pb.op.data[0];
+			const uint8_t *p = rep_a ? pb.op.data + pb.ofs : pa.op.data + pa.ofs;
+			for (size_t i = 0 ; i < n ; ++i) {
+				if (p[i] != val) {
+					return 0;
+				}
+			}
+		} else if (memcmp(pa.op.data + pa.ofs, pb.op.data + pb.ofs, n) != 0) {
+			return 0;
+		}
+		pa.ofs += n;
+		pb.ofs += n;
+	}
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
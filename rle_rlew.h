@@ -0,0 +1,406 @@
+/*
+	Run-Length Encoder/Decoder (RLE), 16-bit Word Variant (RLEW)
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	The RLEW scheme used by id Software for map and level data, where the elements are
+	little-endian 16-bit words rather than bytes. Any word but the tag 0xABCD is copied
+	as-is, and the tag is followed by a count and a value word to repeat:
+
+		0xABCD  count  value
+
+	Runs are found and filled eight words at a time with SSE2 where available.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#else
+#include <sys/types.h> // ssize_t
+#endif
+
+#include "rle_zoo_common.h"
+
+ssize_t rlew_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t rlew_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t rlew_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t rlew_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+
+#if defined(RLE_ZOO_RLEW_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(size_t) == sizeof(ssize_t), "");
+
+// return -(rp + 1) ... mask so it can't flip positive. Give up and just always return -1?
+#define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
+
+// RLE PARAMS: in words, min CPY=1, min REP=4 (one for the tag), max REP=65535
+#define RLEW_TAG 0xABCD
+#define RLEW_MIN_REP 4
+#define RLEW_MAX_REP 0xFFFF
+// Size of an encoded REP; the tag, count and value words.
+#define RLEW_REP_SIZE 6
+
+// The word at `src` as laid out in memory, for comparing words without regard to byte order.
+static inline uint16_t rlew_load(const uint8_t *src) {
+	uint16_t w;
+	memcpy(&w, src, 2);
+	return w;
+}
+
+// The value of the little-endian word at `src`.
+static inline uint16_t rlew_get16(const uint8_t *src) {
+	return (uint16_t)(src[0] | src[1] << 8);
+}
+
+static inline void rlew_put16(uint8_t *dest, uint16_t v) {
+	dest[0] = (uint8_t)v;
+	dest[1] = (uint8_t)(v >> 8);
+}
+
+static inline int rlew_is_tag(const uint8_t *src) {
+	return rlew_get16(src) == RLEW_TAG;
+}
+
+#ifndef __SSE2__
+#define RLEW_ONES 0x0001000100010001ULL
+
+// Non-zero if any of the four words of `v` is zero.
+static inline uint64_t rlew_has_zero(uint64_t v) {
+	return (v - RLEW_ONES) & ~v & (RLEW_ONES << 15);
+}
+
+// Four tag words, as laid out in memory.
+static inline uint64_t rlew_tag_pattern(void) {
+	const uint8_t tag[2] = { RLEW_TAG & 0xFF, RLEW_TAG >> 8 };
+	return rlew_load(tag) * RLEW_ONES;
+}
+#endif
+
+// Returns the number of words, at most `max`, in the run of the word at the start of `src`.
+static size_t rlew_run_length(const uint8_t *src, size_t max) {
+	size_t n = 1;
+#ifdef __SSE2__
+	const __m128i pattern = _mm_set1_epi16((short)rlew_load(src));
+	while (n + 8 <= max) {
+		__m128i v = _mm_loadu_si128((const void*)(src + 2 * n));
+		unsigned int diff = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi16(v, pattern)) ^ 0xFFFF;
+		if (diff) {
+			return n + (size_t)__builtin_ctz(diff) / 2;
+		}
+		n += 8;
+	}
+#else
+	const uint64_t pattern = rlew_load(src) * RLEW_ONES;
+	while (n + 4 <= max) {
+		uint64_t diff;
+		memcpy(&diff, src + 2 * n, 8);
+		diff ^= pattern;
+		if (diff) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			return n + (size_t)__builtin_ctzll(diff) / 16;
+#else
+			return n + (size_t)__builtin_clzll(diff) / 16;
+#endif
+		}
+		n += 4;
+	}
+#endif
+	while (n < max && rlew_load(src + 2 * n) == rlew_load(src)) {
+		++n;
+	}
+	return n;
+}
+
+// Returns the number of words at the start of `src`, out of `nwords`, to be output as-is. Stops at
+// the first run long enough for a REP, or at a tag word, which must always be encoded as one.
+static size_t rlew_scan_literals(const uint8_t *src, size_t nwords) {
+#ifdef __SSE2__
+	const __m128i tag = _mm_set1_epi16((short)RLEW_TAG);
+#else
+	const uint64_t tag = rlew_tag_pattern();
+#endif
+	size_t n = 0;
+	while (n < nwords) {
+		// Skip several words at a time while no two neighbouring words are equal, and none is the tag.
+#ifdef __SSE2__
+		if (n + 9 <= nwords) {
+			__m128i a = _mm_loadu_si128((const void*)(src + 2 * n));
+			__m128i b = _mm_loadu_si128((const void*)(src + 2 * n + 2));
+			if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(a, b), _mm_cmpeq_epi16(a, tag))) == 0) {
+				n += 8;
+				continue;
+			}
+		}
+#else
+		if (n + 5 <= nwords) {
+			uint64_t a, b;
+			memcpy(&a, src + 2 * n, 8);
+			memcpy(&b, src + 2 * n + 2, 8);
+			if (!rlew_has_zero(a ^ b) && !rlew_has_zero(a ^ tag)) {
+				n += 4;
+				continue;
+			}
+		}
+#endif
+		if (rlew_is_tag(src + 2 * n)) {
+			break;
+		}
+		size_t run = rlew_run_length(src + 2 * n, nwords - n < RLEW_MIN_REP ? nwords - n : RLEW_MIN_REP);
+		if (run >= RLEW_MIN_REP) {
+			break;
+		}
+		n += run;
+	}
+	return n;
+}
+
+// Returns the number of words at the start of `src`, out of `nwords`, before the first tag word.
+static size_t rlew_find_tag(const uint8_t *src, size_t nwords) {
+	size_t n = 0;
+#ifdef __SSE2__
+	const __m128i tag = _mm_set1_epi16((short)RLEW_TAG);
+	while (n + 8 <= nwords) {
+		unsigned int found = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const void*)(src + 2 * n)), tag));
+		if (found) {
+			return n + (size_t)__builtin_ctz(found) / 2;
+		}
+		n += 8;
+	}
+#else
+	const uint64_t tag = rlew_tag_pattern();
+	while (n + 4 <= nwords) {
+		uint64_t v;
+		memcpy(&v, src + 2 * n, 8);
+		if (rlew_has_zero(v ^ tag)) {
+			break;
+		}
+		n += 4;
+	}
+#endif
+	while (n < nwords && !rlew_is_tag(src + 2 * n)) {
+		++n;
+	}
+	return n;
+}
+
+// Write `cnt` copies of the word at `val`.
+static void rlew_fill(uint8_t *dest, const uint8_t *val, size_t cnt) {
+	size_t n = 0;
+#ifdef __SSE2__
+	const __m128i pattern = _mm_set1_epi16((short)rlew_load(val));
+	for ( ; n + 8 <= cnt ; n += 8) {
+		_mm_storeu_si128((void*)(dest + 2 * n), pattern);
+	}
+#else
+	const uint64_t pattern = rlew_load(val) * RLEW_ONES;
+	for ( ; n + 4 <= cnt ; n += 4) {
+		memcpy(dest + 2 * n, &pattern, 8);
+	}
+#endif
+	for ( ; n < cnt ; ++n) {
+		memcpy(dest + 2 * n, val, 2);
+	}
+}
+
+// Output through a sink, buffered into chunks of RLE_ZOO_SINK_BUFFER_SIZE bytes.
+struct rlew_sink {
+	rle_zoo_sink_fp sink;
+	void *ctx;
+	size_t len;
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+};
+
+// Append `len` bytes of `data`, or if it's NULL, `len` bytes of copies of the word at `val`.
+// Returns non-zero if the sink aborts.
+static int rlew_sink_put(struct rlew_sink *s, const uint8_t *data, const uint8_t *val, size_t len) {
+	size_t phase = 0;
+	while (len > 0) {
+		size_t n = sizeof(s->buf) - s->len < len ? sizeof(s->buf) - s->len : len;
+		if (data) {
+			memcpy(s->buf + s->len, data, n);
+			data += n;
+		} else {
+			// A fill can straddle a chunk boundary mid-word, so continue from the byte it left off at.
+			const uint8_t word[2] = { val[phase], val[phase ^ 1] };
+			rlew_fill(s->buf + s->len, word, n / 2);
+			if (n & 1) {
+				s->buf[s->len + n - 1] = word[0];
+			}
+			phase ^= n & 1;
+		}
+		s->len += n;
+		len -= n;
+		if (s->len == sizeof(s->buf)) {
+			if (s->sink(s->ctx, s->buf, s->len) != 0) {
+				return 1;
+			}
+			s->len = 0;
+		}
+	}
+	return 0;
+}
+
+static int rlew_sink_flush(struct rlew_sink *s) {
+	int res = s->len > 0 ? s->sink(s->ctx, s->buf, s->len) : 0;
+	s->len = 0;
+	return res;
+}
+
+// Output `len` bytes of `data` to dest[wp], or if `s` is set, to the sink. Returns non-zero if they don't fit.
+static inline int rlew_put(uint8_t *dest, size_t dlen, size_t wp, struct rlew_sink *s, const uint8_t *data, size_t len) {
+	if (s) {
+		return rlew_sink_put(s, data, NULL, len);
+	}
+	if (dest) {
+		if (len > dlen - wp) {
+			return 1;
+		}
+		memcpy(dest + wp, data, len);
+	}
+	return 0;
+}
+
+// Encode into `dest`, or if `s` is set, into the sink.
+static inline ssize_t rlew_encode(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, struct rlew_sink *s) {
+	const size_t end = slen & ~(size_t)1;
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < end) {
+		size_t left = (end - rp) / 2;
+		size_t lit = rlew_scan_literals(src + rp, left);
+		if (lit) {
+			if (rlew_put(dest, dlen, wp, s, src + rp, 2 * lit) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			rp += 2 * lit;
+			wp += 2 * lit;
+			continue;
+		}
+		size_t cnt = rlew_run_length(src + rp, left < RLEW_MAX_REP ? left : RLEW_MAX_REP);
+		uint8_t op[RLEW_REP_SIZE];
+		rlew_put16(op, RLEW_TAG);
+		rlew_put16(op + 2, (uint16_t)cnt);
+		memcpy(op + 4, src + rp, 2);
+		if (rlew_put(dest, dlen, wp, s, op, sizeof(op)) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		rp += 2 * cnt;
+		wp += sizeof(op);
+	}
+	// A trailing odd byte is stored as-is.
+	if (rp < slen) {
+		if (rlew_put(dest, dlen, wp, s, src + rp, 1) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		++rp;
+		++wp;
+	}
+	assert(rp == slen);
+	assert((dest == NULL) || (wp <= dlen));
+	return (ssize_t)wp;
+}
+
+ssize_t rlew_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	return rlew_encode(src, slen, dest, dlen, NULL);
+}
+
+// Decode into `dest`, or if `s` is set, into the sink.
+static inline ssize_t rlew_decode(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, struct rlew_sink *s) {
+	size_t rp = 0;
+	size_t wp = 0;
+	while (slen - rp >= 2) {
+		assert((ssize_t)wp >= 0);
+		size_t len = 2 * rlew_find_tag(src + rp, (slen - rp) / 2);
+		if (len > 0) {
+			if (len > ((size_t)~0 >> 1UL) - wp) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			if (!s && dest && len > dlen - wp) {
+				// Fail at the first word that doesn't fit, as if each was an OP of its own.
+				rp += ((dlen - wp) & ~(size_t)1) + 2;
+				RLE_ZOO_RETURN_ERR;
+			}
+			if (rlew_put(dest, dlen, wp, s, src + rp, len) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			rp += len;
+			wp += len;
+			continue;
+		}
+		rp += 2;
+		if (slen - rp < 4) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		len = 2 * (size_t)rlew_get16(src + rp);
+		if (len > ((size_t)~0 >> 1UL) - wp) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		if (s) {
+			if (rlew_sink_put(s, NULL, src + rp + 2, len) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+		} else if (dest) {
+			if (len > dlen - wp) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			rlew_fill(dest + wp, src + rp + 2, len / 2);
+		}
+		rp += 4;
+		wp += len;
+	}
+	// A trailing odd byte is copied as-is.
+	if (rp < slen) {
+		++rp;
+		if (rlew_put(dest, dlen, wp, s, src + rp - 1, 1) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		++wp;
+	}
+	assert(rp == slen);
+	assert((dest == NULL) || (wp <= dlen));
+	return (ssize_t)wp;
+}
+
+ssize_t rlew_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	return rlew_decode(src, slen, dest, dlen, NULL);
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t rlew_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct rlew_sink s = { sink, ctx, 0, { 0 } };
+	ssize_t res = rlew_encode(src, slen, NULL, 0, &s);
+	if (res >= 0 && rlew_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as rlew_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t rlew_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct rlew_sink s = { sink, ctx, 0, { 0 } };
+	ssize_t res = rlew_decode(src, slen, NULL, 0, &s);
+	if (res >= 0 && rlew_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+#undef RLE_ZOO_RETURN_ERR
+#endif
+
+#ifdef __cplusplus
+}
+#endif
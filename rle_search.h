@@ -0,0 +1,172 @@
+/*
+	Compressed-Domain Pattern Search in Run-Length Encoded (RLE) Data
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Finds all occurrences of a byte pattern in the decoded data of any variant without
+	decoding it. The search is a KMP matcher fed directly from the OPs, so matches may
+	cross OP boundaries. A REP only has to be fed until the matcher state settles, which
+	takes at most the length of the pattern, and the rest of the run is skipped (or, for
+	a pattern that is itself a run of the value, counted) arithmetically.
+
+	Include one or more of the rle_<variant>.h headers first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_search.h"
+#endif
+
+#define RLE_SEARCH_MAX_PATTERN 256
+
+// Called with the decoded offset of each match. Return non-zero to stop the search.
+typedef int (*rle_search_fp)(void *ctx, size_t offset);
+
+ssize_t rle_search(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, const uint8_t *pat, size_t plen, rle_search_fp found, void *ctx);
+
+#if defined(RLE_ZOO_SEARCH_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+struct rle_search_state {
+	const uint8_t *pat;
+	size_t plen;
+	size_t j;		// Length of the pattern prefix matched so far, always less than `plen`.
+	size_t pos;		// Decoded position of the next byte.
+	ssize_t count;
+	rle_search_fp found;
+	void *ctx;
+	size_t fail[RLE_SEARCH_MAX_PATTERN + 1];
+};
+
+// Report a match ending just before `pos`. Returns non-zero to stop.
+static int rle_search_match(struct rle_search_state *s, size_t pos) {
+	++s->count;
+	return s->found ? s->found(s->ctx, pos - s->plen) : 0;
+}
+
+// Feed one decoded byte to the matcher. Returns non-zero to stop.
+static inline int rle_search_feed(struct rle_search_state *s, uint8_t c) {
+	size_t j = s->j;
+	while (j > 0 && s->pat[j] != c) {
+		j = s->fail[j];
+	}
+	if (s->pat[j] == c) {
+		++j;
+	}
+	++s->pos;
+	if (j == s->plen) {
+		s->j = s->fail[j];
+		return rle_search_match(s, s->pos);
+	}
+	s->j = j;
+	return 0;
+}
+
+// Search the decoded data for `pat` of `plen` bytes, calling `found` for each match in order, if not
+// NULL. Matches may overlap. Returns the number of matches, -1 if the pattern is longer than
+// RLE_SEARCH_MAX_PATTERN, or the same error as the variant's decoder on truncated input, in which
+// case any matches before the error have already been reported.
+ssize_t rle_search(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, const uint8_t *pat, size_t plen, rle_search_fp found, void *ctx) {
+	if (plen > RLE_SEARCH_MAX_PATTERN) {
+		return -1;
+	}
+	if (plen == 0) {
+		return 0;
+	}
+
+	struct rle_search_state s;
+	s.pat = pat;
+	s.plen = plen;
+	s.j = 0;
+	s.pos = 0;
+	s.count = 0;
+	s.found = found;
+	s.ctx = ctx;
+
+	// fail[i] is the length of the longest proper border of the first i bytes of the pattern.
+	s.fail[0] = s.fail[1] = 0;
+	for (size_t i = 1, k = 0 ; i < plen ; ++i) {
+		while (k > 0 && pat[i] != pat[k]) {
+			k = s.fail[k];
+		}
+		if (pat[i] == pat[k]) {
+			++k;
+		}
+		s.fail[i + 1] = k;
+	}
+	// Length of the run the pattern starts with.
+	size_t lead = 1;
+	while (lead < plen && pat[lead] == pat[0]) {
+		++lead;
+	}
+
+	size_t rp = 0;
+	while (rp < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + rp, slen - rp, &op);
+		if (oplen < 0) {
+			return (ssize_t)~((rp + 1) & ((size_t)~0 >> 1UL));
+		}
+
+		if (op.kind == RLE_ZOO_OP_REP) {
+			uint8_t v = op.data[0];
+			size_t n = op.cnt < plen ? op.cnt : plen;
+			for (size_t i = 0 ; i < n ; ++i) {
+				if (rle_search_feed(&s, v)) {
+					return s.count;
+				}
+			}
+			size_t left = op.cnt - n;
+			if (left > 0) {
+				if (lead == plen && v == pat[0]) {
+					// The pattern is a run of `v`, so it matches at every remaining position.
+					assert(s.j == plen - 1);
+					if (!s.found) {
+						s.count += (ssize_t)left;
+						s.pos += left;
+					} else {
+						for (size_t i = 0 ; i < left ; ++i) {
+							if (rle_search_match(&s, ++s.pos)) {
+								return s.count;
+							}
+						}
+					}
+				} else {
+					// The matcher has settled on the part of the pattern's leading run that is `v`.
+					assert(s.j == (v == pat[0] ? lead : 0));
+					s.pos += left;
+				}
+			}
+		} else if (op.cnt > 0) {
+			const uint8_t *p = op.data;
+			const uint8_t *end = p + op.cnt;
+			while (p < end) {
+				if (s.j == 0) {
+					// Skip ahead to the next possible start of a match.
+					const uint8_t *q = memchr(p, pat[0], (size_t)(end - p));
+					if (!q) {
+						s.pos += (size_t)(end - p);
+						break;
+					}
+					s.pos += (size_t)(q - p);
+					p = q;
+				}
+				if (rle_search_feed(&s, *p++)) {
+					return s.count;
+				}
+			}
+		}
+		rp += (size_t)oplen;
+	}
+
+	return s.count;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,139 @@
+/*
+	Run-Length Decoding (RLE) into Span Lists
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Decodes any variant into a compact list of spans, where CPY and LIT spans point
+	into the compressed source instead of being copied, and REPs are kept as value and
+	count. Intended for consumers that only scan the output once, e.g via writev(2).
+
+	Include one or more of the rle_<variant>.h headers first.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#error "Include one of the rle_<variant>.h headers before rle_span.h"
+#endif
+
+#if !defined(_MSC_VER)
+#include <sys/uio.h> // struct iovec
+#endif
+
+struct rle_span {
+	const uint8_t *src;	// CPY/LIT: payload in the compressed source. NULL for a REP.
+	size_t len;			// Number of output bytes.
+	uint8_t val;		// REP: the value to repeat.
+};
+
+ssize_t rle_span_decode(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, size_t *rp, struct rle_span *spans, size_t nspans);
+#if !defined(_MSC_VER)
+size_t rle_span_iovec(const struct rle_span *spans, size_t nspans, size_t *idx, size_t *ofs, struct iovec *iov, size_t niov, uint8_t *scratch, size_t scratch_len);
+#endif
+
+#if defined(RLE_ZOO_SPAN_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+// Decode `src` into at most `nspans` spans, starting at input position `rp`, which is updated so
+// that the decode can be resumed. Adjacent spans are merged where possible, e.g consecutive REPs
+// of the same value and LITs next to each other. The input is fully decoded when `rp` equals `slen`.
+// Returns the number of spans written, or the same error as the variant's decoder on truncated input.
+ssize_t rle_span_decode(rle_zoo_parse_op_fp parse_op, const uint8_t *src, size_t slen, size_t *rp, struct rle_span *spans, size_t nspans) {
+	size_t n = 0;
+	size_t pos = *rp;
+	while (pos < slen) {
+		struct rle_zoo_op op;
+		ssize_t oplen = parse_op(src + pos, slen - pos, &op);
+		if (oplen < 0) {
+			*rp = pos;
+			return (ssize_t)~((pos + 1) & ((size_t)~0 >> 1UL));
+		}
+
+		if (op.cnt > 0) {
+			struct rle_span *prev = n > 0 ? &spans[n - 1] : NULL;
+			if (op.kind == RLE_ZOO_OP_REP) {
+				if (prev && prev->src == NULL && prev->val == op.data[0]) {
+					prev->len += op.cnt;
+				} else if (n < nspans) {
+					spans[n].src = NULL;
+					spans[n].len = op.cnt;
+					spans[n++].val = op.data[0];
+				} else {
+					break;
+				}
+			} else {
+				assert(op.kind == RLE_ZOO_OP_CPY || op.kind == RLE_ZOO_OP_LIT);
+				if (prev && prev->src && prev->src + prev->len == op.data) {
+					prev->len += op.cnt;
+				} else if (n < nspans) {
+					spans[n].src = op.data;
+					spans[n].len = op.cnt;
+					spans[n++].val = 0;
+				} else {
+					break;
+				}
+			}
+		}
+		pos += (size_t)oplen;
+	}
+	*rp = pos;
+	return (ssize_t)n;
+}
+
+#if !defined(_MSC_VER)
+// Convert spans into an iovec array for writev(2), sendmsg(2) and friends, starting at span `idx`
+// and byte offset `ofs` into it, both of which are updated so the conversion can be resumed.
+// CPY spans reference the compressed source directly. REP spans are expanded into `scratch`, and
+// long REPs reuse the same expansion for as many iovecs as needed. Stops when `iov` or `scratch`
+// is full. Returns the number of iovecs written.
+size_t rle_span_iovec(const struct rle_span *spans, size_t nspans, size_t *idx, size_t *ofs, struct iovec *iov, size_t niov, uint8_t *scratch, size_t scratch_len) {
+	size_t n = 0;
+	size_t sp = 0;
+	size_t i = *idx;
+	size_t o = *ofs;
+
+	while (i < nspans && n < niov) {
+		const struct rle_span *s = &spans[i];
+		assert(o < s->len);
+		if (s->src) {
+			iov[n].iov_base = (void*)(uintptr_t)(s->src + o);
+			iov[n].iov_len = s->len - o;
+			++n;
+		} else {
+			size_t fill = s->len - o;
+			if (fill > scratch_len - sp) {
+				fill = scratch_len - sp;
+			}
+			if (fill == 0) {
+				break; // Scratch full.
+			}
+			memset(scratch + sp, s->val, fill);
+			while (o < s->len && n < niov) {
+				size_t len = s->len - o < fill ? s->len - o : fill;
+				iov[n].iov_base = scratch + sp;
+				iov[n].iov_len = len;
+				o += len;
+				++n;
+			}
+			sp += fill;
+			if (o < s->len) {
+				break; // Out of iovecs.
+			}
+		}
+		++i;
+		o = 0;
+	}
+
+	*idx = i;
+	*ofs = o;
+	return n;
+}
+#endif
+#endif
+
+#ifdef __cplusplus
+}
+#endif
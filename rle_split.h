@@ -0,0 +1,400 @@
+/*
+	Run-Length Encoder/Decoder (RLE), Split Stream Variant
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	A variant of our own, laid out for decoding speed rather than compatibility. Rather than
+	interleaving OPs with their payload, the output is a sequence of chunks, each a control
+	stream of OPs followed by a literal stream holding the payload of all its CPYs:
+
+		varint  size of the control stream, C
+		varint  size of the literal stream, L
+		C       OPs
+		L       literals
+
+	An OP is a byte, where the high bit selects a REP, followed by the value to repeat, over a
+	CPY, whose bytes are taken in order from the literal stream. The low seven bits hold the
+	count, less SPLIT_MIN_REP for a REP and less one for a CPY. If they're all set, a varint with
+	the rest of the count follows, so a single OP covers a run of any length. Varints are LEB128.
+
+	The decoder walks the OPs back to back, copying literals with memcpy and filling runs with
+	memset, using fixed-size copies that compile to a few vector stores where the output has room.
+	It may write up to SPLIT_WILD bytes past the end of an OP, but only where the rest of the chunk
+	is certain to overwrite them, so never past the end of the output.
+
+	As an OP doesn't carry its payload, there's no stateless <variant>_parse_op(), and no resumable
+	stream coders, so this variant can't be used with the libraries built on those.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#else
+#include <sys/types.h> // ssize_t
+#endif
+
+#include "rle_zoo_common.h"
+
+ssize_t split_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t split_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+ssize_t split_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+ssize_t split_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx);
+
+#if defined(RLE_ZOO_SPLIT_IMPLEMENTATION) || defined(RLE_ZOO_IMPLEMENTATION)
+#include <assert.h>
+#include <string.h>
+
+static_assert(sizeof(size_t) == sizeof(ssize_t), "");
+
+// return -(rp + 1) ... mask so it can't flip positive. Give up and just always return -1?
+#define RLE_ZOO_RETURN_ERR return ~(rp & ((size_t)~0 >> 1UL))
+
+// RLE PARAMS: min CPY=1, min REP=4, no max
+#define SPLIT_MIN_REP 4
+// Size of the control stream at which the encoder starts a new chunk.
+#define SPLIT_MAX_CONTROL 4096
+// Largest encoded OP: the OP byte, a varint of up to ten bytes, and a REP value.
+#define SPLIT_MAX_OP_SIZE 12
+// Size of the fixed-size copies and fills the decoder uses for short OPs.
+#define SPLIT_WILD 32
+
+static size_t split_put_varint(uint8_t *dest, size_t v) {
+	size_t n = 0;
+	while (v >= 0x80) {
+		dest[n++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	dest[n++] = (uint8_t)v;
+	return n;
+}
+
+// Read the varint at src[*rp], not reading at or past `end`. Returns zero, or -1 if it's truncated or too long.
+static inline int split_get_varint(const uint8_t *src, size_t end, size_t *rp, size_t *val) {
+	size_t v = 0;
+	for (unsigned int shift = 0 ; shift < 64 ; shift += 7) {
+		if (*rp >= end) {
+			return -1;
+		}
+		uint8_t b = src[(*rp)++];
+		v |= (size_t)(b & 0x7F) << shift;
+		if (!(b & 0x80)) {
+			*val = v;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static size_t split_put_op(uint8_t *dest, size_t cnt, int rep, uint8_t val) {
+	size_t n = cnt - (rep ? SPLIT_MIN_REP : 1);
+	size_t len = 1;
+	if (n < 0x7F) {
+		dest[0] = (uint8_t)((rep ? 0x80 : 0x00) | n);
+	} else {
+		dest[0] = (uint8_t)((rep ? 0x80 : 0x00) | 0x7F);
+		len += split_put_varint(dest + 1, n - 0x7F);
+	}
+	if (rep) {
+		dest[len++] = val;
+	}
+	return len;
+}
+
+// Parse the OP at src[*rp], in a control stream ending at `end`, where *rp < end. Sets `cnt`, and `val`
+// for a REP. Returns 1 for a REP, 0 for a CPY, or -1 if the OP is truncated.
+static inline int split_get_op(const uint8_t *src, size_t end, size_t *rp, size_t *cnt, uint8_t *val) {
+	uint8_t b = src[(*rp)++];
+	size_t n = b & 0x7F;
+	if (n == 0x7F) {
+		size_t ext;
+		if (split_get_varint(src, end, rp, &ext) != 0 || ext > ((size_t)~0 >> 2)) {
+			return -1;
+		}
+		n += ext;
+	}
+	if (b & 0x80) {
+		if (*rp >= end) {
+			return -1;
+		}
+		*val = src[(*rp)++];
+		*cnt = n + SPLIT_MIN_REP;
+		return 1;
+	}
+	*cnt = n + 1;
+	return 0;
+}
+
+// Returns the length of the run at the start of `src`, comparing a word at a time.
+static size_t split_run_length(const uint8_t *src, size_t slen) {
+	const uint64_t pattern = src[0] * 0x0101010101010101ULL;
+	size_t n = 1;
+	while (n + 8 <= slen) {
+		uint64_t diff;
+		memcpy(&diff, src + n, 8);
+		diff ^= pattern;
+		if (diff) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			return n + (size_t)__builtin_ctzll(diff) / 8;
+#else
+			return n + (size_t)__builtin_clzll(diff) / 8;
+#endif
+		}
+		n += 8;
+	}
+	while (n < slen && src[n] == src[0]) {
+		++n;
+	}
+	return n;
+}
+
+// Scan the input for the OPs of the next chunk, written to `ctrl`, which must have room for
+// SPLIT_MAX_CONTROL + 3 * SPLIT_MAX_OP_SIZE bytes. Sets `clen` and `llen` to the sizes of the
+// control and literal streams, and returns the number of input bytes covered.
+static size_t split_scan_chunk(const uint8_t *src, size_t slen, uint8_t *ctrl, size_t *clen, size_t *llen) {
+	const uint64_t ones = 0x0101010101010101ULL;
+	size_t rp = 0;
+	size_t cp = 0;
+	size_t lit = 0;
+	size_t lits = 0;
+	while (rp < slen && cp < SPLIT_MAX_CONTROL) {
+		// Skip eight literals at a time while no two neighbouring bytes are equal.
+		if (rp + 9 <= slen) {
+			uint64_t a, b;
+			memcpy(&a, src + rp, 8);
+			memcpy(&b, src + rp + 1, 8);
+			uint64_t d = a ^ b;
+			if (((d - ones) & ~d & (ones << 7)) == 0) {
+				lit += 8;
+				rp += 8;
+				continue;
+			}
+		}
+		size_t run = split_run_length(src + rp, slen - rp);
+		if (run >= SPLIT_MIN_REP) {
+			if (lit) {
+				cp += split_put_op(ctrl + cp, lit, 0, 0);
+				lits += lit;
+				lit = 0;
+			}
+			cp += split_put_op(ctrl + cp, run, 1, src[rp]);
+		} else {
+			lit += run;
+		}
+		rp += run;
+	}
+	if (lit) {
+		cp += split_put_op(ctrl + cp, lit, 0, 0);
+		lits += lit;
+	}
+	*clen = cp;
+	*llen = lits;
+	return rp;
+}
+
+// Returns the size of the chunk header for the given stream sizes, written to `dest`.
+static size_t split_put_header(uint8_t *dest, size_t clen, size_t llen) {
+	size_t n = split_put_varint(dest, clen);
+	return n + split_put_varint(dest + n, llen);
+}
+
+ssize_t split_compress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	uint8_t ctrl[SPLIT_MAX_CONTROL + 3 * SPLIT_MAX_OP_SIZE];
+	size_t rp = 0;
+	size_t wp = 0;
+
+	while (rp < slen) {
+		size_t clen, llen;
+		size_t n = split_scan_chunk(src + rp, slen - rp, ctrl, &clen, &llen);
+		uint8_t hdr[20];
+		size_t hlen = split_put_header(hdr, clen, llen);
+		size_t len = hlen + clen + llen;
+
+		if (dest) {
+			if (len > dlen - wp) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			memcpy(dest + wp, hdr, hlen);
+			memcpy(dest + wp + hlen, ctrl, clen);
+			// Gather the literals, walking the OPs again.
+			uint8_t *lit = dest + wp + hlen + clen;
+			const uint8_t *in = src + rp;
+			size_t cp = 0;
+			while (cp < clen) {
+				size_t cnt = 0;
+				uint8_t val = 0;
+				if (split_get_op(ctrl, clen, &cp, &cnt, &val) == 0) {
+					memcpy(lit, in, cnt);
+					lit += cnt;
+				}
+				in += cnt;
+			}
+			assert(in == src + rp + n);
+		}
+		rp += n;
+		wp += len;
+	}
+	assert(rp == slen);
+	assert((dest == NULL) || (wp <= dlen));
+	return (ssize_t)wp;
+}
+
+// Output through a sink, buffered into chunks of RLE_ZOO_SINK_BUFFER_SIZE bytes.
+struct split_sink {
+	rle_zoo_sink_fp sink;
+	void *ctx;
+	size_t len;
+	uint8_t buf[RLE_ZOO_SINK_BUFFER_SIZE];
+};
+
+// Append `len` bytes of `data`, or if it's NULL, `len` copies of `val`. Returns non-zero if the sink aborts.
+static int split_sink_put(struct split_sink *s, const uint8_t *data, uint8_t val, size_t len) {
+	while (len > 0) {
+		size_t n = sizeof(s->buf) - s->len < len ? sizeof(s->buf) - s->len : len;
+		if (data) {
+			memcpy(s->buf + s->len, data, n);
+			data += n;
+		} else {
+			memset(s->buf + s->len, val, n);
+		}
+		s->len += n;
+		len -= n;
+		if (s->len == sizeof(s->buf)) {
+			if (s->sink(s->ctx, s->buf, s->len) != 0) {
+				return 1;
+			}
+			s->len = 0;
+		}
+	}
+	return 0;
+}
+
+static int split_sink_flush(struct split_sink *s) {
+	int res = s->len > 0 ? s->sink(s->ctx, s->buf, s->len) : 0;
+	s->len = 0;
+	return res;
+}
+
+// Decode into `dest`, or if `s` is set, into the sink.
+static inline ssize_t split_decode(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen, struct split_sink *s) {
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < slen) {
+		size_t clen, llen;
+		if (split_get_varint(src, slen, &rp, &clen) != 0 || split_get_varint(src, slen, &rp, &llen) != 0 ||
+			clen > slen - rp || llen > slen - rp - clen) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		const size_t end = rp + clen;
+		const uint8_t *lit = src + end;
+		size_t lp = 0;
+		while (rp < end) {
+			assert((ssize_t)wp >= 0);
+			size_t cnt = 0;
+			uint8_t val = 0;
+			int rep = split_get_op(src, end, &rp, &cnt, &val);
+			if (rep < 0 || cnt > ((size_t)~0 >> 1UL) - wp || (!rep && cnt > llen - lp)) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			if (s) {
+				if (split_sink_put(s, rep ? NULL : lit + lp, val, cnt) != 0) {
+					RLE_ZOO_RETURN_ERR;
+				}
+			} else if (dest) {
+				if (cnt > dlen - wp) {
+					RLE_ZOO_RETURN_ERR;
+				}
+				// Short OPs are written with a fixed size where there's room, and the rest of the chunk is
+				// certain to overwrite what's past the OP. Every control byte left, and every literal, is
+				// at least one more byte of output.
+				int wild = cnt <= SPLIT_WILD && dlen - wp >= SPLIT_WILD && (end - rp >= SPLIT_WILD || llen - lp >= SPLIT_WILD);
+				if (rep) {
+					if (wild) {
+						memset(dest + wp, val, SPLIT_WILD);
+					} else {
+						memset(dest + wp, val, cnt);
+					}
+				} else {
+					if (wild && slen - end - lp >= SPLIT_WILD) {
+						memcpy(dest + wp, lit + lp, SPLIT_WILD);
+					} else {
+						memcpy(dest + wp, lit + lp, cnt);
+					}
+				}
+			}
+			if (!rep) {
+				lp += cnt;
+			}
+			wp += cnt;
+		}
+		if (lp != llen) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		rp = end + llen;
+	}
+	assert(rp == slen);
+	assert((dest == NULL) || (wp <= dlen));
+	return (ssize_t)wp;
+}
+
+ssize_t split_decompress(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	return split_decode(src, slen, dest, dlen, NULL);
+}
+
+// Compress all of `src` into `sink`, in a single pass. Returns the number of bytes output.
+// If the sink aborts, returns ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t split_compress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	uint8_t ctrl[SPLIT_MAX_CONTROL + 3 * SPLIT_MAX_OP_SIZE];
+	struct split_sink s = { sink, ctx, 0, { 0 } };
+	size_t rp = 0;
+	size_t wp = 0;
+
+	while (rp < slen) {
+		size_t clen, llen;
+		size_t n = split_scan_chunk(src + rp, slen - rp, ctrl, &clen, &llen);
+		uint8_t hdr[20];
+		size_t hlen = split_put_header(hdr, clen, llen);
+		if (split_sink_put(&s, hdr, 0, hlen) != 0 || split_sink_put(&s, ctrl, 0, clen) != 0) {
+			RLE_ZOO_RETURN_ERR;
+		}
+		const uint8_t *in = src + rp;
+		size_t cp = 0;
+		while (cp < clen) {
+			size_t cnt = 0;
+			uint8_t val = 0;
+			if (split_get_op(ctrl, clen, &cp, &cnt, &val) == 0 && split_sink_put(&s, in, 0, cnt) != 0) {
+				RLE_ZOO_RETURN_ERR;
+			}
+			in += cnt;
+		}
+		rp += n;
+		wp += hlen + clen + llen;
+	}
+	if (split_sink_flush(&s) != 0) {
+		RLE_ZOO_RETURN_ERR;
+	}
+	return (ssize_t)wp;
+}
+
+// Decompress all of `src` into `sink`, in a single pass. Returns the number of bytes output,
+// or the same error as split_decompress() on invalid input. If the sink aborts, returns
+// ~(number of input bytes consumed) like when `dest` is too small.
+ssize_t split_decompress_to_sink(const uint8_t *src, size_t slen, rle_zoo_sink_fp sink, void *ctx) {
+	struct split_sink s = { sink, ctx, 0, { 0 } };
+	ssize_t res = split_decode(src, slen, NULL, 0, &s);
+	if (res >= 0 && split_sink_flush(&s) != 0) {
+		return ~(ssize_t)(slen & ((size_t)~0 >> 1UL));
+	}
+	return res;
+}
+#undef RLE_ZOO_RETURN_ERR
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,421 @@
+/*
+	Run-Length Encoding & Decoding (RLE) for C++20
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Header-only C++ counterpart of the rle_<variant>.h headers, exposing each variant as
+	a type, e.g rle_zoo::packbits, with std::span input and output into fixed spans,
+	output iterators or a returned std::vector.
+
+	The kernels are templates over the variant and over whether output is written or
+	just sized, so there is no function pointer or `if (dest)` left at run-time, and the
+	compiler is free to inline everything. Output and return values, including errors,
+	are identical to the C functions.
+
+	The kernels are also constexpr, and compress<"...">() compresses at compile-time, for
+	embedding compressed assets without a separate build step.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifndef RLE_ZOO_HPP
+#define RLE_ZOO_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <sys/types.h> // ssize_t
+
+namespace rle_zoo {
+
+enum class op_kind { cpy, rep, lit, nop };
+
+// A decoded OP header: its kind, and the number of output bytes it produces.
+struct op_code {
+	op_kind kind;
+	size_t cnt;
+};
+
+// Variant traits. Each provides:
+//   next_op(src, slen, rep) -- determine the next OP to encode, as <variant>_next_op() in C.
+//   op_size(cnt, rep)       -- the encoded size of an OP.
+//   put_op(src, cnt, rep, out) -- write an OP.
+//   decode(b)               -- decode the OP byte `b`.
+//   compress_bound(n)       -- upper bound of the compressed size of `n` input bytes.
+//   rep_err_ofs             -- offset from the OP at which an output overflow in a REP is reported.
+
+struct goldbox_traits {
+	static constexpr const char *name = "goldbox";
+	static constexpr size_t rep_err_ofs = 1;
+
+	static constexpr size_t next_op(const uint8_t *src, size_t slen, bool &rep) noexcept {
+		size_t cnt = 0;
+		while ((cnt+1 < slen) && (src[cnt] == src[cnt+1]) && (cnt < 126)) {
+			++cnt;
+		}
+		rep = cnt > 0 || (cnt+1 == slen);
+		if (rep) {
+			return cnt + 1;
+		}
+		cnt = 0;
+		while ((cnt+1 < slen) && (src[cnt] != src[cnt+1]) && (cnt < 126)) {
+			++cnt;
+		}
+		return cnt;
+	}
+
+	static constexpr size_t op_size(size_t cnt, bool rep) noexcept {
+		return rep ? 2 : cnt + 1;
+	}
+
+	template<typename Out>
+	static constexpr Out put_op(const uint8_t *src, size_t cnt, bool rep, Out out) {
+		if (rep) {
+			*out++ = (uint8_t)~(cnt - 1);
+			*out++ = src[0];
+			return out;
+		}
+		*out++ = (uint8_t)(cnt - 1);
+		return std::copy_n(src, cnt, out);
+	}
+
+	static constexpr op_code decode(uint8_t b) noexcept {
+		if (b & 0x80) {
+			return { op_kind::rep, (uint8_t)(~b + 1) };
+		}
+		return { op_kind::cpy, (size_t)b + 1 };
+	}
+
+	// A one byte CPY followed by a two byte REP is the worst case, at 4/3.
+	static constexpr size_t compress_bound(size_t n) noexcept {
+		return n + (n + 2) / 3 + 1;
+	}
+};
+
+struct packbits_traits {
+	static constexpr const char *name = "packbits";
+	static constexpr size_t rep_err_ofs = 1;
+
+	static constexpr size_t next_op(const uint8_t *src, size_t slen, bool &rep) noexcept {
+		size_t cnt = 0;
+		do { ++cnt; } while ((cnt < slen) && (cnt < 128) && (src[cnt-1] == src[cnt]));
+		rep = cnt > 1;
+		if (rep) {
+			return cnt;
+		}
+		cnt = 0;
+		while ((cnt+1 <= slen) && (cnt < 128) && ((cnt+1 == slen) || (src[cnt] != src[cnt+1]))) {
+			++cnt;
+		}
+		return cnt;
+	}
+
+	static constexpr size_t op_size(size_t cnt, bool rep) noexcept {
+		return rep ? 2 : cnt + 1;
+	}
+
+	template<typename Out>
+	static constexpr Out put_op(const uint8_t *src, size_t cnt, bool rep, Out out) {
+		if (rep) {
+			*out++ = (uint8_t)(257 - cnt);
+			*out++ = src[0];
+			return out;
+		}
+		*out++ = (uint8_t)(cnt - 1);
+		return std::copy_n(src, cnt, out);
+	}
+
+	static constexpr op_code decode(uint8_t b) noexcept {
+		if (b > 0x80) {
+			return { op_kind::rep, (size_t)(257 - b) };
+		} else if (b < 0x80) {
+			return { op_kind::cpy, (size_t)b + 1 };
+		}
+		return { op_kind::nop, 0 }; // Reserved. Just skip byte as suggested by TN1023.
+	}
+
+	// A one byte CPY followed by a two byte REP is the worst case, at 4/3.
+	static constexpr size_t compress_bound(size_t n) noexcept {
+		return n + (n + 2) / 3 + 1;
+	}
+};
+
+struct pcx_traits {
+	static constexpr const char *name = "pcx";
+	static constexpr size_t rep_err_ofs = 2;
+
+	static constexpr size_t next_op(const uint8_t *src, size_t slen, bool &rep) noexcept {
+		size_t cnt = 0;
+		do { ++cnt; } while ((cnt < slen) && (cnt < 63) && (src[cnt - 1] == src[cnt]));
+		rep = cnt > 1 || ((src[0] & 0xC0) == 0xC0);
+		return cnt;
+	}
+
+	static constexpr size_t op_size(size_t cnt, bool rep) noexcept {
+		(void)cnt;
+		return rep ? 2 : 1;
+	}
+
+	template<typename Out>
+	static constexpr Out put_op(const uint8_t *src, size_t cnt, bool rep, Out out) {
+		if (rep) {
+			*out++ = (uint8_t)(0xC0 | cnt);
+		}
+		*out++ = src[0];
+		return out;
+	}
+
+	static constexpr op_code decode(uint8_t b) noexcept {
+		if ((b & 0xC0) == 0xC0) {
+			return { op_kind::rep, (size_t)(b & 0x3F) };
+		}
+		return { op_kind::lit, 1 };
+	}
+
+	static constexpr size_t compress_bound(size_t n) noexcept {
+		return 2 * n;
+	}
+};
+
+struct icns_traits {
+	static constexpr const char *name = "icns";
+	static constexpr size_t rep_err_ofs = 1;
+
+	static constexpr size_t next_op(const uint8_t *src, size_t slen, bool &rep) noexcept {
+		size_t cnt = 0;
+		do { ++cnt; } while ((cnt < slen) && (cnt < 130) && (src[cnt - 1] == src[cnt]));
+		rep = cnt >= 3;
+		if (rep) {
+			return cnt;
+		}
+		cnt = 0;
+		int repcnt = 0;
+		do { ++cnt; } while ((cnt < slen) && (cnt < 128) && (
+			((src[cnt - 1] != src[cnt]) && !(repcnt = 0)) ||
+			(++repcnt < 2)
+		));
+		if (repcnt == 2) {
+			cnt -= 2;
+		}
+		return cnt;
+	}
+
+	static constexpr size_t op_size(size_t cnt, bool rep) noexcept {
+		return rep ? 2 : cnt + 1;
+	}
+
+	template<typename Out>
+	static constexpr Out put_op(const uint8_t *src, size_t cnt, bool rep, Out out) {
+		if (rep) {
+			*out++ = (uint8_t)(cnt + 125);
+			*out++ = src[0];
+			return out;
+		}
+		*out++ = (uint8_t)(cnt - 1);
+		return std::copy_n(src, cnt, out);
+	}
+
+	static constexpr op_code decode(uint8_t b) noexcept {
+		if (b & 0x80) {
+			return { op_kind::rep, (size_t)(b & 0x7F) + 3 };
+		}
+		return { op_kind::cpy, (size_t)b + 1 };
+	}
+
+	static constexpr size_t compress_bound(size_t n) noexcept {
+		return n + (n + 127) / 128 + 1;
+	}
+};
+
+// Same value as RLE_ZOO_RETURN_ERR in the C headers.
+constexpr ssize_t error_at(size_t rp) noexcept {
+	return (ssize_t)~(rp & ((size_t)~0 >> 1UL));
+}
+
+// Compress `src` into `out`, which has room for `dlen` bytes. If `Write` is false, nothing is
+// written and only the size is computed. Returns as <variant>_compress().
+template<typename V, bool Write, typename Out>
+constexpr ssize_t compress_kernel(const uint8_t *src, size_t slen, Out out, size_t dlen) {
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < slen) {
+		bool rep = false;
+		size_t cnt = V::next_op(src + rp, slen - rp, rep);
+		size_t oplen = V::op_size(cnt, rep);
+		if constexpr (Write) {
+			if (wp + oplen > dlen) {
+				return error_at(rp);
+			}
+			out = V::put_op(src + rp, cnt, rep, out);
+		}
+		rp += cnt;
+		wp += oplen;
+	}
+	return (ssize_t)wp;
+}
+
+// Decompress `src` into `out`, as for compress_kernel(). Returns as <variant>_decompress().
+template<typename V, bool Write, typename Out>
+constexpr ssize_t decompress_kernel(const uint8_t *src, size_t slen, Out out, size_t dlen) {
+	size_t wp = 0;
+	size_t rp = 0;
+	while (rp < slen) {
+		uint8_t b = src[rp++];
+		op_code op = V::decode(b);
+		switch (op.kind) {
+			case op_kind::rep:
+				if (!(rp < slen)) {
+					return error_at(rp);
+				}
+				if constexpr (Write) {
+					if (wp + op.cnt > dlen) {
+						return error_at(rp - 1 + V::rep_err_ofs);
+					}
+					out = std::fill_n(out, op.cnt, src[rp]);
+				}
+				++rp;
+				break;
+			case op_kind::cpy:
+				if (!(rp + op.cnt <= slen)) {
+					return error_at(rp);
+				}
+				if constexpr (Write) {
+					if (wp + op.cnt > dlen) {
+						return error_at(rp);
+					}
+					out = std::copy_n(src + rp, op.cnt, out);
+				}
+				rp += op.cnt;
+				break;
+			case op_kind::lit:
+				if constexpr (Write) {
+					if (wp + 1 > dlen) {
+						return error_at(rp);
+					}
+					*out++ = b;
+				}
+				break;
+			case op_kind::nop:
+				break;
+		}
+		wp += op.cnt;
+	}
+	return (ssize_t)wp;
+}
+
+// Bytes usable as a template argument, for compile-time compression. Constructible from a
+// string literal, without the terminating NUL, or from a std::array, such as compressed output.
+template<size_t N>
+struct fixed_bytes {
+	std::array<uint8_t, N> data{};
+
+	consteval fixed_bytes(const char (&s)[N + 1]) {
+		for (size_t i = 0 ; i < N ; ++i) {
+			data[i] = (uint8_t)s[i];
+		}
+	}
+	consteval fixed_bytes(const std::array<uint8_t, N> &a) : data(a) {}
+
+	constexpr std::span<const uint8_t> view() const noexcept { return data; }
+};
+
+template<size_t N>
+fixed_bytes(const char (&)[N]) -> fixed_bytes<N - 1>;
+template<size_t N>
+fixed_bytes(const std::array<uint8_t, N> &) -> fixed_bytes<N>;
+
+// Thrown by the std::vector returning functions on malformed input.
+class error : public std::runtime_error {
+public:
+	explicit error(ssize_t res) : std::runtime_error("rle_zoo: malformed input"), result(res) {}
+	ssize_t result;	// The error as returned by the C functions, i.e ~(input offset).
+};
+
+template<typename V>
+struct codec {
+	using traits = V;
+	static constexpr const char *name = V::name;
+
+	static constexpr size_t compress_bound(size_t n) noexcept {
+		return V::compress_bound(n);
+	}
+
+	// Sizing. These never write anything.
+	static constexpr size_t compressed_size(std::span<const uint8_t> src) noexcept {
+		return (size_t)compress_kernel<V, false>(src.data(), src.size(), (uint8_t*)nullptr, 0);
+	}
+
+	static constexpr ssize_t decompressed_size(std::span<const uint8_t> src) noexcept {
+		return decompress_kernel<V, false>(src.data(), src.size(), (uint8_t*)nullptr, 0);
+	}
+
+	// Into a fixed span. Returns the number of bytes written, or an error as the C functions.
+	static constexpr ssize_t compress(std::span<const uint8_t> src, std::span<uint8_t> dest) noexcept {
+		return compress_kernel<V, true>(src.data(), src.size(), dest.data(), dest.size());
+	}
+
+	static constexpr ssize_t decompress(std::span<const uint8_t> src, std::span<uint8_t> dest) noexcept {
+		return decompress_kernel<V, true>(src.data(), src.size(), dest.data(), dest.size());
+	}
+
+	// Into an unbounded output iterator, e.g std::back_inserter(). Returns as above.
+	template<std::output_iterator<uint8_t> Out>
+	static constexpr ssize_t compress(std::span<const uint8_t> src, Out out) {
+		return compress_kernel<V, true>(src.data(), src.size(), out, SIZE_MAX);
+	}
+
+	template<std::output_iterator<uint8_t> Out>
+	static constexpr ssize_t decompress(std::span<const uint8_t> src, Out out) {
+		return decompress_kernel<V, true>(src.data(), src.size(), out, SIZE_MAX);
+	}
+
+	// Into a new vector, allocated once from the compress bound.
+	static std::vector<uint8_t> compress(std::span<const uint8_t> src) {
+		std::vector<uint8_t> res(compress_bound(src.size()));
+		res.resize((size_t)compress(src, std::span<uint8_t>(res)));
+		return res;
+	}
+
+	// Into a new vector, allocated once after a sizing pass. Throws rle_zoo::error on malformed input.
+	static std::vector<uint8_t> decompress(std::span<const uint8_t> src) {
+		ssize_t len = decompressed_size(src);
+		if (len < 0) {
+			throw error(len);
+		}
+		std::vector<uint8_t> res((size_t)len);
+		decompress(src, std::span<uint8_t>(res));
+		return res;
+	}
+
+	// Compress at compile-time into an exactly sized std::array, e.g
+	//   constexpr auto blob = rle_zoo::packbits::compress<"AAAAAAAABCDEF">();
+	template<fixed_bytes S>
+	static consteval auto compress() {
+		constexpr size_t len = compressed_size(S.view());
+		std::array<uint8_t, len> res{};
+		compress_kernel<V, true>(S.data.data(), S.data.size(), res.data(), res.size());
+		return res;
+	}
+
+	// Decompress at compile-time, e.g from the output of compress<>() above.
+	template<fixed_bytes S>
+	static consteval auto decompress() {
+		constexpr ssize_t len = decompressed_size(S.view());
+		static_assert(len >= 0, "rle_zoo: malformed input");
+		std::array<uint8_t, (size_t)len> res{};
+		decompress_kernel<V, true>(S.data.data(), S.data.size(), res.data(), res.size());
+		return res;
+	}
+};
+
+using goldbox = codec<goldbox_traits>;
+using packbits = codec<packbits_traits>;
+using pcx = codec<pcx_traits>;
+using icns = codec<icns_traits>;
+
+} // namespace rle_zoo
+
+#endif
@@ -0,0 +1,123 @@
+/*
+	Run-Length Encoder/Decoder (RLE), Common Definitions
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Types shared by all the rle_<variant>.h headers, which include this one.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <BaseTsd.h>
+typedef SSIZE_T ssize_t;
+#else
+#include <sys/types.h> // ssize_t
+#endif
+
+#ifndef RLE_ZOO_COMMON
+#define RLE_ZOO_COMMON
+// State shared by the resumable streaming decoders of all variants.
+// Initialize with rle_zoo_dstream_init() before the first call.
+struct rle_zoo_dstream {
+	size_t total_in;	// Total number of input bytes consumed.
+	size_t total_out;	// Total number of output bytes produced.
+	size_t op_pos;		// Input position following the current OP byte, for error reporting.
+	size_t cnt;			// Number of bytes left to output for the current OP.
+	uint8_t state;
+	uint8_t val;		// REP value.
+};
+
+enum rle_zoo_dstream_state {
+	RLE_ZOO_DSTREAM_OP,
+	RLE_ZOO_DSTREAM_REP_VAL,
+	RLE_ZOO_DSTREAM_REP,
+	RLE_ZOO_DSTREAM_CPY,
+};
+
+static inline void rle_zoo_dstream_init(struct rle_zoo_dstream *ds) {
+	ds->total_in = 0;
+	ds->total_out = 0;
+	ds->op_pos = 0;
+	ds->cnt = 0;
+	ds->state = RLE_ZOO_DSTREAM_OP;
+	ds->val = 0;
+}
+
+// Call once all input has been fed to the decoder. Returns the total number of bytes
+// produced, or the same negative error as the one-shot decoder if the input ended mid-OP.
+static inline ssize_t rle_zoo_dstream_end(const struct rle_zoo_dstream *ds) {
+	if (ds->state != RLE_ZOO_DSTREAM_OP) {
+		return (ssize_t)~(ds->op_pos & ((size_t)~0 >> 1UL));
+	}
+	return (ssize_t)ds->total_out;
+}
+
+#define RLE_ZOO_CSTREAM_WINDOW 256
+#define RLE_ZOO_MAX_OP_SIZE 129
+
+// State shared by the streaming encoders of all variants.
+// Initialize with rle_zoo_cstream_init() before the first call.
+struct rle_zoo_cstream {
+	size_t total_in;	// Total number of input bytes consumed.
+	size_t total_out;	// Total number of output bytes produced.
+	size_t win_rp;		// Read position in the lookahead window.
+	size_t win_len;		// Number of bytes in the lookahead window.
+	size_t op_rp;		// Number of bytes of the pending OP already output.
+	size_t op_len;		// Size of the pending OP.
+	size_t run;			// Length of a run still being counted, by variants with unbounded REPs.
+	uint8_t win[RLE_ZOO_CSTREAM_WINDOW];
+	uint8_t op[RLE_ZOO_MAX_OP_SIZE];
+};
+
+static inline void rle_zoo_cstream_init(struct rle_zoo_cstream *cs) {
+	cs->total_in = 0;
+	cs->total_out = 0;
+	cs->win_rp = 0;
+	cs->win_len = 0;
+	cs->op_rp = 0;
+	cs->op_len = 0;
+	cs->run = 0;
+}
+
+// Output sink callback. Receives the output in chunks of at most RLE_ZOO_SINK_BUFFER_SIZE bytes.
+// Return zero to continue, or non-zero to abort processing.
+typedef int (*rle_zoo_sink_fp)(void *ctx, const uint8_t *buf, size_t len);
+
+#ifndef RLE_ZOO_SINK_BUFFER_SIZE
+#define RLE_ZOO_SINK_BUFFER_SIZE 16384
+#endif
+
+enum rle_zoo_op_kind {
+	RLE_ZOO_OP_CPY,
+	RLE_ZOO_OP_REP,
+	RLE_ZOO_OP_LIT,
+	RLE_ZOO_OP_NOP,
+};
+
+// A parsed OP. A LIT is a CPY of one byte, where the payload is the OP byte itself.
+struct rle_zoo_op {
+	enum rle_zoo_op_kind kind;
+	size_t cnt;				// Number of output bytes.
+	const uint8_t *data;	// CPY/LIT: `cnt` bytes of payload. REP: the value to repeat.
+};
+
+typedef ssize_t (*rle_zoo_parse_op_fp)(const uint8_t *src, size_t slen, struct rle_zoo_op *op);
+
+// Encoder parameters, enough to estimate the size of the output from the runs in the input without encoding it.
+struct rle_zoo_params {
+	uint16_t min_rep;		// Shortest run encoded as a REP.
+	uint16_t max_rep;		// Longest REP.
+	uint16_t max_cpy;		// Longest CPY.
+	uint8_t cpy_overhead;	// Bytes of OP per CPY, or zero if literals are encoded as LITs.
+	uint8_t lit_limit;		// If non-zero, literals from this value up must be encoded as a REP.
+};
+#endif
+
+#ifdef __cplusplus
+}
+#endif
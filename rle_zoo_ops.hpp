@@ -0,0 +1,275 @@
+/*
+	Lazy RLE OP Streams & Coroutine Decoding for C++20
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	op_view<V> is a forward range over the OPs of a compressed stream, yielding the kind,
+	output count and payload of each OP without decoding anything. decode_chunks<V>() is
+	a coroutine that decodes into a consumer supplied buffer, yielding it each time it
+	fills up. Neither allocates per OP; the coroutine frame is the only allocation.
+
+	Both are driven by a 256 entry decode table per variant, the same as the rle8_tbl
+	decode tables generated by rle-genops, but built at compile-time from rle_zoo.hpp.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#ifndef RLE_ZOO_OPS_HPP
+#define RLE_ZOO_OPS_HPP
+
+#include "rle_zoo.hpp"
+
+#include <array>
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+
+namespace rle_zoo {
+
+template<typename V>
+inline constexpr std::array<op_code, 256> decode_table = [] {
+	std::array<op_code, 256> tbl{};
+	for (size_t b = 0 ; b < tbl.size() ; ++b) {
+		tbl[b] = V::decode((uint8_t)b);
+	}
+	return tbl;
+}();
+
+struct op_record {
+	op_kind kind;
+	size_t cnt;							// Number of output bytes.
+	size_t offset;						// Input offset of the OP.
+	std::span<const uint8_t> payload;	// CPY: the bytes to copy. REP: the value. LIT: the OP itself.
+
+	// True if the input ended inside this OP, in which case the payload is short.
+	constexpr bool truncated() const noexcept {
+		return (kind == op_kind::cpy && payload.size() < cnt) || (kind == op_kind::rep && payload.empty());
+	}
+};
+
+template<typename V>
+class op_view : public std::ranges::view_interface<op_view<V>> {
+public:
+	class iterator {
+	public:
+		using iterator_concept = std::forward_iterator_tag;
+		using value_type = op_record;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+		iterator(const uint8_t *src, size_t slen) : src_(src), slen_(slen) {
+			load();
+		}
+
+		const op_record &operator*() const noexcept { return rec_; }
+		const op_record *operator->() const noexcept { return &rec_; }
+
+		iterator &operator++() noexcept {
+			pos_ = next_;
+			load();
+			return *this;
+		}
+
+		iterator operator++(int) noexcept {
+			iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		bool operator==(const iterator &other) const noexcept { return pos_ == other.pos_; }
+		bool operator==(std::default_sentinel_t) const noexcept { return pos_ >= slen_; }
+
+	private:
+		void load() noexcept {
+			if (pos_ >= slen_) {
+				return;
+			}
+			uint8_t b = src_[pos_];
+			op_code op = decode_table<V>[b];
+			size_t avail = slen_ - pos_ - 1;
+			rec_.kind = op.kind;
+			rec_.cnt = op.cnt;
+			rec_.offset = pos_;
+			switch (op.kind) {
+				case op_kind::cpy:
+					rec_.payload = { src_ + pos_ + 1, std::min(op.cnt, avail) };
+					next_ = pos_ + 1 + rec_.payload.size();
+					break;
+				case op_kind::rep:
+					rec_.payload = { src_ + pos_ + 1, std::min((size_t)1, avail) };
+					next_ = pos_ + 1 + rec_.payload.size();
+					break;
+				case op_kind::lit:
+					rec_.payload = { src_ + pos_, 1 };
+					next_ = pos_ + 1;
+					break;
+				case op_kind::nop:
+					rec_.payload = {};
+					next_ = pos_ + 1;
+					break;
+			}
+		}
+
+		const uint8_t *src_ = nullptr;
+		size_t slen_ = 0;
+		size_t pos_ = 0;
+		size_t next_ = 0;
+		op_record rec_{};
+	};
+
+	op_view() = default;
+	explicit op_view(std::span<const uint8_t> src) : src_(src) {}
+
+	iterator begin() const { return iterator(src_.data(), src_.size()); }
+	std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+	std::span<const uint8_t> src_;
+};
+
+// Minimal generator, pending std::generator in C++23. Exceptions thrown by the coroutine are
+// rethrown from begin() or operator++.
+template<typename T>
+class generator {
+public:
+	struct promise_type {
+		const T *value = nullptr;
+		std::exception_ptr error;
+
+		generator get_return_object() noexcept { return generator(handle::from_promise(*this)); }
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		std::suspend_always final_suspend() const noexcept { return {}; }
+		std::suspend_always yield_value(const T &v) noexcept {
+			value = std::addressof(v);
+			return {};
+		}
+		void return_void() const noexcept {}
+		void unhandled_exception() noexcept { error = std::current_exception(); }
+	};
+	using handle = std::coroutine_handle<promise_type>;
+
+	class iterator {
+	public:
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+		explicit iterator(handle h) : h_(h) {}
+
+		const T &operator*() const noexcept { return *h_.promise().value; }
+		iterator &operator++() {
+			resume(h_);
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+		bool operator==(std::default_sentinel_t) const noexcept { return !h_ || h_.done(); }
+
+	private:
+		handle h_;
+	};
+
+	generator(generator &&other) noexcept : h_(std::exchange(other.h_, {})) {}
+	generator &operator=(generator &&other) noexcept {
+		if (this != &other) {
+			if (h_) {
+				h_.destroy();
+			}
+			h_ = std::exchange(other.h_, {});
+		}
+		return *this;
+	}
+	~generator() {
+		if (h_) {
+			h_.destroy();
+		}
+	}
+
+	iterator begin() {
+		resume(h_);
+		return iterator(h_);
+	}
+	std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+	explicit generator(handle h) : h_(h) {}
+
+	static void resume(handle h) {
+		h.resume();
+		if (h.done() && h.promise().error) {
+			std::rethrow_exception(h.promise().error);
+		}
+	}
+
+	handle h_;
+};
+
+// Decode `src` into `buf`, yielding the filled part of it each time it's full, and once more
+// at the end for any remainder. The yielded span is only valid until the coroutine is resumed.
+// Throws rle_zoo::error on truncated input, with the same result as <variant>_decompress().
+template<typename V>
+generator<std::span<const uint8_t>> decode_chunks(std::span<const uint8_t> src, std::span<uint8_t> buf) {
+	if (buf.empty()) {
+		throw std::invalid_argument("rle_zoo: decode_chunks buffer is empty");
+	}
+	size_t rp = 0;
+	size_t wp = 0;
+	while (rp < src.size()) {
+		uint8_t b = src[rp++];
+		op_code op = decode_table<V>[b];
+		size_t left = op.cnt;
+		switch (op.kind) {
+			case op_kind::rep:
+				if (rp >= src.size()) {
+					throw error(error_at(rp));
+				}
+				b = src[rp++];
+				while (left > 0) {
+					size_t n = std::min(left, buf.size() - wp);
+					std::fill_n(buf.data() + wp, n, b);
+					wp += n;
+					left -= n;
+					if (wp == buf.size()) {
+						co_yield std::span<const uint8_t>(buf.data(), wp);
+						wp = 0;
+					}
+				}
+				break;
+			case op_kind::cpy:
+				if (rp + op.cnt > src.size()) {
+					throw error(error_at(rp));
+				}
+				while (left > 0) {
+					size_t n = std::min(left, buf.size() - wp);
+					std::copy_n(src.data() + rp, n, buf.data() + wp);
+					rp += n;
+					wp += n;
+					left -= n;
+					if (wp == buf.size()) {
+						co_yield std::span<const uint8_t>(buf.data(), wp);
+						wp = 0;
+					}
+				}
+				break;
+			case op_kind::lit:
+				buf[wp++] = b;
+				if (wp == buf.size()) {
+					co_yield std::span<const uint8_t>(buf.data(), wp);
+					wp = 0;
+				}
+				break;
+			case op_kind::nop:
+				break;
+		}
+	}
+	if (wp > 0) {
+		co_yield std::span<const uint8_t>(buf.data(), wp);
+	}
+}
+
+} // namespace rle_zoo
+
+template<typename V>
+inline constexpr bool std::ranges::enable_borrowed_range<rle_zoo::op_view<V>> = true;
+
+#endif
@@ -0,0 +1,267 @@
+/*
+	RLE Zoo Asynchronous Job Tests
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_async.h"
+
+#include "rle-variant-selection.h"
+#include "test_common.h"
+
+#define NUM_JOBS 2000
+
+static atomic_int gate;
+static atomic_int callbacks;
+
+// Holds up the worker running it until the gate is opened.
+static ssize_t gated_func(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen) {
+	while (!atomic_load(&gate))
+		;
+	return packbits_compress(src, slen, dest, dlen);
+}
+
+static void count_done(struct rle_async_job *job) {
+	(void)job;
+	atomic_fetch_add(&callbacks, 1);
+}
+
+static struct rle_async_job *alloc_jobs(rle_fp func, size_t njobs) {
+	struct rle_async_job *jobs = calloc(njobs, sizeof(*jobs));
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		// Mix in some large jobs.
+		size_t len = (i % 16 == 0) ? 256 * 1024 : 64 + (size_t)rand() % 4096;
+		uint8_t *src = malloc(len);
+		fill_runs(src, len, 4, 200);
+		jobs[i].func = func;
+		jobs[i].src = src;
+		jobs[i].slen = len;
+		jobs[i].dest = malloc(len * 2);
+		jobs[i].dlen = len * 2;
+	}
+	return jobs;
+}
+
+static void free_jobs(struct rle_async_job *jobs, size_t njobs) {
+	for (size_t i = 0 ; i < njobs ; ++i) {
+		free((void*)(uintptr_t)jobs[i].src);
+		free(jobs[i].dest);
+	}
+	free(jobs);
+}
+
+static size_t wait_and_reap(struct rle_async_pool *pool, struct rle_async_job **done, size_t max) {
+	struct pollfd pfd = { .fd = rle_async_fd(pool), .events = POLLIN };
+	poll(&pfd, 1, 1000);
+	return rle_async_reap(pool, done, max);
+}
+
+// Submit jobs for every variant through a small queue, reaping completions via the notification
+// descriptor, and retrying submissions on backpressure. Verify against synchronous calls.
+static int test_async_reap(void) {
+	const char *testname = "rle_async_reap";
+	size_t fails = 0;
+
+	struct rle_async_config cfg = { .nthreads = 3, .small_threads = 1, .queue_size = 16, .large_threshold = 64 * 1024 };
+	struct rle_async_pool *pool = rle_async_create(&cfg);
+	assert(pool);
+
+	uint8_t *expected = malloc(512 * 1024);
+	struct rle_async_job *done[8];
+
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		struct rle_t *rle = &rle_variants[v];
+		struct rle_async_job *jobs = alloc_jobs(rle->compress, NUM_JOBS);
+
+		size_t submitted = 0;
+		size_t reaped = 0;
+		size_t rejected = 0;
+		while (reaped < NUM_JOBS) {
+			while (submitted < NUM_JOBS) {
+				if (rle_async_submit(pool, &jobs[submitted]) != 0) {
+					assert(errno == EAGAIN);
+					++rejected;
+					break;
+				}
+				++submitted;
+			}
+			size_t n = wait_and_reap(pool, done, sizeof(done)/sizeof(done[0]));
+			for (size_t j = 0 ; j < n ; ++j) {
+				struct rle_async_job *job = done[j];
+				size_t i = (size_t)(job - jobs);
+				ssize_t res = rle->compress(job->src, job->slen, expected, job->dlen);
+				if (atomic_load(&job->state) != RLE_ASYNC_DONE || job->result != res || memcmp(expected, job->dest, (size_t)res) != 0) {
+					TEST_ERRMSG("%s: job result mismatch, expected %zd, got %zd.", rle->name, res, job->result);
+					++fails;
+				}
+			}
+			reaped += n;
+		}
+		if (rejected == 0) {
+			size_t i = 0;
+			TEST_ERRMSG("%s: expected backpressure from a queue of %zu.", rle->name, cfg.queue_size);
+			++fails;
+		}
+		free_jobs(jobs, NUM_JOBS);
+	}
+
+	free(expected);
+	rle_async_destroy(pool);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+// Submit single jobs to an idle pool and wait for each, so that the submit races with
+// workers going to sleep. A lost wakeup leaves the job queued, and the wait times out.
+static int test_async_idle(void) {
+	const char *testname = "rle_async_idle";
+	size_t fails = 0;
+
+	struct rle_async_config cfg = { .nthreads = 2, .small_threads = 0, .queue_size = 16, .large_threshold = 64 * 1024 };
+	struct rle_async_pool *pool = rle_async_create(&cfg);
+	assert(pool);
+
+	struct rle_async_job *jobs = alloc_jobs(packbits_compress, NUM_JOBS);
+	for (size_t i = 0 ; i < NUM_JOBS ; ++i) {
+		if (rle_async_submit(pool, &jobs[i]) != 0) {
+			TEST_ERRMSG("submit to idle pool failed.");
+			++fails;
+			break;
+		}
+		struct rle_async_job *done[1];
+		size_t n = 0;
+		for (int tries = 0 ; n == 0 && tries < 5 ; ++tries) {
+			n = wait_and_reap(pool, done, 1);
+		}
+		if (n != 1 || done[0] != &jobs[i]) {
+			TEST_ERRMSG("job submitted to idle pool did not complete.");
+			++fails;
+			break;
+		}
+	}
+
+	rle_async_destroy(pool);
+	free_jobs(jobs, NUM_JOBS);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+// Hold up the only general worker with a gated job, then verify that small jobs still complete
+// on the reserved worker, and that queued large jobs can be cancelled.
+static int test_async_cancel(void) {
+	const char *testname = "rle_async_cancel";
+	size_t fails = 0;
+	size_t i = 0;
+
+	struct rle_async_config cfg = { .nthreads = 2, .small_threads = 1, .queue_size = 64, .large_threshold = 64 * 1024 };
+	struct rle_async_pool *pool = rle_async_create(&cfg);
+	assert(pool);
+
+	struct rle_async_job *large = alloc_jobs(packbits_compress, 32);
+	struct rle_async_job *small = alloc_jobs(packbits_compress, 15);
+	for (i = 0 ; i < 32 ; ++i) {
+		large[i].slen = large[i].dlen = 128 * 1024;
+	}
+	for (i = 0 ; i < 15 ; ++i) {
+		small[i].slen = small[i].dlen = 1024;
+		small[i].done = count_done;
+	}
+
+	atomic_store(&gate, 0);
+	atomic_store(&callbacks, 0);
+	large[0].func = gated_func;
+	for (i = 0 ; i < 32 ; ++i) {
+		if (rle_async_submit(pool, &large[i]) != 0) {
+			TEST_ERRMSG("submit of large job failed.");
+			++fails;
+		}
+	}
+	for (i = 0 ; i < 15 ; ++i) {
+		if (rle_async_submit(pool, &small[i]) != 0) {
+			TEST_ERRMSG("submit of small job failed.");
+			++fails;
+		}
+	}
+	while (atomic_load(&callbacks) < 15)
+		;
+
+	// large[0] may not have been picked up yet, but the rest are queued behind it.
+	rle_async_cancel(&large[0]);
+	for (i = 1 ; i < 32 ; ++i) {
+		if (rle_async_cancel(&large[i]) != 0) {
+			TEST_ERRMSG("cancel of queued job failed.");
+			++fails;
+		}
+	}
+	atomic_store(&gate, 1);
+
+	struct rle_async_job *done[32];
+	size_t reaped = 0;
+	while (reaped < 32) {
+		size_t n = wait_and_reap(pool, done + reaped, 32 - reaped);
+		for (size_t j = 0 ; j < n ; ++j) {
+			struct rle_async_job *job = done[reaped + j];
+			i = (size_t)(job - large);
+			int state = atomic_load(&job->state);
+			if (i > 0 && state != RLE_ASYNC_CANCELLED) {
+				TEST_ERRMSG("expected job to be cancelled, state=%d.", state);
+				++fails;
+			}
+		}
+		reaped += n;
+	}
+	i = 0;
+	if (rle_async_cancel(&large[1]) == 0) {
+		TEST_ERRMSG("cancel of completed job succeeded.");
+		++fails;
+	}
+
+	rle_async_destroy(pool);
+	free_jobs(small, 15);
+	free_jobs(large, 32);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+int main(void) {
+	size_t failed = 0;
+
+	failed += test_async_reap();
+	failed += test_async_idle();
+	failed += test_async_cancel();
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
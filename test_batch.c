@@ -0,0 +1,125 @@
+/*
+	RLE Zoo Batch Processing Tests
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_batch.h"
+
+#include "rle-variant-selection.h"
+#include "test_common.h"
+
+#define NUM_JOBS 5000
+#define MAX_JOB_SIZE 4096
+
+static uint8_t *make_input(size_t len, unsigned int seed) {
+	uint8_t *buf = malloc(len + 1);
+	srand(seed);
+	fill_runs(buf, len, 4, 200);
+	return buf;
+}
+
+// Run every variant over a batch of compress jobs, followed by a batch decompressing the
+// result, with some jobs given too small output buffers. Verify against single calls.
+static int test_batch(int nthreads) {
+	const char *testname = "rle_batch";
+	size_t fails = 0;
+
+	struct rle_batch_pool *pool = rle_batch_create(nthreads);
+	assert(pool);
+
+	struct rle_batch_job *cjobs = calloc(NUM_JOBS, sizeof(*cjobs));
+	struct rle_batch_job *djobs = calloc(NUM_JOBS, sizeof(*djobs));
+	uint8_t *expected = malloc(MAX_JOB_SIZE * 2);
+
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		struct rle_t *rle = &rle_variants[v];
+		for (size_t i = 0 ; i < NUM_JOBS ; ++i) {
+			size_t len = 64 + (size_t)rand() % (MAX_JOB_SIZE - 64);
+			cjobs[i] = (struct rle_batch_job){ rle->compress, make_input(len, i), len, malloc(len * 2), len * 2, 0 };
+			// Make every 97th job fail due to a too small destination buffer.
+			if (i % 97 == 0) {
+				cjobs[i].dlen = 1;
+			}
+		}
+
+		struct rle_batch_stats stats;
+		rle_batch_run(pool, cjobs, NUM_JOBS, &stats);
+
+		size_t expected_failed = 0;
+		for (size_t i = 0 ; i < NUM_JOBS ; ++i) {
+			ssize_t res = rle->compress(cjobs[i].src, cjobs[i].slen, expected, cjobs[i].dlen);
+			if (res != cjobs[i].result || (res > 0 && memcmp(expected, cjobs[i].dest, res) != 0)) {
+				TEST_ERRMSG("%s: compress job result mismatch, expected %zd, got %zd.", rle->name, res, cjobs[i].result);
+				++fails;
+			}
+			expected_failed += res < 0;
+			djobs[i] = (struct rle_batch_job){ rle->decompress, cjobs[i].dest, res < 0 ? 0 : (size_t)res, malloc(cjobs[i].slen), cjobs[i].slen, 0 };
+		}
+		if (stats.jobs != NUM_JOBS || stats.failed != expected_failed) {
+			size_t i = 0;
+			TEST_ERRMSG("%s: compress stats mismatch, %zu jobs and %zu failed.", rle->name, stats.jobs, stats.failed);
+			++fails;
+		}
+
+		rle_batch_run(pool, djobs, NUM_JOBS, &stats);
+
+		for (size_t i = 0 ; i < NUM_JOBS ; ++i) {
+			if (cjobs[i].result >= 0 && (djobs[i].result != (ssize_t)cjobs[i].slen || memcmp(djobs[i].dest, cjobs[i].src, cjobs[i].slen) != 0)) {
+				TEST_ERRMSG("%s: decompress job did not roundtrip, got %zd.", rle->name, djobs[i].result);
+				++fails;
+			}
+			free((void*)(uintptr_t)cjobs[i].src);
+			free(cjobs[i].dest);
+			free(djobs[i].dest);
+		}
+		if (stats.failed != 0) {
+			size_t i = 0;
+			TEST_ERRMSG("%s: decompress stats mismatch, %zu failed.", rle->name, stats.failed);
+			++fails;
+		}
+	}
+
+	free(expected);
+	free(djobs);
+	free(cjobs);
+	rle_batch_destroy(pool);
+
+	if (fails == 0) {
+		printf("Suite '%s' with %d worker threads passed " GREEN "OK" NC "\n", testname, nthreads);
+	}
+
+	return fails;
+}
+
+int main(void) {
+	size_t failed = 0;
+
+	failed += test_batch(0);
+	failed += test_batch(1);
+	failed += test_batch(4);
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,396 @@
+/*
+	RLE Zoo Parallel Block-Framed Encoding & Decoding Tests
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_crc.h"
+#include "rle_frame.h"
+#include "rle_block.h"
+
+#include "rle-variant-selection.h"
+#include "test_common.h"
+
+#define INPUT_SIZE (3 * 1024 * 1024 + 4321)
+
+// Encode with a range of block sizes and thread counts, check that the frame doesn't depend on the
+// number of threads, and that it decodes to the input with every thread count.
+static int test_block_roundtrip(void) {
+	const char *testname = "rle_block (roundtrip)";
+	size_t fails = 0;
+	size_t i = 0;
+
+	uint8_t *input = malloc(INPUT_SIZE);
+	fill_runs(input, INPUT_SIZE, 3, 3000);
+	uint8_t *output = malloc(INPUT_SIZE);
+	uint32_t input_crc = rle_crc32c(0, input, INPUT_SIZE);
+
+	const size_t block_sizes[] = { 4096, 65536 + 7, RLE_BLOCK_DEFAULT_SIZE, INPUT_SIZE, 2 * INPUT_SIZE };
+	const int thread_counts[] = { 1, 2, 5 };
+
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		struct rle_t *rle = &rle_variants[v];
+		if (!rle->compress_stream || !rle->parse_op) {
+			continue;
+		}
+		for (i = 0 ; i < sizeof(block_sizes) / sizeof(block_sizes[0]) ; ++i) {
+			size_t bs = block_sizes[i];
+			ssize_t flen = rle_block_compress(rle->compress_stream, rle->id, input, INPUT_SIZE, bs, 1, NULL, 0);
+			uint8_t *frame = malloc(flen);
+			uint8_t *frame2 = malloc(flen);
+			if (rle_block_compress(rle->compress_stream, rle->id, input, INPUT_SIZE, bs, 1, frame, flen) != flen) {
+				TEST_ERRMSG("%s: compress with block size %zu didn't match sizing.", rle->name, bs);
+				++fails;
+			}
+			if (rle_block_compress(rle->compress_stream, rle->id, input, INPUT_SIZE, bs, 3, frame2, flen - 1) != -1) {
+				TEST_ERRMSG("%s: expected failure with short output.", rle->name);
+				++fails;
+			}
+			struct rle_frame_header hdr;
+			if (rle_frame_read_header(frame, flen, &hdr) != RLE_FRAME_HEADER_SIZE || hdr.variant != rle->id ||
+				!(hdr.flags & RLE_FRAME_FLAG_BLOCKS) || hdr.decoded_size != INPUT_SIZE || hdr.crc != input_crc) {
+				TEST_ERRMSG("%s: unexpected header with block size %zu.", rle->name, bs);
+				++fails;
+			}
+			for (size_t t = 0 ; t < sizeof(thread_counts) / sizeof(thread_counts[0]) ; ++t) {
+				int nthreads = thread_counts[t];
+				if (rle_block_compress(rle->compress_stream, rle->id, input, INPUT_SIZE, bs, nthreads, frame2, flen) != flen || memcmp(frame, frame2, flen) != 0) {
+					TEST_ERRMSG("%s: frame with %d threads differs, block size %zu.", rle->name, nthreads, bs);
+					++fails;
+				}
+				memset(output, 0, INPUT_SIZE);
+				ssize_t res = rle_block_decompress(rle->parse_op, frame, flen, output, INPUT_SIZE, nthreads);
+				if (res != INPUT_SIZE || memcmp(output, input, INPUT_SIZE) != 0) {
+					TEST_ERRMSG("%s: decompress with %d threads failed, block size %zu, got %zd.", rle->name, nthreads, bs, res);
+					++fails;
+				}
+			}
+			if (rle_block_decompress(rle->parse_op, frame, flen, output, INPUT_SIZE - 1, 2) != -1) {
+				TEST_ERRMSG("%s: expected failure with short output.", rle->name);
+				++fails;
+			}
+			free(frame2);
+			free(frame);
+		}
+	}
+
+	// A plain frame, without blocks, decodes too.
+	struct rle_t *rle = get_rle_by_name("packbits");
+	size_t cap = 2 * INPUT_SIZE;
+	uint8_t *frame = malloc(RLE_FRAME_HEADER_SIZE + cap);
+	struct rle_frame_header hdr = { .variant = rle->id, .flags = RLE_FRAME_FLAG_CRC, .decoded_size = INPUT_SIZE };
+	uint32_t out_crc;
+	ssize_t clen = rle_crc_compress(rle->compress_stream, input, INPUT_SIZE, frame + RLE_FRAME_HEADER_SIZE, cap, &out_crc, &hdr.crc);
+	hdr.compressed_size = (size_t)clen;
+	rle_frame_write_header(&hdr, frame);
+	if (rle_block_decompress(rle->parse_op, frame, RLE_FRAME_HEADER_SIZE + clen, output, INPUT_SIZE, 4) != INPUT_SIZE || memcmp(output, input, INPUT_SIZE) != 0) {
+		TEST_ERRMSG("expected a plain frame to decode.");
+		++fails;
+	}
+	free(frame);
+
+	// Empty input gives a frame with an empty block table.
+	uint8_t empty[64];
+	ssize_t flen = rle_block_compress(rle->compress_stream, rle->id, input, 0, 4096, 2, empty, sizeof(empty));
+	if (flen != RLE_FRAME_HEADER_SIZE + 4 || rle_block_decompress(rle->parse_op, empty, flen, output, 0, 2) != 0) {
+		TEST_ERRMSG("expected an empty frame from empty input, got %zd.", flen);
+		++fails;
+	}
+	if (rle_block_compress(rle->compress_stream, rle->id, input, INPUT_SIZE, 0, 2, NULL, 0) != -1) {
+		TEST_ERRMSG("expected failure with a zero block size.");
+		++fails;
+	}
+
+	free(output);
+	free(input);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+// Corrupt a block's data, its table entry, and the frame itself, and verify that decoding fails.
+static int test_block_corrupt(void) {
+	const char *testname = "rle_block (corrupt)";
+	size_t fails = 0;
+	size_t i = 0;
+
+	const size_t len = 100000;
+	uint8_t *input = malloc(len);
+	fill_runs(input, len, 3, 3000);
+	uint8_t *output = malloc(len);
+
+	struct rle_t *rle = get_rle_by_name("packbits");
+	ssize_t flen = rle_block_compress(rle->compress_stream, rle->id, input, len, 8192, 1, NULL, 0);
+	uint8_t *frame = malloc(flen);
+	rle_block_compress(rle->compress_stream, rle->id, input, len, 8192, 1, frame, flen);
+	size_t nblocks = 0;
+	ssize_t tlen = rle_frame_read_blocks(frame + RLE_FRAME_HEADER_SIZE, flen - RLE_FRAME_HEADER_SIZE, NULL, 0, &nblocks);
+	if (tlen != (ssize_t)(4 + 13 * RLE_FRAME_BLOCK_ENTRY_SIZE) || nblocks != 13) {
+		TEST_ERRMSG("unexpected block table of %zd bytes, %zu blocks.", tlen, nblocks);
+		++fails;
+	}
+	size_t data_ofs = RLE_FRAME_HEADER_SIZE + (size_t)tlen;
+
+	// A changed literal decodes, but fails its block's checksum.
+	for (i = data_ofs ; i < (size_t)flen && frame[i] > 0x7F ; i += 2) { }
+	frame[i + 1] ^= 0x01;
+	if (rle_block_decompress(rle->parse_op, frame, flen, output, len, 3) != -1) {
+		TEST_ERRMSG("expected a checksum failure.");
+		++fails;
+	}
+	frame[i + 1] ^= 0x01;
+
+	// A truncated block fails at the position of its last OP.
+	struct rle_frame_block blocks[13];
+	rle_frame_read_blocks(frame + RLE_FRAME_HEADER_SIZE, flen - RLE_FRAME_HEADER_SIZE, blocks, 13, &nblocks);
+	blocks[0].compressed_size -= 1;
+	blocks[1].compressed_size += 1;
+	rle_frame_write_blocks(blocks, nblocks, frame + RLE_FRAME_HEADER_SIZE);
+	ssize_t res = rle_block_decompress(rle->parse_op, frame, flen, output, len, 3);
+	if (res >= -1 || (size_t)~res - 1 < data_ofs || (size_t)~res - 1 >= data_ofs + blocks[0].compressed_size) {
+		TEST_ERRMSG("expected an OP error within the first block, got %zd.", res);
+		++fails;
+	}
+	blocks[0].compressed_size += 1;
+	blocks[1].compressed_size -= 1;
+
+	// A block size not adding up to the header.
+	blocks[0].decoded_size += 1;
+	rle_frame_write_blocks(blocks, nblocks, frame + RLE_FRAME_HEADER_SIZE);
+	if (rle_block_decompress(rle->parse_op, frame, flen, output, len, 3) != -1) {
+		TEST_ERRMSG("expected failure with inconsistent block sizes.");
+		++fails;
+	}
+	blocks[0].decoded_size -= 1;
+	rle_frame_write_blocks(blocks, nblocks, frame + RLE_FRAME_HEADER_SIZE);
+
+	// A truncated frame.
+	if (rle_block_decompress(rle->parse_op, frame, flen - 1, output, len, 3) != -1) {
+		TEST_ERRMSG("expected failure with a truncated frame.");
+		++fails;
+	}
+
+	if (rle_block_decompress(rle->parse_op, frame, flen, output, len, 3) != (ssize_t)len || memcmp(output, input, len) != 0) {
+		TEST_ERRMSG("expected the restored frame to decode.");
+		++fails;
+	}
+
+	free(frame);
+	free(output);
+	free(input);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+// Regions, each a few blocks long, favouring a different choice: runs of 130, which icns encodes in one OP,
+// single bytes alternating with runs of three, which pcx encodes without CPYs, and noise, which is stored.
+static void make_mixed_input(uint8_t *buf, size_t len, size_t region) {
+	for (size_t i = 0 ; i < len ; ) {
+		size_t end = i + region < len ? i + region : len;
+		int kind = (int)((i / region) % 3);
+		while (i < end) {
+			uint8_t val = (uint8_t)(rand() % 0xC0);
+			size_t run = kind == 0 ? 130 : (kind == 1 ? ((i & 1) ? 3 : 1) : 1);
+			while (run-- && i < end) {
+				buf[i++] = kind == 2 ? (uint8_t)rand() : val;
+			}
+		}
+	}
+}
+
+// Encode adaptively, check that the output is no larger than with any single variant, that blocks pick
+// different variants, and that it decodes with every thread count.
+static int test_block_adaptive(void) {
+	const char *testname = "rle_block (adaptive)";
+	size_t fails = 0;
+	size_t i = 0;
+
+	const size_t len = 300000;
+	const size_t bs = 4096;
+	uint8_t *input = malloc(len);
+	make_mixed_input(input, len, 4 * bs);
+	uint8_t *output = malloc(len);
+
+	struct rle_block_variant variants[RLE_BLOCK_MAX_VARIANTS];
+	size_t nvariants = 0;
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		struct rle_t *rle = &rle_variants[v];
+		if (rle->params && rle->compress_stream && rle->parse_op) {
+			struct rle_block_variant bv = { rle->id, rle->params, rle->compress_stream, rle->parse_op };
+			variants[nvariants++] = bv;
+		}
+	}
+
+	ssize_t flen = rle_block_compress_adaptive(variants, nvariants, input, len, bs, 1, NULL, 0);
+	uint8_t *frame = malloc(flen);
+	uint8_t *frame2 = malloc(flen);
+	if (rle_block_compress_adaptive(variants, nvariants, input, len, bs, 1, frame, flen) != flen) {
+		TEST_ERRMSG("compress didn't match sizing.");
+		++fails;
+	}
+	if (rle_block_compress_adaptive(variants, nvariants, input, len, bs, 2, frame2, flen - 1) != -1) {
+		TEST_ERRMSG("expected failure with short output.");
+		++fails;
+	}
+	struct rle_frame_header hdr;
+	if (rle_frame_read_header(frame, flen, &hdr) != RLE_FRAME_HEADER_SIZE || hdr.variant != 0 ||
+		!(hdr.flags & RLE_FRAME_FLAG_ADAPTIVE) || hdr.decoded_size != len || hdr.crc != rle_crc32c(0, input, len)) {
+		TEST_ERRMSG("unexpected header.");
+		++fails;
+	}
+
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		struct rle_t *rle = &rle_variants[v];
+		if (!rle->compress_stream) {
+			continue;
+		}
+		ssize_t vlen = rle_block_compress(rle->compress_stream, rle->id, input, len, bs, 1, NULL, 0);
+		if (flen > vlen) {
+			TEST_ERRMSG("adaptive frame of %zd bytes larger than %zd with %s.", flen, vlen, rle->name);
+			++fails;
+		}
+	}
+
+	// Tally the variant of each block.
+	size_t counts[256] = { 0 };
+	struct rle_frame_block blocks[100];
+	size_t nblocks = 0;
+	ssize_t tlen = rle_frame_read_blocks(frame + RLE_FRAME_HEADER_SIZE, flen - RLE_FRAME_HEADER_SIZE, blocks, 100, &nblocks);
+	size_t ofs = RLE_FRAME_HEADER_SIZE + (size_t)tlen;
+	for (i = 0 ; i < nblocks ; ++i) {
+		++counts[frame[ofs]];
+		ofs += blocks[i].compressed_size;
+	}
+	i = 0;
+	if (counts[0] == 0 || counts[get_rle_by_name("icns")->id] == 0 || counts[get_rle_by_name("pcx")->id] == 0) {
+		TEST_ERRMSG("expected stored, icns and pcx blocks, got %zu, %zu and %zu.", counts[0], counts[get_rle_by_name("icns")->id], counts[get_rle_by_name("pcx")->id]);
+		++fails;
+	}
+
+	const int thread_counts[] = { 1, 2, 5 };
+	for (i = 0 ; i < sizeof(thread_counts) / sizeof(thread_counts[0]) ; ++i) {
+		int nthreads = thread_counts[i];
+		if (rle_block_compress_adaptive(variants, nvariants, input, len, bs, nthreads, frame2, flen) != flen || memcmp(frame, frame2, flen) != 0) {
+			TEST_ERRMSG("frame with %d threads differs.", nthreads);
+			++fails;
+		}
+		memset(output, 0, len);
+		ssize_t res = rle_block_decompress_adaptive(variants, nvariants, frame, flen, output, len, nthreads);
+		if (res != (ssize_t)len || memcmp(output, input, len) != 0) {
+			TEST_ERRMSG("decompress with %d threads failed, got %zd.", nthreads, res);
+			++fails;
+		}
+	}
+
+	// Decoding needs every variant used, and single-variant decoding doesn't apply.
+	struct rle_t *rle = get_rle_by_name("packbits");
+	if (rle_block_decompress(rle->parse_op, frame, flen, output, len, 2) != -1) {
+		TEST_ERRMSG("expected failure to decode adaptive frame with a single variant.");
+		++fails;
+	}
+	if (rle_block_decompress_adaptive(variants, 2, frame, flen, output, len, 2) != -1) {
+		TEST_ERRMSG("expected failure with missing variants.");
+		++fails;
+	}
+
+	// An unknown variant in a block.
+	ofs = RLE_FRAME_HEADER_SIZE + (size_t)tlen;
+	uint8_t id = frame[ofs];
+	frame[ofs] = 0xEE;
+	if (rle_block_decompress_adaptive(variants, nvariants, frame, flen, output, len, 2) != -1) {
+		TEST_ERRMSG("expected failure with an unknown block variant.");
+		++fails;
+	}
+	frame[ofs] = id;
+
+	// Single-variant frames decode through the table too.
+	free(frame2);
+	frame2 = malloc(len * 2);
+	ssize_t vlen = rle_block_compress(rle->compress_stream, rle->id, input, len, bs, 2, frame2, len * 2);
+	if (rle_block_decompress_adaptive(variants, nvariants, frame2, vlen, output, len, 2) != (ssize_t)len || memcmp(output, input, len) != 0) {
+		TEST_ERRMSG("expected a single-variant frame to decode.");
+		++fails;
+	}
+
+	// A variant whose parameters understate its cost of literals and long runs is picked for some blocks, while the
+	// other has the smallest estimated total. Encoding every block with that one is smaller, and is what's written.
+	const struct rle_zoo_params cheap = { 3, 4, 128, 0, 0 };
+	struct rle_t *icns = get_rle_by_name("icns");
+	struct rle_block_variant skewed[2] = {
+		{ rle->id, rle->params, rle->compress_stream, rle->parse_op },
+		{ icns->id, &cheap, icns->compress_stream, icns->parse_op },
+	};
+	for (i = 0 ; i < len ; ) {
+		int literals = (i / (4 * bs)) % 2;
+		uint8_t val = (uint8_t)rand();
+		size_t run = literals ? ((i & 1) ? 3 : 1) : 130;
+		while (run-- && i < len) {
+			input[i++] = val;
+		}
+	}
+	i = 0;
+	vlen = rle_block_compress(rle->compress_stream, rle->id, input, len, bs, 2, frame2, len * 2);
+	flen = rle_block_compress_adaptive(skewed, 2, input, len, bs, 2, NULL, 0);
+	if (flen != vlen) {
+		TEST_ERRMSG("expected a plain %s frame of %zd bytes from mixed picks, got %zd.", rle->name, vlen, flen);
+		++fails;
+	}
+
+	// When every block picks the same variant, the frame is the plain one.
+	fill_runs(input, len, 3, 3000);
+	uint8_t *frame3 = malloc(len * 2);
+	struct rle_block_variant only = { rle->id, rle->params, rle->compress_stream, rle->parse_op };
+	vlen = rle_block_compress(rle->compress_stream, rle->id, input, len, bs, 2, frame2, len * 2);
+	if (rle_block_compress_adaptive(&only, 1, input, len, bs, 2, frame3, len * 2) != vlen || memcmp(frame2, frame3, vlen) != 0) {
+		TEST_ERRMSG("expected a plain frame when all blocks use %s.", rle->name);
+		++fails;
+	}
+	free(frame3);
+
+	free(frame2);
+	free(frame);
+	free(output);
+	free(input);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+int main(void) {
+	size_t failed = 0;
+
+	failed += test_block_roundtrip();
+	failed += test_block_corrupt();
+	failed += test_block_adaptive();
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,31 @@
+/*
+	Shared Helpers for the RLE Zoo Tests and Benchmarks
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define RED "\e[1;31m"
+#define GREEN "\e[0;32m"
+#define YELLOW "\e[1;33m"
+#define NC "\e[0m"
+
+// Report an error as `<testname>:<i>: error: ...`. Like the one in test_rle.c, this expands to references to
+// locals of the caller, which must have a string `testname` naming the suite and a size_t `i` for the failing item.
+#define TEST_ERRMSG(fmt, ...) \
+	fprintf(stderr,"%s:%zu:" RED " error: " NC fmt "\n", testname, i __VA_OPT__(,) __VA_ARGS__)
+
+// Fill `buf` with random bytes, where one in `odds` starts a run of 1 to `max_run` bytes.
+static inline void fill_runs(uint8_t *buf, size_t len, int odds, size_t max_run) {
+	for (size_t i = 0 ; i < len ; ) {
+		size_t run = (rand() % odds == 0) ? 1 + (size_t)rand() % max_run : 1;
+		uint8_t val = (uint8_t)rand();
+		while (run-- && i < len) {
+			buf[i++] = val;
+		}
+	}
+}
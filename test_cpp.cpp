@@ -0,0 +1,297 @@
+/*
+	RLE Zoo C++ Wrapper Tests
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	Verifies that rle_zoo.hpp produces the same output and results as the C headers.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+
+#include "rle_zoo.hpp"
+#include "rle_zoo_ops.hpp"
+
+#define RED "\e[1;31m"
+#define GREEN "\e[0;32m"
+#define NC "\e[0m"
+
+#define TEST_ERRMSG(fmt, ...) \
+	fprintf(stderr,"%s:%zu:" RED " error: " NC fmt "\n", testname, i __VA_OPT__(,) __VA_ARGS__)
+
+#define NUM_INPUTS 2000
+
+using c_fp = ssize_t (*)(const uint8_t *src, size_t slen, uint8_t *dest, size_t dlen);
+using c_parse_op_fp = ssize_t (*)(const uint8_t *src, size_t slen, struct rle_zoo_op *op);
+
+static_assert(std::ranges::forward_range<rle_zoo::op_view<rle_zoo::packbits_traits>>);
+static_assert(std::ranges::view<rle_zoo::op_view<rle_zoo::packbits_traits>>);
+
+static std::vector<uint8_t> make_input(std::mt19937 &rng, size_t len) {
+	std::vector<uint8_t> buf(len);
+	for (size_t i = 0 ; i < len ; ) {
+		size_t run = (rng() % 4 == 0) ? 1 + rng() % 200 : 1 + rng() % 3;
+		// Small alphabet to get plenty of short runs, and sometimes values >= 192 for pcx.
+		uint8_t val = (uint8_t)((rng() % 2) ? rng() % 4 : rng());
+		while (run-- && i < len) {
+			buf[i++] = val;
+		}
+	}
+	return buf;
+}
+
+template<typename V>
+static size_t test_variant(c_fp c_compress, c_fp c_decompress) {
+	const char *testname = V::name;
+	size_t fails = 0;
+	std::mt19937 rng(1234);
+
+	for (size_t i = 0 ; i < NUM_INPUTS ; ++i) {
+		std::vector<uint8_t> input = make_input(rng, rng() % 2048);
+
+		// Compress: sizing, fixed span, iterator and vector forms.
+		ssize_t c_len = c_compress(input.data(), input.size(), NULL, 0);
+		std::vector<uint8_t> c_out((size_t)c_len);
+		c_compress(input.data(), input.size(), c_out.data(), c_out.size());
+
+		if ((ssize_t)V::compressed_size(input) != c_len) {
+			TEST_ERRMSG("compressed_size %zu != %zd", V::compressed_size(input), c_len);
+			++fails;
+		}
+		if (V::compress_bound(input.size()) < (size_t)c_len) {
+			TEST_ERRMSG("compress_bound %zu < %zd", V::compress_bound(input.size()), c_len);
+			++fails;
+		}
+		std::vector<uint8_t> out = V::compress(input);
+		if (out != c_out) {
+			TEST_ERRMSG("vector compress mismatch");
+			++fails;
+		}
+		std::vector<uint8_t> it_out;
+		if (V::compress(input, std::back_inserter(it_out)) != c_len || it_out != c_out) {
+			TEST_ERRMSG("iterator compress mismatch");
+			++fails;
+		}
+
+		// Too small output buffers fail the same way.
+		if (c_len > 0) {
+			size_t dlen = rng() % (size_t)c_len;
+			// One extra byte so that the C function isn't handed NULL for dlen zero.
+			std::vector<uint8_t> small(dlen + 1), c_small(dlen + 1);
+			ssize_t res = V::compress(input, std::span<uint8_t>(small.data(), dlen));
+			ssize_t c_res = c_compress(input.data(), input.size(), c_small.data(), dlen);
+			if (res != c_res || small != c_small) {
+				TEST_ERRMSG("short span compress %zd != %zd", res, c_res);
+				++fails;
+			}
+		}
+
+		// Decompress, including truncated input and short output.
+		if (V::decompress(c_out) != input) {
+			TEST_ERRMSG("vector decompress mismatch");
+			++fails;
+		}
+		std::vector<uint8_t> it_in;
+		if (V::decompress(c_out, std::back_inserter(it_in)) != (ssize_t)input.size() || it_in != input) {
+			TEST_ERRMSG("iterator decompress mismatch");
+			++fails;
+		}
+		if (c_len > 0) {
+			std::span<const uint8_t> trunc(c_out.data(), rng() % (size_t)c_len);
+			ssize_t res = V::decompressed_size(trunc);
+			ssize_t c_res = c_decompress(trunc.data(), trunc.size(), NULL, 0);
+			if (res != c_res) {
+				TEST_ERRMSG("truncated decompressed_size %zd != %zd", res, c_res);
+				++fails;
+			}
+			if (res < 0) {
+				try {
+					V::decompress(trunc);
+					TEST_ERRMSG("expected exception on truncated input");
+					++fails;
+				} catch (const rle_zoo::error &e) {
+					if (e.result != c_res) {
+						TEST_ERRMSG("exception result %zd != %zd", e.result, c_res);
+						++fails;
+					}
+				}
+			}
+		}
+		if (!input.empty()) {
+			size_t dlen = rng() % input.size();
+			std::vector<uint8_t> small(dlen + 1), c_small(dlen + 1);
+			ssize_t res = V::decompress(c_out, std::span<uint8_t>(small.data(), dlen));
+			ssize_t c_res = c_decompress(c_out.data(), c_out.size(), c_small.data(), dlen);
+			if (res != c_res || small != c_small) {
+				TEST_ERRMSG("short span decompress %zd != %zd", res, c_res);
+				++fails;
+			}
+		}
+
+		// Arbitrary bytes as compressed input.
+		std::vector<uint8_t> junk(rng() % 64);
+		for (auto &b : junk) {
+			b = (uint8_t)rng();
+		}
+		std::vector<uint8_t> junk_out(512), c_junk_out(512);
+		ssize_t res = V::decompress(junk, std::span<uint8_t>(junk_out));
+		ssize_t c_res = c_decompress(junk.data(), junk.size(), c_junk_out.data(), c_junk_out.size());
+		if (res != c_res || junk_out != c_junk_out) {
+			TEST_ERRMSG("junk decompress %zd != %zd", res, c_res);
+			++fails;
+		}
+	}
+
+	if (fails == 0) {
+		printf("Suite '%s' (C++) passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+// Walk op_view over the compressed stream, checking each OP against the C parser and rebuilding
+// the output from the records. Then decode with decode_chunks() into a randomly sized buffer.
+template<typename V>
+static size_t test_ops(c_fp c_compress, c_fp c_decompress, c_parse_op_fp c_parse_op) {
+	const char *testname = V::name;
+	size_t fails = 0;
+	std::mt19937 rng(4321);
+
+	for (size_t i = 0 ; i < NUM_INPUTS ; ++i) {
+		std::vector<uint8_t> input = make_input(rng, rng() % 2048);
+		std::vector<uint8_t> comp(V::compress_bound(input.size()));
+		comp.resize((size_t)c_compress(input.data(), input.size(), comp.data(), comp.size()));
+		// Sometimes truncate, or use arbitrary bytes.
+		if (rng() % 8 == 0 && !comp.empty()) {
+			comp.resize(rng() % comp.size());
+		} else if (rng() % 8 == 0) {
+			for (auto &b : comp) {
+				b = (uint8_t)rng();
+			}
+		}
+
+		std::vector<uint8_t> rebuilt;
+		bool truncated = false;
+		for (const rle_zoo::op_record &rec : rle_zoo::op_view<typename V::traits>(comp)) {
+			struct rle_zoo_op op{};
+			ssize_t oplen = c_parse_op(comp.data() + rec.offset, comp.size() - rec.offset, &op);
+			if (rec.truncated()) {
+				truncated = true;
+				if (oplen != -1) {
+					TEST_ERRMSG("op at %zu truncated but C parser returned %zd", rec.offset, oplen);
+					++fails;
+				}
+				break;
+			}
+			if ((int)op.kind != (int)rec.kind || op.cnt != rec.cnt || (op.cnt > 0 && op.data != rec.payload.data())) {
+				TEST_ERRMSG("op at %zu mismatch", rec.offset);
+				++fails;
+				break;
+			}
+			if (rec.kind == rle_zoo::op_kind::rep) {
+				rebuilt.insert(rebuilt.end(), rec.cnt, rec.payload[0]);
+			} else if (rec.kind != rle_zoo::op_kind::nop) {
+				rebuilt.insert(rebuilt.end(), rec.payload.begin(), rec.payload.end());
+			}
+		}
+
+		ssize_t c_len = c_decompress(comp.data(), comp.size(), NULL, 0);
+		std::vector<uint8_t> c_out(c_len > 0 ? (size_t)c_len : 0);
+		if (c_len > 0) {
+			c_decompress(comp.data(), comp.size(), c_out.data(), c_out.size());
+		}
+		if (truncated != (c_len < 0) || (!truncated && rebuilt != c_out)) {
+			TEST_ERRMSG("op_view output mismatch");
+			++fails;
+		}
+
+		std::vector<uint8_t> buf(1 + rng() % 300);
+		std::vector<uint8_t> chunked;
+		try {
+			for (std::span<const uint8_t> chunk : rle_zoo::decode_chunks<typename V::traits>(comp, buf)) {
+				if (chunk.size() > buf.size()) {
+					TEST_ERRMSG("chunk larger than buffer");
+					++fails;
+				}
+				chunked.insert(chunked.end(), chunk.begin(), chunk.end());
+			}
+			if (c_len < 0 || chunked != c_out) {
+				TEST_ERRMSG("decode_chunks output mismatch");
+				++fails;
+			}
+		} catch (const rle_zoo::error &e) {
+			if (e.result != c_len) {
+				TEST_ERRMSG("decode_chunks error %zd != %zd", e.result, c_len);
+				++fails;
+			}
+		}
+	}
+
+	if (fails == 0) {
+		printf("Suite '%s' (C++ ops) passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+// Compile-time compression of embedded assets.
+static constexpr auto packbits_blob = rle_zoo::packbits::compress<"AAAAAAAAAAAAAAAABCDEFGHHHHHHHHHHHHHHHHHHHHHHHHHHHHHHHHHHHH">();
+static_assert(packbits_blob.size() == 11);
+static_assert(rle_zoo::packbits::decompress<packbits_blob>().size() == 58);
+static constexpr std::array<uint8_t, 5> pcx_bytes = { 0x01, 0xC0, 0xC0, 0xFF, 0x02 };
+static constexpr auto pcx_blob = rle_zoo::pcx::compress<pcx_bytes>();
+static_assert(rle_zoo::pcx::decompress<pcx_blob>() == pcx_bytes);
+
+template<typename V, auto Blob>
+static size_t test_constexpr(const char *input, c_fp c_compress) {
+	const char *testname = V::name;
+	size_t fails = 0;
+	size_t i = 0;
+
+	std::vector<uint8_t> c_out(V::compress_bound(strlen(input)));
+	c_out.resize((size_t)c_compress((const uint8_t*)input, strlen(input), c_out.data(), c_out.size()));
+	if (!std::equal(Blob.begin(), Blob.end(), c_out.begin(), c_out.end())) {
+		TEST_ERRMSG("constexpr compress mismatch");
+		++fails;
+	}
+	if (fails == 0) {
+		printf("Suite '%s' (C++ constexpr) passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+#define CONSTEXPR_INPUT "Hello World!!!!! ...and then some more data, zzzzzzzzzzzzzzzzzzzzzzzzzzzzzz.\xff\xff\xc0"
+
+int main(void) {
+	size_t failed = 0;
+
+	failed += test_variant<rle_zoo::goldbox>(goldbox_compress, goldbox_decompress);
+	failed += test_variant<rle_zoo::packbits>(packbits_compress, packbits_decompress);
+	failed += test_variant<rle_zoo::pcx>(pcx_compress, pcx_decompress);
+	failed += test_variant<rle_zoo::icns>(icns_compress, icns_decompress);
+
+	failed += test_ops<rle_zoo::goldbox>(goldbox_compress, goldbox_decompress, goldbox_parse_op);
+	failed += test_ops<rle_zoo::packbits>(packbits_compress, packbits_decompress, packbits_parse_op);
+	failed += test_ops<rle_zoo::pcx>(pcx_compress, pcx_decompress, pcx_parse_op);
+	failed += test_ops<rle_zoo::icns>(icns_compress, icns_decompress, icns_parse_op);
+
+	failed += test_constexpr<rle_zoo::goldbox, rle_zoo::goldbox::compress<CONSTEXPR_INPUT>()>(CONSTEXPR_INPUT, goldbox_compress);
+	failed += test_constexpr<rle_zoo::packbits, rle_zoo::packbits::compress<CONSTEXPR_INPUT>()>(CONSTEXPR_INPUT, packbits_compress);
+	failed += test_constexpr<rle_zoo::pcx, rle_zoo::pcx::compress<CONSTEXPR_INPUT>()>(CONSTEXPR_INPUT, pcx_compress);
+	failed += test_constexpr<rle_zoo::icns, rle_zoo::icns::compress<CONSTEXPR_INPUT>()>(CONSTEXPR_INPUT, icns_compress);
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
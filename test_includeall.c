@@ -7,6 +7,7 @@
 
 	See https://github.com/eloj/rle-zoo
 */
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <sys/types.h>
@@ -19,6 +20,42 @@
 #include "rle_pcx.h"
 #define RLE_ZOO_ICNS_IMPLEMENTATION
 #include "rle_icns.h"
+#define RLE_ZOO_SPLIT_IMPLEMENTATION
+#include "rle_split.h"
+#define RLE_ZOO_LONGRUN_IMPLEMENTATION
+#include "rle_longrun.h"
+#define RLE_ZOO_RLEW_IMPLEMENTATION
+#include "rle_rlew.h"
+#define RLE_ZOO_NIBBLE_IMPLEMENTATION
+#include "rle_nibble.h"
+#define RLE_ZOO_BITMASK_IMPLEMENTATION
+#include "rle_bitmask.h"
+#define RLE_ZOO_SPAN_IMPLEMENTATION
+#include "rle_span.h"
+#define RLE_ZOO_CURSOR_IMPLEMENTATION
+#include "rle_cursor.h"
+#define RLE_ZOO_QUERY_IMPLEMENTATION
+#include "rle_query.h"
+#define RLE_ZOO_EDIT_IMPLEMENTATION
+#include "rle_edit.h"
+#define RLE_ZOO_SEARCH_IMPLEMENTATION
+#include "rle_search.h"
+#define RLE_ZOO_CRC_IMPLEMENTATION
+#include "rle_crc.h"
+#define RLE_ZOO_FRAME_IMPLEMENTATION
+#include "rle_frame.h"
+#define RLE_ZOO_INDEX_IMPLEMENTATION
+#include "rle_index.h"
+#define RLE_ZOO_ARCHIVE_IMPLEMENTATION
+#include "rle_archive.h"
+#define RLE_ZOO_BATCH_IMPLEMENTATION
+#include "rle_batch.h"
+#define RLE_ZOO_ASYNC_IMPLEMENTATION
+#include "rle_async.h"
+#define RLE_ZOO_LAZY_IMPLEMENTATION
+#include "rle_lazy.h"
+#define RLE_ZOO_BLOCK_IMPLEMENTATION
+#include "rle_block.h"
 
 int main(void) {
 	const uint8_t input[] = "ABBCCCDDDDEEEEE";
@@ -0,0 +1,154 @@
+/*
+	RLE Zoo Lazily Decoded Buffer Tests
+	Copyright (c) 2022, Eddy L O Jansson. Licensed under The MIT License.
+
+	See https://github.com/eloj/rle-zoo
+*/
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#define RLE_ZOO_IMPLEMENTATION
+#include "rle_goldbox.h"
+#include "rle_packbits.h"
+#include "rle_pcx.h"
+#include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_cursor.h"
+#include "rle_lazy.h"
+
+#include "rle-variant-selection.h"
+#include "test_common.h"
+
+#define INPUT_SIZE (4 * 1024 * 1024 + 123)
+#define MAX_RESIDENT 8
+
+// Read scattered windows of each variant's output through rle_lazy_read() and rle_lazy_get(), and
+// through the plain pointer when backed by userfaultfd, and verify that only a bounded number of
+// pages are decoded.
+static int test_lazy_mode(int no_fault) {
+	const char *testname = no_fault ? "rle_lazy (accessor)" : "rle_lazy (mapped)";
+	size_t fails = 0;
+	size_t i = 0;
+
+	uint8_t *input = malloc(INPUT_SIZE);
+	fill_runs(input, INPUT_SIZE, 3, 20000);
+	uint8_t window[10000];
+
+	for (size_t v = 0 ; v < RLE_ZOO_NUM_VARIANTS ; ++v) {
+		struct rle_t *rle = &rle_variants[v];
+		if (!rle->parse_op) {
+			continue;
+		}
+		ssize_t clen = rle->compress(input, INPUT_SIZE, NULL, 0);
+		uint8_t *comp = malloc(clen);
+		rle->compress(input, INPUT_SIZE, comp, clen);
+
+		struct rle_lazy_config cfg = { .max_resident = MAX_RESIDENT, .no_fault = no_fault };
+		struct rle_lazy *lz = rle_lazy_create(rle->parse_op, comp, clen, &cfg);
+		if (!lz || rle_lazy_size(lz) != INPUT_SIZE) {
+			TEST_ERRMSG("%s: create failed, errno %d.", rle->name, errno);
+			++fails;
+			free(comp);
+			continue;
+		}
+		const uint8_t *data = rle_lazy_data(lz);
+		if (!no_fault && !data) {
+			printf(YELLOW "%s: userfaultfd unavailable, using accessors." NC "\n", rle->name);
+		} else if (no_fault && data) {
+			TEST_ERRMSG("%s: expected no plain pointer without faulting.", rle->name);
+			++fails;
+		}
+
+		size_t touched = 0;
+		for (i = 0 ; i < 64 ; ++i) {
+			size_t ofs = (size_t)rand() % INPUT_SIZE;
+			size_t len = 1 + (size_t)rand() % sizeof(window);
+			if (len > INPUT_SIZE - ofs) {
+				len = INPUT_SIZE - ofs;
+			}
+			ssize_t res = rle_lazy_read(lz, ofs, window, len);
+			if (res != (ssize_t)len || memcmp(window, input + ofs, len) != 0) {
+				TEST_ERRMSG("%s: read of %zu bytes at %zu mismatch, got %zd.", rle->name, len, ofs, res);
+				++fails;
+			}
+			const uint8_t *p = rle_lazy_get(lz, ofs);
+			if (!p || *p != input[ofs]) {
+				TEST_ERRMSG("%s: get at %zu mismatch.", rle->name, ofs);
+				++fails;
+			}
+			if (data && memcmp(data + ofs, input + ofs, len) != 0) {
+				TEST_ERRMSG("%s: direct access of %zu bytes at %zu mismatch.", rle->name, len, ofs);
+				++fails;
+			}
+			touched += len / 4096 + 2;
+		}
+		if (rle_lazy_get(lz, INPUT_SIZE) != NULL || rle_lazy_read(lz, INPUT_SIZE - 1, window, 2) != 1) {
+			TEST_ERRMSG("%s: expected access past the end to stop at the end.", rle->name);
+			++fails;
+		}
+		if (data) {
+			// A full pass through the plain pointer, to cycle every page through the resident set.
+			if (memcmp(data, input, INPUT_SIZE) != 0) {
+				TEST_ERRMSG("%s: full direct access mismatch.", rle->name);
+				++fails;
+			}
+			touched += INPUT_SIZE / 4096 + 1;
+		}
+
+		struct rle_lazy_stats stats;
+		rle_lazy_stats(lz, &stats);
+		if (stats.resident > MAX_RESIDENT || stats.loads == 0 || stats.loads > touched || stats.loads - stats.evictions != stats.resident) {
+			TEST_ERRMSG("%s: unexpected stats, %zu loads, %zu evictions, %zu resident.", rle->name, stats.loads, stats.evictions, stats.resident);
+			++fails;
+		}
+
+		rle_lazy_destroy(lz);
+		free(comp);
+	}
+
+	// Malformed and empty input.
+	struct rle_lazy_config cfg = { .max_resident = 1, .no_fault = no_fault };
+	const uint8_t bad[] = { 0x05, 'A' };
+	errno = 0;
+	if (rle_lazy_create(packbits_parse_op, bad, sizeof(bad), &cfg) != NULL || errno != EINVAL) {
+		TEST_ERRMSG("expected failure with EINVAL on malformed input.");
+		++fails;
+	}
+	struct rle_lazy *lz = rle_lazy_create(packbits_parse_op, bad, 0, &cfg);
+	if (!lz || rle_lazy_size(lz) != 0 || rle_lazy_get(lz, 0) != NULL || rle_lazy_read(lz, 0, window, 1) != 0) {
+		TEST_ERRMSG("expected an empty buffer from empty input.");
+		++fails;
+	}
+	rle_lazy_destroy(lz);
+
+	free(input);
+
+	if (fails == 0) {
+		printf("Suite '%s' passed " GREEN "OK" NC "\n", testname);
+	}
+	return fails;
+}
+
+int main(void) {
+	size_t failed = 0;
+
+	failed += test_lazy_mode(0);
+	failed += test_lazy_mode(1);
+
+	if (failed != 0) {
+		printf("Tests " RED "FAILED" NC "\n");
+	} else {
+		printf("All tests " GREEN "passed OK" NC ".\n");
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -14,6 +14,20 @@
 #include "rle_packbits.h"
 #include "rle_pcx.h"
 #include "rle_icns.h"
+#include "rle_split.h"
+#include "rle_longrun.h"
+#include "rle_rlew.h"
+#include "rle_nibble.h"
+#include "rle_bitmask.h"
+#include "rle_span.h"
+#include "rle_cursor.h"
+#include "rle_query.h"
+#include "rle_edit.h"
+#include "rle_search.h"
+#include "rle_crc.h"
+#include "rle_frame.h"
+#include "rle_index.h"
+#include "rle_archive.h"
 
 #include "rle-variant-selection.h"
 
@@ -48,9 +62,7 @@ struct test {
 };
 
 
-/*
-	TODO: Should use some other digest with a simple plain-c implementation.
-*/
+// Byte-at-a-time reference implementation, to check rle_crc.h against.
 __attribute__ ((target ("sse4.2")))
 static uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
 	const uint8_t *src = data;
@@ -104,6 +116,958 @@ static int roundtrip(struct rle_t *rle, struct test *te, uint8_t *inbuf, size_t
 	return cmp;
 }
 
+struct vec_sink {
+	uint8_t *buf;
+	size_t len;
+	size_t cap;
+	int fail;	// Abort on the first call.
+};
+
+static int vec_sink(void *ctx, const uint8_t *buf, size_t len) {
+	struct vec_sink *v = ctx;
+	if (v->fail || len == 0 || len > RLE_ZOO_SINK_BUFFER_SIZE) {
+		return 1;
+	}
+	if (v->len + len > v->cap) {
+		v->cap = (v->len + len) * 2;
+		v->buf = realloc(v->buf, v->cap);
+	}
+	memcpy(v->buf + v->len, buf, len);
+	v->len += len;
+	return 0;
+}
+
+// Verify that output through a sink is identical to that of the one-shot function,
+// and that an aborting sink is reported as an error.
+static int check_sink(rle_fp func, rle_sink_fp sink_func, const uint8_t *src, size_t slen) {
+	ssize_t expected_len = func(src, slen, NULL, 0);
+	uint8_t *expected = NULL;
+	if (expected_len > 0) {
+		expected = malloc(expected_len);
+		func(src, slen, expected, expected_len);
+	}
+
+	int retval = 0;
+	struct vec_sink v = { 0 };
+	ssize_t res = sink_func(src, slen, vec_sink, &v);
+	if (res != expected_len) {
+		printf("sink: expected result %zd, got %zd\n", expected_len, res);
+		retval = 1;
+	} else if (res >= 0 && (v.len != (size_t)res || (res > 0 && memcmp(v.buf, expected, res) != 0))) {
+		printf("sink: output mismatch\n");
+		retval = 1;
+	}
+
+	if (expected_len > 0) {
+		struct vec_sink fail = { .fail = 1 };
+		res = sink_func(src, slen, vec_sink, &fail);
+		if (res >= 0) {
+			printf("sink: abort not reported, got %zd\n", res);
+			retval = 1;
+		}
+	}
+
+	free(v.buf);
+	free(expected);
+
+	return retval;
+}
+
+// Encode `src` through the streaming encoder using the given input and output chunk sizes,
+// and verify the result is identical to that of the one-shot encoder.
+static int check_compress_stream(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	// Not every variant has stream coders or an OP parser.
+	if (!rle->compress_stream) {
+		return 0;
+	}
+	static const size_t chunk_sizes[][2] = {
+		{ 1, 1 }, { 1, 7 }, { 3, 1 }, { 2, 129 }, { 64, 3 }, { 300, 130 }, { 65536, 65536 }
+	};
+	ssize_t expected_len = rle->compress(src, slen, NULL, 0);
+	assert(expected_len >= 0);
+	uint8_t *expected = malloc(expected_len + 1);
+	rle->compress(src, slen, expected, expected_len);
+
+	// No variant expands the input by more than a factor of two.
+	size_t cap = slen * 2 + 1;
+	uint8_t *out = malloc(cap);
+	int retval = 0;
+
+	for (size_t i = 0 ; i < sizeof(chunk_sizes)/sizeof(chunk_sizes[0]) ; ++i) {
+		struct rle_zoo_cstream cs;
+		rle_zoo_cstream_init(&cs);
+
+		size_t rp = 0;
+		size_t wp = 0;
+		ssize_t produced;
+		do {
+			size_t in_n = slen - rp < chunk_sizes[i][0] ? slen - rp : chunk_sizes[i][0];
+			size_t out_n = cap - wp < chunk_sizes[i][1] ? cap - wp : chunk_sizes[i][1];
+			size_t consumed = 0;
+			produced = rle->compress_stream(&cs, src + rp, in_n, &consumed, out + wp, out_n, rp + in_n == slen);
+			assert(consumed <= in_n);
+			assert(produced >= 0 && (size_t)produced <= out_n);
+			rp += consumed;
+			wp += produced;
+		} while (rp < slen || produced > 0);
+
+		if (wp != (size_t)expected_len || cs.total_out != wp || cs.total_in != slen || memcmp(out, expected, wp) != 0) {
+			printf("stream encode with chunks %zu/%zu: expected %zd bytes, got %zu\n", chunk_sizes[i][0], chunk_sizes[i][1], expected_len, wp);
+			retval = 1;
+		}
+	}
+
+	free(out);
+	free(expected);
+
+	return retval;
+}
+
+// Returns the size of a buffer for decoding `slen` bytes of input, valid or not. No variant but longrun expands
+// a byte of input into more than 128 bytes of output, and the suite doesn't have it do so on invalid input.
+static size_t decode_cap(size_t slen, ssize_t expected_len) {
+	size_t cap = slen * 128 + 1;
+	return expected_len >= 0 && (size_t)expected_len >= cap ? (size_t)expected_len + 1 : cap;
+}
+
+// Decode `src` through the streaming decoder using the given input and output chunk sizes,
+// and verify the result is identical to that of the one-shot decoder, including errors.
+static int check_decompress_stream(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->decompress_stream) {
+		return 0;
+	}
+	static const size_t chunk_sizes[][2] = {
+		{ 1, 1 }, { 1, 7 }, { 3, 1 }, { 2, 129 }, { 64, 3 }, { 65536, 65536 }
+	};
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	uint8_t *expected = NULL;
+	if (expected_len > 0) {
+		expected = malloc(expected_len);
+		rle->decompress(src, slen, expected, expected_len);
+	}
+
+	size_t cap = decode_cap(slen, expected_len);
+	uint8_t *out = malloc(cap);
+	int retval = 0;
+
+	for (size_t i = 0 ; i < sizeof(chunk_sizes)/sizeof(chunk_sizes[0]) ; ++i) {
+		struct rle_zoo_dstream ds;
+		rle_zoo_dstream_init(&ds);
+
+		size_t rp = 0;
+		size_t wp = 0;
+		ssize_t produced;
+		do {
+			size_t in_n = slen - rp < chunk_sizes[i][0] ? slen - rp : chunk_sizes[i][0];
+			size_t out_n = cap - wp < chunk_sizes[i][1] ? cap - wp : chunk_sizes[i][1];
+			size_t consumed = 0;
+			produced = rle->decompress_stream(&ds, src + rp, in_n, &consumed, out + wp, out_n);
+			assert(consumed <= in_n);
+			assert(produced >= 0 && (size_t)produced <= out_n);
+			rp += consumed;
+			wp += produced;
+		} while (rp < slen || produced > 0);
+
+		ssize_t res = rle_zoo_dstream_end(&ds);
+		if (res != expected_len || ds.total_in != slen) {
+			printf("stream decode with chunks %zu/%zu: expected result %zd, got %zd\n", chunk_sizes[i][0], chunk_sizes[i][1], expected_len, res);
+			retval = 1;
+		} else if (res >= 0 && (wp != (size_t)res || (res > 0 && memcmp(out, expected, res) != 0))) {
+			printf("stream decode with chunks %zu/%zu: output mismatch\n", chunk_sizes[i][0], chunk_sizes[i][1]);
+			retval = 1;
+		}
+	}
+
+	free(out);
+	free(expected);
+
+	return retval;
+}
+
+// Decode `src` into spans, in batches of various sizes, and verify that materializing them, both
+// directly and through iovecs, is identical to the output of the one-shot decoder, including errors.
+static int check_span(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	static const size_t batch_sizes[] = { 1, 2, 64 };
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	uint8_t *expected = NULL;
+	if (expected_len > 0) {
+		expected = malloc(expected_len);
+		rle->decompress(src, slen, expected, expected_len);
+	}
+
+	size_t cap = decode_cap(slen, expected_len);
+	uint8_t *out = malloc(cap);
+	uint8_t *iov_out = malloc(cap);
+	int retval = 0;
+
+	for (size_t i = 0 ; i < sizeof(batch_sizes)/sizeof(batch_sizes[0]) ; ++i) {
+		struct rle_span spans[64];
+		size_t rp = 0;
+		size_t wp = 0;
+		size_t iov_wp = 0;
+		ssize_t res;
+		while ((res = rle_span_decode(rle->parse_op, src, slen, &rp, spans, batch_sizes[i])) > 0) {
+			for (ssize_t j = 0 ; j < res ; ++j) {
+				if (spans[j].src) {
+					memcpy(out + wp, spans[j].src, spans[j].len);
+				} else {
+					memset(out + wp, spans[j].val, spans[j].len);
+				}
+				wp += spans[j].len;
+			}
+			// Use tiny iovec and scratch arrays to exercise resumption.
+			size_t idx = 0;
+			size_t ofs = 0;
+			while (idx < (size_t)res) {
+				struct iovec iov[2];
+				uint8_t scratch[5];
+				size_t niov = rle_span_iovec(spans, res, &idx, &ofs, iov, 2, scratch, sizeof(scratch));
+				assert(niov > 0);
+				for (size_t k = 0 ; k < niov ; ++k) {
+					memcpy(iov_out + iov_wp, iov[k].iov_base, iov[k].iov_len);
+					iov_wp += iov[k].iov_len;
+				}
+			}
+		}
+		if (res == 0) {
+			assert(rp == slen);
+			res = wp;
+		}
+		if (res != expected_len) {
+			printf("span decode in batches of %zu: expected result %zd, got %zd\n", batch_sizes[i], expected_len, res);
+			retval = 1;
+		} else if (res > 0 && (memcmp(out, expected, res) != 0 || iov_wp != wp || memcmp(iov_out, expected, res) != 0)) {
+			printf("span decode in batches of %zu: output mismatch\n", batch_sizes[i]);
+			retval = 1;
+		}
+	}
+
+	free(iov_out);
+	free(out);
+	free(expected);
+
+	return retval;
+}
+
+// Verify that reading through a cursor, in chunks and after skipping ahead, is identical
+// to the corresponding window of the output of the one-shot decoder, including errors.
+static int check_cursor(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	static const size_t chunk_sizes[] = { 1, 7, 64, 65536 };
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	uint8_t *expected = NULL;
+	if (expected_len > 0) {
+		expected = malloc(expected_len);
+		rle->decompress(src, slen, expected, expected_len);
+	}
+
+	size_t cap = decode_cap(slen, expected_len);
+	uint8_t *out = malloc(cap);
+	int retval = 0;
+
+	// Read everything in chunks.
+	for (size_t i = 0 ; i < sizeof(chunk_sizes)/sizeof(chunk_sizes[0]) ; ++i) {
+		struct rle_cursor cur;
+		rle_cursor_init(&cur, rle->parse_op, src, slen);
+		size_t wp = 0;
+		ssize_t res;
+		while ((res = rle_cursor_read(&cur, out + wp, chunk_sizes[i])) > 0) {
+			wp += res;
+		}
+		if (res == 0) {
+			res = wp;
+		}
+		if (res != expected_len || (res > 0 && memcmp(out, expected, res) != 0)) {
+			printf("cursor read in chunks of %zu: expected result %zd, got %zd\n", chunk_sizes[i], expected_len, res);
+			retval = 1;
+		}
+	}
+
+	// Skip to a window, and read it.
+	for (ssize_t ofs = 0 ; ofs < expected_len ; ofs += 1 + ofs / 2) {
+		for (size_t i = 0 ; i < sizeof(chunk_sizes)/sizeof(chunk_sizes[0]) ; ++i) {
+			size_t len = chunk_sizes[i];
+			if (len > (size_t)(expected_len - ofs)) {
+				len = expected_len - ofs;
+			}
+			struct rle_cursor cur;
+			rle_cursor_init(&cur, rle->parse_op, src, slen);
+			ssize_t skipped = rle_cursor_skip(&cur, ofs);
+			ssize_t res = rle_cursor_read(&cur, out, len);
+			if (skipped != ofs || res != (ssize_t)len || cur.wp != ofs + len || memcmp(out, expected + ofs, len) != 0) {
+				printf("cursor window %zd:%zu: mismatch, skipped %zd, read %zd\n", ofs, len, skipped, res);
+				retval = 1;
+			}
+		}
+	}
+
+	// Seek via checkpoint indexes of various intervals.
+	for (size_t i = 0 ; i < sizeof(chunk_sizes)/sizeof(chunk_sizes[0]) ; ++i) {
+		size_t interval = chunk_sizes[i];
+		size_t num = 0;
+		ssize_t res = rle_cursor_index(rle->parse_op, src, slen, interval, NULL, 0, &num);
+		if (res != expected_len) {
+			printf("cursor index every %zu: expected result %zd, got %zd\n", interval, expected_len, res);
+			retval = 1;
+			continue;
+		}
+		if (res < 0) {
+			continue;
+		}
+		struct rle_cursor_checkpoint *index = malloc((num + 1) * sizeof(*index));
+		size_t num2 = 0;
+		res = rle_cursor_index(rle->parse_op, src, slen, interval, index, num, &num2);
+		if (num != (expected_len + interval - 1) / interval || num2 != num) {
+			printf("cursor index every %zu: expected %zu checkpoints, got %zu\n", interval, (expected_len + interval - 1) / interval, num);
+			retval = 1;
+		}
+		for (ssize_t ofs = 0 ; ofs <= expected_len ; ofs += 1 + ofs / 3) {
+			size_t len = expected_len - ofs < 5 ? expected_len - ofs : 5;
+			struct rle_cursor cur;
+			rle_cursor_init(&cur, rle->parse_op, src, slen);
+			ssize_t pos = rle_cursor_seek(&cur, index, num, interval, ofs);
+			res = rle_cursor_read(&cur, out, len);
+			if (pos != ofs || res != (ssize_t)len || memcmp(out, expected + ofs, len) != 0) {
+				printf("cursor seek to %zd every %zu: mismatch, at %zd, read %zd\n", ofs, interval, pos, res);
+				retval = 1;
+			}
+		}
+		free(index);
+	}
+
+	free(out);
+	free(expected);
+
+	return retval;
+}
+
+// Verify that compressed-domain queries agree with decoding and computing.
+static int check_query(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	uint8_t *expected = NULL;
+	uint64_t expected_hist[256] = { 0 };
+	uint64_t expected_sum = 0;
+	if (expected_len > 0) {
+		expected = malloc(expected_len);
+		rle->decompress(src, slen, expected, expected_len);
+		for (ssize_t i = 0 ; i < expected_len ; ++i) {
+			expected_hist[expected[i]]++;
+			expected_sum += expected[i];
+		}
+	}
+	int retval = 0;
+
+	uint64_t hist[256];
+	ssize_t res = rle_query_histogram(rle->parse_op, src, slen, hist);
+	if (res != expected_len || (res >= 0 && memcmp(hist, expected_hist, sizeof(hist)) != 0)) {
+		printf("query histogram: expected result %zd, got %zd\n", expected_len, res);
+		retval = 1;
+	}
+
+	uint64_t sum;
+	res = rle_query_sum(rle->parse_op, src, slen, &sum);
+	if (res != expected_len || (res >= 0 && sum != expected_sum)) {
+		printf("query sum: expected result %zd, got %zd\n", expected_len, res);
+		retval = 1;
+	}
+
+	for (int v = 0 ; v < 256 ; v += 51) {
+		uint64_t count;
+		res = rle_query_count(rle->parse_op, src, slen, v, &count);
+		if (res != expected_len || (res >= 0 && count != expected_hist[v])) {
+			printf("query count of %d: expected result %zd, got %zd\n", v, expected_len, res);
+			retval = 1;
+		}
+	}
+
+	if (expected_len >= 0) {
+		// Compare against the same data encoded with every variant, and against a modified copy.
+		for (size_t i = 0 ; i < RLE_ZOO_NUM_VARIANTS ; ++i) {
+			struct rle_t *other = &rle_variants[i];
+			if (!other->parse_op) {
+				continue;
+			}
+			ssize_t olen = other->compress(expected, expected_len, NULL, 0);
+			uint8_t *obuf = malloc(olen + 1);
+			other->compress(expected, expected_len, obuf, olen);
+			int eq = rle_query_equal(rle->parse_op, src, slen, other->parse_op, obuf, olen);
+			if (eq != 1) {
+				printf("query equal vs '%s': expected equal, got %d\n", other->name, eq);
+				retval = 1;
+			}
+			free(obuf);
+
+			if (expected_len > 0) {
+				expected[expected_len / 2] ^= 1;
+				olen = other->compress(expected, expected_len, NULL, 0);
+				obuf = malloc(olen);
+				other->compress(expected, expected_len, obuf, olen);
+				eq = rle_query_equal(rle->parse_op, src, slen, other->parse_op, obuf, olen);
+				if (eq != 0) {
+					printf("query equal vs modified '%s': expected not equal, got %d\n", other->name, eq);
+					retval = 1;
+				}
+				free(obuf);
+				expected[expected_len / 2] ^= 1;
+			}
+		}
+	} else if (rle_query_equal(rle->parse_op, src, slen, rle->parse_op, src, slen) != -1) {
+		printf("query equal on malformed input: expected -1\n");
+		retval = 1;
+	}
+
+	free(expected);
+
+	return retval;
+}
+
+// Verify slicing and remapping against decode, transform and encode, and that concatenating the slices reproduces the whole.
+static int check_edit(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	if (expected_len < 0) {
+		ssize_t res = rle_edit_slice(rle->parse_op, rle->compress, src, slen, 0, SIZE_MAX, NULL, 0);
+		if (res != expected_len) {
+			printf("slice of malformed input: expected result %zd, got %zd\n", expected_len, res);
+			return 1;
+		}
+		uint8_t ident[256];
+		for (size_t v = 0 ; v < sizeof(ident) ; ++v) {
+			ident[v] = (uint8_t)v;
+		}
+		res = rle_edit_remap(rle->parse_op, rle->compress, ident, src, slen, NULL, 0);
+		if (res != expected_len) {
+			printf("remap of malformed input: expected result %zd, got %zd\n", expected_len, res);
+			return 1;
+		}
+		return 0;
+	}
+	uint8_t *expected = malloc(expected_len + 1);
+	rle->decompress(src, slen, expected, expected_len);
+
+	// Long REPs are re-encoded in pieces, a few bytes per RLE_EDIT_OP_MAX_CNT.
+	size_t cap = 2 * slen + 2 * RLE_EDIT_OP_MAX_CNT + 8 * (expected_len / RLE_EDIT_OP_MAX_CNT);
+	uint8_t *a = malloc(cap);
+	uint8_t *b = malloc(cap);
+	uint8_t *ab = malloc(2 * cap);
+	uint8_t *out = malloc(expected_len + 1);
+	int retval = 0;
+
+	for (ssize_t ofs = 0 ; ofs <= expected_len ; ofs += 1 + ofs / 3) {
+		// Slice [0, ofs) and [ofs, end), and check each.
+		ssize_t alen = rle_edit_slice(rle->parse_op, rle->compress, src, slen, 0, ofs, a, cap);
+		ssize_t blen = rle_edit_slice(rle->parse_op, rle->compress, src, slen, ofs, SIZE_MAX, b, cap);
+		ssize_t asize = rle_edit_slice(rle->parse_op, rle->compress, src, slen, 0, ofs, NULL, 0);
+		if (alen < 0 || blen < 0 || asize != alen) {
+			printf("slice at %zd: failed with %zd, %zd (sized %zd)\n", ofs, alen, blen, asize);
+			retval = 1;
+			break;
+		}
+		if (rle->decompress(a, alen, out, expected_len) != ofs || memcmp(out, expected, ofs) != 0) {
+			printf("slice [0, %zd): decoded data mismatch\n", ofs);
+			retval = 1;
+		}
+		if (rle->decompress(b, blen, out, expected_len) != expected_len - ofs || memcmp(out, expected + ofs, expected_len - ofs) != 0) {
+			printf("slice [%zd, end): decoded data mismatch\n", ofs);
+			retval = 1;
+		}
+		if (alen > 0 && rle_edit_slice(rle->parse_op, rle->compress, src, slen, 0, ofs, a, alen - 1) >= 0) {
+			printf("slice [0, %zd): expected failure with short output buffer\n", ofs);
+			retval = 1;
+		}
+
+		// Rejoin.
+		ssize_t ablen = rle_edit_concat(rle->parse_op, rle->compress, a, alen, b, blen, ab, 2 * cap);
+		ssize_t absize = rle_edit_concat(rle->parse_op, rle->compress, a, alen, b, blen, NULL, 0);
+		if (ablen != absize || ablen > alen + blen || rle->decompress(ab, ablen, out, expected_len) != expected_len || memcmp(out, expected, expected_len) != 0) {
+			printf("concat at %zd: decoded data mismatch, %zd bytes (sized %zd)\n", ofs, ablen, absize);
+			retval = 1;
+		}
+
+		// A window in the middle.
+		size_t len = (size_t)(expected_len - ofs) / 2;
+		ssize_t wlen = rle_edit_slice(rle->parse_op, rle->compress, src, slen, ofs, len, a, cap);
+		if (wlen < 0 || rle->decompress(a, wlen, out, expected_len) != (ssize_t)len || memcmp(out, expected + ofs, len) != 0) {
+			printf("slice [%zd, %zd): decoded data mismatch\n", ofs, ofs + len);
+			retval = 1;
+		}
+	}
+
+	// Remap with a LUT that changes every value, and one that collapses runs together.
+	for (int k = 0 ; k < 2 ; ++k) {
+		uint8_t lut[256];
+		for (size_t v = 0 ; v < sizeof(lut) ; ++v) {
+			lut[v] = k == 0 ? (uint8_t)(v ^ 0xC5) : (uint8_t)(v & 0xF0);
+		}
+		ssize_t rlen = rle_edit_remap(rle->parse_op, rle->compress, lut, src, slen, a, cap);
+		ssize_t rsize = rle_edit_remap(rle->parse_op, rle->compress, lut, src, slen, NULL, 0);
+		if (rlen < 0 || rlen != rsize || rle->decompress(a, rlen, out, expected_len) != expected_len) {
+			printf("remap %d: failed with %zd (sized %zd)\n", k, rlen, rsize);
+			retval = 1;
+			continue;
+		}
+		for (ssize_t i = 0 ; i < expected_len ; ++i) {
+			if (out[i] != lut[expected[i]]) {
+				printf("remap %d: decoded data mismatch at %zd\n", k, i);
+				retval = 1;
+				break;
+			}
+		}
+		if (rlen > 0 && rle_edit_remap(rle->parse_op, rle->compress, lut, src, slen, a, rlen - 1) >= 0) {
+			printf("remap %d: expected failure with short output buffer\n", k);
+			retval = 1;
+		}
+	}
+
+	free(out);
+	free(ab);
+	free(b);
+	free(a);
+	free(expected);
+
+	return retval;
+}
+
+struct search_hits {
+	size_t *offsets;
+	size_t num;
+	size_t max;
+};
+
+static int search_hit(void *ctx, size_t offset) {
+	struct search_hits *hits = ctx;
+	if (hits->num < hits->max) {
+		hits->offsets[hits->num] = offset;
+	}
+	++hits->num;
+	return 0;
+}
+
+static int search_stop(void *ctx, size_t offset) {
+	*(size_t*)ctx = offset;
+	return 1;
+}
+
+// Verify pattern search against a plain search of the decoded data, for patterns taken from the data.
+static int check_search(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	if (expected_len < 0) {
+		ssize_t res = rle_search(rle->parse_op, src, slen, (const uint8_t*)"A", 1, NULL, NULL);
+		if (res != expected_len) {
+			printf("search of malformed input: expected result %zd, got %zd\n", expected_len, res);
+			return 1;
+		}
+		return 0;
+	}
+	uint8_t *expected = malloc(expected_len + 1);
+	rle->decompress(src, slen, expected, expected_len);
+
+	struct search_hits hits = { malloc((expected_len + 1) * sizeof(size_t)), 0, (size_t)expected_len + 1 };
+	int retval = 0;
+
+	static const size_t plens[] = { 1, 2, 3, 5, 17, 130 };
+	for (ssize_t ofs = 0 ; ofs < expected_len ; ofs += 1 + ofs / 2) {
+		for (size_t k = 0 ; k < sizeof(plens)/sizeof(plens[0]) + 1 ; ++k) {
+			uint8_t run[4];
+			const uint8_t *pat;
+			size_t plen;
+			if (k < sizeof(plens)/sizeof(plens[0])) {
+				pat = expected + ofs;
+				plen = plens[k];
+				if (plen > (size_t)(expected_len - ofs)) {
+					continue;
+				}
+			} else {
+				memset(run, expected[ofs], sizeof(run));
+				pat = run;
+				plen = sizeof(run);
+			}
+
+			hits.num = 0;
+			ssize_t res = rle_search(rle->parse_op, src, slen, pat, plen, search_hit, &hits);
+			ssize_t count = rle_search(rle->parse_op, src, slen, pat, plen, NULL, NULL);
+			size_t num = 0;
+			for (size_t i = 0 ; i + plen <= (size_t)expected_len ; ++i) {
+				if (memcmp(expected + i, pat, plen) == 0) {
+					if (num >= hits.num || hits.offsets[num] != i) {
+						printf("search for %zu bytes at %zd: missing match at %zu\n", plen, ofs, i);
+						retval = 1;
+						break;
+					}
+					++num;
+				}
+			}
+			if (res != (ssize_t)num || count != res || hits.num != num) {
+				printf("search for %zu bytes at %zd: expected %zu matches, got %zd (counted %zd)\n", plen, ofs, num, res, count);
+				retval = 1;
+			}
+
+			size_t first = SIZE_MAX;
+			res = rle_search(rle->parse_op, src, slen, pat, plen, search_stop, &first);
+			if (num > 0 && (res != 1 || first != hits.offsets[0])) {
+				printf("search for %zu bytes at %zd: stopping at first match failed\n", plen, ofs);
+				retval = 1;
+			}
+		}
+	}
+
+	free(hits.offsets);
+	free(expected);
+
+	return retval;
+}
+
+static uint32_t crc32c_ref(const void *data, size_t len) {
+	return crc32c((uint32_t)~0, data, len) ^ (uint32_t)~0;
+}
+
+// Verify the fused checksumming decoder and encoder against decoding, encoding and checksumming separately.
+static int check_crc(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op || !rle->compress_stream) {
+		return 0;
+	}
+	static int checked_math;
+	int retval = 0;
+
+	if (!checked_math) {
+		// Check the run and interleaved paths once, independent of the data.
+		static const size_t run_lens[] = { 0, 1, 63, 64, 255, 256, 4095, 4096, 4097, 65536 + 17 };
+		size_t buflen = 6 * 2048 + 77;
+		uint8_t *buf = malloc(buflen > 65536 + 17 ? buflen : 65536 + 17);
+		for (size_t i = 0 ; i < sizeof(run_lens)/sizeof(run_lens[0]) ; ++i) {
+			memset(buf, 0xA5, run_lens[i]);
+			uint32_t pre = rle_crc32c(0, "zoo", 3);
+			uint32_t expected = crc32c(~pre, buf, run_lens[i]) ^ (uint32_t)~0;
+			if (rle_crc32c_rep(pre, 0xA5, run_lens[i]) != expected) {
+				printf("crc of run of %zu: mismatch\n", run_lens[i]);
+				retval = 1;
+			}
+		}
+		for (size_t i = 0 ; i < buflen ; ++i) {
+			buf[i] = (uint8_t)(i * 7 + (i >> 5));
+		}
+		uint32_t whole = rle_crc32c(0, buf, buflen);
+		if (whole != crc32c_ref(buf, buflen) || rle_crc32c_combine(rle_crc32c(0, buf, 1000), rle_crc32c(0, buf + 1000, buflen - 1000), buflen - 1000) != whole) {
+			printf("crc of %zu bytes: mismatch\n", buflen);
+			retval = 1;
+		}
+		free(buf);
+		checked_math = 1;
+	}
+
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	uint32_t out_crc = 0;
+	uint32_t in_crc = 0;
+	ssize_t res = rle_crc_decompress(rle->parse_op, src, slen, NULL, 0, &out_crc, &in_crc);
+	if (res != expected_len) {
+		printf("crc decompress: expected result %zd, got %zd\n", expected_len, res);
+		return 1;
+	}
+	if (expected_len < 0) {
+		return retval;
+	}
+	uint8_t *expected = malloc(expected_len + 1);
+	rle->decompress(src, slen, expected, expected_len);
+	uint32_t expected_crc = crc32c_ref(expected, expected_len);
+	if (out_crc != expected_crc || in_crc != crc32c_ref(src, slen)) {
+		printf("crc decompress: checksum mismatch, got %08x/%08x\n", out_crc, in_crc);
+		retval = 1;
+	}
+
+	uint8_t *out = malloc(expected_len + 1);
+	res = rle_crc_decompress(rle->parse_op, src, slen, out, expected_len, &out_crc, NULL);
+	if (res != expected_len || out_crc != expected_crc || memcmp(out, expected, expected_len) != 0) {
+		printf("crc decompress: output mismatch, got %zd\n", res);
+		retval = 1;
+	}
+	// The error is the negated position plus one of the OP that doesn't fit.
+	if (expected_len > 0) {
+		res = rle_crc_decompress(rle->parse_op, src, slen, out, expected_len - 1, &out_crc, NULL);
+		if (res >= -1 || (size_t)~res - 1 >= slen) {
+			printf("crc decompress: expected failure with short output buffer, got %zd\n", res);
+			retval = 1;
+		}
+	}
+
+	// Re-encode the decoded data.
+	ssize_t clen = rle->compress(expected, expected_len, NULL, 0);
+	uint8_t *comp = malloc(clen + 1);
+	uint8_t *cout = malloc(clen + 1);
+	rle->compress(expected, expected_len, comp, clen);
+	res = rle_crc_compress(rle->compress_stream, expected, expected_len, cout, clen, &out_crc, &in_crc);
+	ssize_t sized = rle_crc_compress(rle->compress_stream, expected, expected_len, NULL, 0, &out_crc, NULL);
+	if (res != clen || sized != clen || memcmp(cout, comp, clen) != 0 || out_crc != crc32c_ref(comp, clen) || in_crc != expected_crc) {
+		printf("crc compress: expected %zd bytes, got %zd (sized %zd)\n", clen, res, sized);
+		retval = 1;
+	}
+	if (clen > 0 && rle_crc_compress(rle->compress_stream, expected, expected_len, cout, clen - 1, &out_crc, NULL) >= 0) {
+		printf("crc compress: expected failure with short output buffer\n");
+		retval = 1;
+	}
+
+	free(cout);
+	free(comp);
+	free(out);
+	free(expected);
+
+	return retval;
+}
+
+// Verify that a framed stream reads back with the same header, and that malformed headers are rejected.
+static int check_frame(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	struct rle_frame_header hdr = { .variant = rle->id, .flags = RLE_FRAME_FLAG_CRC, .compressed_size = slen };
+	ssize_t res = rle_crc_decompress(rle->parse_op, src, slen, NULL, 0, &hdr.crc, NULL);
+	if (res < 0) {
+		return 0;
+	}
+	hdr.decoded_size = (uint64_t)res;
+
+	uint8_t *framed = malloc(RLE_FRAME_HEADER_SIZE + slen);
+	size_t hlen = rle_frame_write_header(&hdr, framed);
+	memcpy(framed + hlen, src, slen);
+	int retval = 0;
+
+	struct rle_frame_header rhdr;
+	res = rle_frame_read_header(framed, hlen + slen, &rhdr);
+	if (res != RLE_FRAME_HEADER_SIZE || rhdr.variant != hdr.variant || rhdr.flags != hdr.flags || rhdr.decoded_size != hdr.decoded_size || rhdr.compressed_size != hdr.compressed_size || rhdr.crc != hdr.crc) {
+		printf("frame header: read back mismatch, got %zd\n", res);
+		retval = 1;
+	}
+	uint32_t crc;
+	if (rle_crc_decompress(rle->parse_op, framed + res, rhdr.compressed_size, NULL, 0, &crc, NULL) != (ssize_t)rhdr.decoded_size || crc != rhdr.crc) {
+		printf("frame payload: decoded size or crc mismatch\n");
+		retval = 1;
+	}
+
+	if (slen > 0 && rle_frame_read_header(framed, hlen + slen - 1, &rhdr) != -2) {
+		printf("frame header: expected truncated frame to be rejected\n");
+		retval = 1;
+	}
+	// A crafted decoded size, which would wrap an allocation of one more byte.
+	rle_frame_put_le(framed + 8, ~(uint64_t)0, 8);
+	if (rle_frame_read_header(framed, hlen + slen, &rhdr) != -2) {
+		printf("frame header: expected oversized decoded size to be rejected\n");
+		retval = 1;
+	}
+	rle_frame_put_le(framed + 8, hdr.decoded_size, 8);
+	framed[6] |= 0x80;
+	if (rle_frame_read_header(framed, hlen + slen, &rhdr) != -2) {
+		printf("frame header: expected unknown flags to be rejected\n");
+		retval = 1;
+	}
+	framed[0] ^= 0xFF;
+	if (rle_frame_read_header(framed, hlen + slen, &rhdr) != -1 || rle_frame_read_header(framed, hlen - 1, &rhdr) != -1) {
+		printf("frame header: expected bad magic or short input to be rejected\n");
+		retval = 1;
+	}
+
+	free(framed);
+
+	return retval;
+}
+
+// Verify that a serialized index reads back, and that windows extracted through it match the decoded data.
+static int check_index(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	static const size_t intervals[] = { 1, 7, 4096 };
+	ssize_t expected_len = rle->decompress(src, slen, NULL, 0);
+	if (expected_len < 0) {
+		return 0;
+	}
+	uint8_t *expected = malloc(expected_len + 1);
+	rle->decompress(src, slen, expected, expected_len);
+	uint8_t out[16];
+	int retval = 0;
+
+	for (size_t i = 0 ; i < sizeof(intervals)/sizeof(intervals[0]) ; ++i) {
+		struct rle_index idx = { .variant = rle->id, .interval = intervals[i], .compressed_size = slen };
+		rle_cursor_index(rle->parse_op, src, slen, idx.interval, NULL, 0, &idx.num);
+		struct rle_cursor_checkpoint *cps = malloc((idx.num + 1) * sizeof(*cps));
+		idx.decoded_size = (size_t)rle_cursor_index(rle->parse_op, src, slen, idx.interval, cps, idx.num, &idx.num);
+		idx.checkpoints = cps;
+
+		size_t ilen = rle_index_size(idx.num);
+		uint8_t *buf = malloc(ilen);
+		struct rle_cursor_checkpoint *rcps = malloc((idx.num + 1) * sizeof(*rcps));
+		struct rle_index ridx;
+		ssize_t res = rle_index_write(&idx, buf) == ilen ? rle_index_read(buf, ilen, &ridx, rcps, idx.num) : -3;
+		if (res != (ssize_t)ilen || ridx.variant != idx.variant || ridx.decoded_size != idx.decoded_size || ridx.num != idx.num ||
+			(idx.num && memcmp(rcps, cps, idx.num * sizeof(*cps)) != 0)) {
+			printf("index every %zu: read back mismatch, got %zd\n", idx.interval, res);
+			retval = 1;
+		}
+		for (size_t ofs = 0 ; ofs <= (size_t)expected_len ; ofs += 1 + ofs / 3) {
+			size_t len = expected_len - ofs < sizeof(out) ? expected_len - ofs : sizeof(out);
+			res = rle_index_extract(rle->parse_op, &ridx, src, slen, ofs, out, sizeof(out));
+			if (res != (ssize_t)len || memcmp(out, expected + ofs, len) != 0) {
+				printf("index every %zu: extract at %zu mismatch, got %zd\n", idx.interval, ofs, res);
+				retval = 1;
+			}
+		}
+		if (slen > 0 && rle_index_extract(rle->parse_op, &ridx, src, slen - 1, 0, out, sizeof(out)) != -1) {
+			printf("index every %zu: expected a stream of another size to be rejected\n", idx.interval);
+			retval = 1;
+		}
+		if (ilen > RLE_INDEX_HEADER_SIZE && rle_index_read(buf, ilen - 1, &ridx, NULL, 0) != -2) {
+			printf("index every %zu: expected a truncated index to be rejected\n", idx.interval);
+			retval = 1;
+		}
+		if (idx.num > 0 && rle_index_read(buf, ilen, &ridx, rcps, idx.num - 1) != -3) {
+			printf("index every %zu: expected too small a checkpoint array to be rejected\n", idx.interval);
+			retval = 1;
+		}
+		// A crafted decoded size, where rounding up to whole intervals wraps to no checkpoints.
+		uint8_t hostile[RLE_INDEX_HEADER_SIZE];
+		memcpy(hostile, buf, sizeof(hostile));
+		rle_index_put_le(hostile + 8, 2, 8);
+		rle_index_put_le(hostile + 16, ~(uint64_t)0, 8);
+		rle_index_put_le(hostile + 32, 0, 8);
+		if (rle_index_read(hostile, sizeof(hostile), &ridx, NULL, 0) != -2) {
+			printf("index every %zu: expected an oversized decoded size to be rejected\n", idx.interval);
+			retval = 1;
+		}
+		buf[1] ^= 0xFF;
+		if (rle_index_read(buf, ilen, &ridx, NULL, 0) != -1) {
+			printf("index every %zu: expected bad magic to be rejected\n", idx.interval);
+			retval = 1;
+		}
+
+		free(rcps);
+		free(buf);
+		free(cps);
+	}
+
+	free(expected);
+
+	return retval;
+}
+
+// Verify that entries of an archive holding the stream under several names can be listed in index order,
+// looked up and decoded, and that bad archives are rejected.
+static int check_archive(struct rle_t *rle, const uint8_t *src, size_t slen) {
+	if (!rle->parse_op) {
+		return 0;
+	}
+	static const char *names[] = { "stream", "", "a/b/c.rle", "stream2", "z" };
+	const size_t num = sizeof(names)/sizeof(names[0]);
+	uint32_t crc;
+	ssize_t expected_len = rle_crc_decompress(rle->parse_op, src, slen, NULL, 0, &crc, NULL);
+	if (expected_len < 0) {
+		return 0;
+	}
+	uint8_t *expected = malloc(expected_len + 1);
+	rle->decompress(src, slen, expected, expected_len);
+	uint8_t *out = malloc(expected_len + 1);
+	int retval = 0;
+
+	struct rle_archive_input inputs[sizeof(names)/sizeof(names[0])];
+	for (size_t i = 0 ; i < num ; ++i) {
+		struct rle_archive_input in = { names[i], strlen(names[i]), rle->id, src, slen, (size_t)expected_len, crc };
+		inputs[i] = in;
+	}
+	ssize_t alen = rle_archive_write(inputs, num, NULL, 0);
+	uint8_t *buf = malloc(alen);
+	struct rle_archive ar;
+	if (rle_archive_write(inputs, num, buf, alen) != alen || rle_archive_write(inputs, num, buf, alen - 1) != -1 || rle_archive_open(&ar, buf, alen) != 0 || ar.num != num) {
+		printf("archive: write or open failed\n");
+		free(buf);
+		free(out);
+		free(expected);
+		return 1;
+	}
+
+	uint64_t prev_hash = 0;
+	for (size_t i = 0 ; i < num ; ++i) {
+		struct rle_archive_entry e;
+		if (rle_archive_get(&ar, i, &e) != 0 || e.hash < prev_hash || e.hash != rle_archive_hash(e.name, e.name_len)) {
+			printf("archive: entry %zu out of order\n", i);
+			retval = 1;
+		}
+		prev_hash = e.hash;
+	}
+	for (size_t i = 0 ; i < num ; ++i) {
+		struct rle_archive_entry e;
+		ssize_t pos = rle_archive_find(&ar, names[i], strlen(names[i]), &e);
+		ssize_t res = pos >= 0 ? rle_archive_decompress(rle->parse_op, &e, out, expected_len) : pos;
+		if (pos < 0 || e.name_len != strlen(names[i]) || memcmp(e.name, names[i], e.name_len) != 0 || e.variant != rle->id ||
+			res != expected_len || memcmp(out, expected, expected_len) != 0) {
+			printf("archive: lookup of '%s' failed, got %zd\n", names[i], res);
+			retval = 1;
+		}
+	}
+	struct rle_archive_entry e;
+	if (rle_archive_find(&ar, "stream3", 7, &e) != -1 || rle_archive_find(&ar, "strea", 5, &e) != -1 || rle_archive_get(&ar, num, &e) != -1) {
+		printf("archive: expected lookup of missing entries to fail\n");
+		retval = 1;
+	}
+	rle_archive_find(&ar, "z", 1, &e);
+	e.crc ^= 1;
+	if (rle_archive_decompress(rle->parse_op, &e, out, expected_len) != -1) {
+		printf("archive: expected checksum mismatch to be detected\n");
+		retval = 1;
+	}
+
+	if (rle_archive_open(&ar, buf, alen - 1) != -2) {
+		printf("archive: expected truncated archive to be rejected\n");
+		retval = 1;
+	}
+	// An entry with a crafted decoded size, which would wrap an allocation of one more byte.
+	uint8_t saved[8];
+	memcpy(saved, buf + RLE_ARCHIVE_HEADER_SIZE + 24, 8);
+	rle_archive_put_le(buf + RLE_ARCHIVE_HEADER_SIZE + 24, ~(uint64_t)0, 8);
+	if (rle_archive_get(&ar, 0, &e) != -2) {
+		printf("archive: expected entry with oversized decoded size to be rejected\n");
+		retval = 1;
+	}
+	memcpy(buf + RLE_ARCHIVE_HEADER_SIZE + 24, saved, 8);
+	// A header claiming a total smaller than itself, with a huge number of entries.
+	uint8_t hostile[RLE_ARCHIVE_HEADER_SIZE];
+	memcpy(hostile, buf, sizeof(hostile));
+	rle_archive_put_le(hostile + 8, (uint64_t)~0 >> 8, 8);
+	for (uint64_t total = 0 ; total < RLE_ARCHIVE_HEADER_SIZE ; total += 7) {
+		rle_archive_put_le(hostile + 16, total, 8);
+		if (rle_archive_open(&ar, hostile, sizeof(hostile)) != -2) {
+			printf("archive: expected header with total of %u to be rejected\n", (unsigned int)total);
+			retval = 1;
+		}
+	}
+	inputs[3].name = "stream";
+	inputs[3].name_len = 6;
+	if (rle_archive_write(inputs, num, NULL, 0) != -2) {
+		printf("archive: expected duplicate names to be rejected\n");
+		retval = 1;
+	}
+	buf[0] ^= 0xFF;
+	if (rle_archive_open(&ar, buf, alen) != -1) {
+		printf("archive: expected bad magic to be rejected\n");
+		retval = 1;
+	}
+
+	free(buf);
+	free(out);
+	free(expected);
+
+	return retval;
+}
+
 static int run_rle_test(struct rle_t *rle, struct test *te, const char *filename, size_t line_no) {
 	// Take the max of the input and expected sizes as base estimate for temporary buffer.
 	size_t tmp_size = te->len;
@@ -136,7 +1100,7 @@ static int run_rle_test(struct rle_t *rle, struct test *te, const char *filename
 				retval = 1;
 			}
 
-			uint32_t res_hash = crc32c((uint32_t)~0, tmp_buf, res) ^ (uint32_t)~0;
+			uint32_t res_hash = rle_crc32c(0, tmp_buf, res);
 
 			// Now decompress with the output byte-tight, to check for dest range-check errors.
 			ssize_t res_tight = rle->compress(te->input, te->len, tmp_buf, len_check);
@@ -145,7 +1109,7 @@ static int run_rle_test(struct rle_t *rle, struct test *te, const char *filename
 				retval = 1;
 			}
 
-			uint32_t res_tight_hash = crc32c((uint32_t)~0, tmp_buf, res_tight) ^ (uint32_t)~0;
+			uint32_t res_tight_hash = rle_crc32c(0, tmp_buf, res_tight);
 			if (res_hash != te->expected_hash) {
 				TEST_ERRMSG("expected compressed hash 0x%08x, got 0x%08x.", te->expected_hash, res_hash);
 				retval = 1;
@@ -157,6 +1121,66 @@ static int run_rle_test(struct rle_t *rle, struct test *te, const char *filename
 				retval = 1;
 			}
 
+			if (check_compress_stream(rle, te->input, te->len) != 0) {
+				TEST_ERRMSG("stream compression does not match one-shot compression.");
+				retval = 1;
+			}
+
+			if (check_sink(rle->compress, rle->compress_to_sink, te->input, te->len) != 0 || check_sink(rle->decompress, rle->decompress_to_sink, tmp_buf, res) != 0) {
+				TEST_ERRMSG("sink output does not match one-shot output.");
+				retval = 1;
+			}
+
+			if (check_span(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("span decoding of compressed output does not match one-shot decompression.");
+				retval = 1;
+			}
+
+			if (check_cursor(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("cursor decoding of compressed output does not match one-shot decompression.");
+				retval = 1;
+			}
+
+			if (check_index(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("indexed extraction from compressed output does not match one-shot decompression.");
+				retval = 1;
+			}
+
+			if (check_archive(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("archived compressed output does not read back.");
+				retval = 1;
+			}
+
+			if (check_query(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("queries on compressed output do not match decompressed data.");
+				retval = 1;
+			}
+
+			if (check_edit(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("slicing, concatenation or remapping of compressed output does not match decompressed data.");
+				retval = 1;
+			}
+
+			if (check_search(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("pattern search in compressed output does not match search of decompressed data.");
+				retval = 1;
+			}
+
+			if (check_crc(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("fused checksums of compressed output do not match checksums of the data.");
+				retval = 1;
+			}
+
+			if (check_frame(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("framed compressed output does not read back.");
+				retval = 1;
+			}
+
+			if (check_decompress_stream(rle, tmp_buf, res) != 0) {
+				TEST_ERRMSG("stream decompression of compressed output does not match one-shot decompression.");
+				retval = 1;
+			}
+
 			if (flag_roundtrip && !no_roundtrip && roundtrip(rle, te, tmp_buf, te->expected_size, 0) != 0) {
 				TEST_ERRMSG("re-decompressed data does not match original input!");
 				retval = 1;
@@ -183,16 +1207,74 @@ static int run_rle_test(struct rle_t *rle, struct test *te, const char *filename
 			TEST_ERRMSG("expected decompressed size %zd, got %zd.", te->expected_size, len_check);
 			retval = 1;
 		}
+		if (check_decompress_stream(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("stream decompression does not match one-shot decompression.");
+			retval = 1;
+		}
+		if (check_sink(rle->decompress, rle->decompress_to_sink, te->input, te->len) != 0) {
+			TEST_ERRMSG("sink output does not match one-shot decompression.");
+			retval = 1;
+		}
+		if (check_span(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("span decoding does not match one-shot decompression.");
+			retval = 1;
+		}
+		if (check_cursor(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("cursor decoding does not match one-shot decompression.");
+			retval = 1;
+		}
+		if (check_index(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("indexed extraction does not match one-shot decompression.");
+			retval = 1;
+		}
+		if (check_archive(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("archived input does not read back.");
+			retval = 1;
+		}
+		if (check_query(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("queries do not match decompressed data.");
+			retval = 1;
+		}
+		if (check_edit(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("slicing, concatenation or remapping does not match decompressed data.");
+			retval = 1;
+		}
+
+		if (check_search(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("pattern search does not match search of decompressed data.");
+			retval = 1;
+		}
+
+		if (check_crc(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("fused checksums do not match checksums of the data.");
+			retval = 1;
+		}
+
+		if (check_frame(rle, te->input, te->len) != 0) {
+			TEST_ERRMSG("framed input does not read back.");
+			retval = 1;
+		}
 		if (len_check > 0) {
 			// Next decompress the input into the oversized buffer, and verify length remains the same.
 			assert(len_check <= (ssize_t)tmp_size);
+			memset(tmp_buf, 0xA5, tmp_size);
 			ssize_t res = rle->decompress(te->input, te->len, tmp_buf, tmp_size);
 			if (res != len_check) {
 				TEST_ERRMSG("decompressed output length differs from determined value %zd, got %zd.", len_check, res);
 				retval = 1;
 			}
+			// Nothing may be written past the end of the output.
+			if (res > 0) {
+				for (size_t j = (size_t)res ; j < tmp_size ; ++j) {
+					if (tmp_buf[j] != 0xA5) {
+						TEST_ERRMSG("decompression wrote past the end of the output, at offset %zu.", j);
+						retval = 1;
+						break;
+					}
+				}
+			}
 
-			uint32_t res_hash = crc32c((uint32_t)~0, tmp_buf, res) ^ (uint32_t)~0;
+			uint32_t res_hash = rle_crc32c(0, tmp_buf, res);
 
 			// Now decompress with the output byte-tight, to check for dest range-check errors.
 			ssize_t res_tight = rle->decompress(te->input, te->len, tmp_buf, len_check);
@@ -201,7 +1283,7 @@ static int run_rle_test(struct rle_t *rle, struct test *te, const char *filename
 				retval = 1;
 			}
 
-			uint32_t res_tight_hash = crc32c((uint32_t)~0, tmp_buf, res_tight) ^ (uint32_t)~0;
+			uint32_t res_tight_hash = rle_crc32c(0, tmp_buf, res_tight);
 			if (res_tight_hash != te->expected_hash) {
 				TEST_ERRMSG("expected decompressed hash 0x%08x, got 0x%08x.", te->expected_hash, res_hash);
 				retval = 1;